@@ -0,0 +1,69 @@
+// Benchmark ECDH secp256r1: độ trễ tạo khóa & tính shared secret cho từng backend
+// Build & chạy: pio run -e bench-ecdh -t upload && pio device monitor
+#include <Arduino.h>
+#include "EcdhBackend.h"
+
+static const int ITERATIONS = 20;
+
+static void benchBackend(EcdhBackend backend)
+{
+    uint8_t pub[64], priv[32];
+    uint8_t peerPub[64], peerPriv[32];
+    uint8_t secret[32];
+    uint32_t keygenUs = 0, sharedUs = 0, worstKeygen = 0, worstShared = 0;
+
+    ecdhMakeKey(backend, peerPub, peerPriv);
+
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        uint32_t t0 = micros();
+        bool ok = ecdhMakeKey(backend, pub, priv);
+        uint32_t t1 = micros();
+        ok = ok && ecdhSharedSecret(backend, peerPub, priv, secret);
+        uint32_t t2 = micros();
+        if (!ok)
+        {
+            Serial.printf("%s: ECDH failed at iteration %d\n", ecdhBackendName(backend), i);
+            return;
+        }
+
+        keygenUs += t1 - t0;
+        sharedUs += t2 - t1;
+        worstKeygen = max(worstKeygen, t1 - t0);
+        worstShared = max(worstShared, t2 - t1);
+    }
+
+    Serial.printf("%-12s keygen %7lu us (max %7lu)  shared %7lu us (max %7lu)\n", ecdhBackendName(backend),
+                  (unsigned long)(keygenUs / ITERATIONS), (unsigned long)worstKeygen,
+                  (unsigned long)(sharedUs / ITERATIONS), (unsigned long)worstShared);
+}
+
+// Hai backend phải ra cùng shared secret với cùng cặp khóa
+static void crossCheck()
+{
+    uint8_t aPub[64], aPriv[32], bPub[64], bPriv[32];
+    uint8_t s1[32], s2[32];
+    ecdhMakeKey(ECDH_BACKEND_UECC, aPub, aPriv);
+    ecdhMakeKey(ECDH_BACKEND_MBEDTLS, bPub, bPriv);
+
+    bool ok = ecdhSharedSecret(ECDH_BACKEND_UECC, bPub, aPriv, s1) &&
+              ecdhSharedSecret(ECDH_BACKEND_MBEDTLS, aPub, bPriv, s2) &&
+              memcmp(s1, s2, sizeof(s1)) == 0;
+    Serial.printf("Cross-backend shared secret: %s\n", ok ? "MATCH" : "MISMATCH");
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    delay(1000);
+
+    Serial.printf("CPU %lu MHz, %d iterations\n", (unsigned long)getCpuFrequencyMhz(), ITERATIONS);
+    crossCheck();
+    benchBackend(ECDH_BACKEND_UECC);
+    benchBackend(ECDH_BACKEND_MBEDTLS);
+}
+
+void loop()
+{
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,97 @@
+// Benchmark mã hóa gói tin: so sánh API String cũ với API buffer (không cấp phát heap)
+// Build & chạy: pio run -e bench-encrypt -t upload && pio device monitor
+#include <Arduino.h>
+#include "CryptoESP.h"
+
+// Đếm số lần gọi allocator qua -Wl,--wrap (xem env:bench-encrypt trong platformio.ini)
+static volatile uint32_t heapOps = 0;
+
+extern "C"
+{
+    void *__real_malloc(size_t size);
+    void *__real_calloc(size_t n, size_t size);
+    void *__real_realloc(void *ptr, size_t size);
+    void __real_free(void *ptr);
+
+    void *__wrap_malloc(size_t size)
+    {
+        heapOps++;
+        return __real_malloc(size);
+    }
+    void *__wrap_calloc(size_t n, size_t size)
+    {
+        heapOps++;
+        return __real_calloc(n, size);
+    }
+    void *__wrap_realloc(void *ptr, size_t size)
+    {
+        heapOps++;
+        return __real_realloc(ptr, size);
+    }
+    void __wrap_free(void *ptr)
+    {
+        if (ptr)
+            heapOps++;
+        __real_free(ptr);
+    }
+}
+
+static const int ITERATIONS = 1000;
+
+CryptoESP device;
+CryptoESP peer;
+
+static void report(const char *name, uint32_t cycles, uint32_t ops)
+{
+    Serial.printf("%-22s %8lu cycles/pkt  %6.2f heap ops/pkt\n", name,
+                  (unsigned long)(cycles / ITERATIONS), (float)ops / ITERATIONS);
+}
+
+static void benchPayload(size_t len)
+{
+    char plaintext[257];
+    memset(plaintext, 'A', len);
+    plaintext[len] = '\0';
+    Serial.printf("\n--- plaintext %u bytes ---\n", (unsigned)len);
+
+    // Trước: String API (init/setkey + malloc + 3 String Base64 + JsonDocument)
+    uint32_t ops0 = heapOps;
+    uint32_t t0 = ESP.getCycleCount();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        String pkt = device.createEncryptedPacket(plaintext);
+    }
+    uint32_t cycles = ESP.getCycleCount() - t0;
+    report("String API", cycles, heapOps - ops0);
+
+    // Sau: buffer API với context GCM đã cache
+    static char out[512];
+    ops0 = heapOps;
+    t0 = ESP.getCycleCount();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        device.createEncryptedPacket((const uint8_t *)plaintext, len, out, sizeof(out));
+    }
+    cycles = ESP.getCycleCount() - t0;
+    report("Buffer API (cached)", cycles, heapOps - ops0);
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    delay(1000);
+
+    device.begin();
+    peer.begin();
+    device.setPeerPublicKeyRaw(peer.getPublicKeyRaw());
+
+    Serial.printf("CPU %lu MHz, %d iterations\n", (unsigned long)getCpuFrequencyMhz(), ITERATIONS);
+    benchPayload(16);
+    benchPayload(64);
+    benchPayload(256);
+}
+
+void loop()
+{
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,612 @@
+// Giả lập đội thiết bị trên Linux để tải thử mosquitto + backend + decoder (docker-compose).
+// Mỗi thiết bị ảo dùng đúng CryptoESP của firmware: ECDH -> POST /exchange -> MQTT CONNECT
+// -> publish gói JSON đã mã hóa lên esp32/data theo chu kỳ.
+// Decoder bật DECODER_ACKS=1 sẽ trả ack trên esp32/decoded/<device>, từ đó đo
+// tỉ lệ giải mã thành công và độ trễ end-to-end (publish -> decoder giải mã xong).
+//
+// Build & chạy: pio run -e fleet-sim && .pio/build/fleet-sim/program --devices 1000 --rate 1
+// Tham số: --devices N --rate msg/s/thiết bị --payload byte --duration s --ramp s
+//          --churn s (thời gian sống trung bình của 1 session, 0 = không churn)
+//          --workers N --broker host --mqtt-port P --backend host --http-port P
+//          --user U --pass P --prefix tiền-tố-device-id
+#include <Arduino.h>
+#include "CryptoESP.h"
+#include "MqttCodec.h"
+
+#include <errno.h>
+#include <math.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define SIM_KEEPALIVE_SEC 60
+#define SIM_IO_TIMEOUT_MS 5000
+#define SIM_ACK_GRACE_MS 3000
+
+struct Options
+{
+    int devices = 100;
+    double rate = 1.0;
+    int payload = 32;
+    int duration = 60;
+    double ramp = 10;
+    double churn = 0;
+    int workers = 4;
+    std::string broker = "127.0.0.1";
+    int mqttPort = 1883;
+    std::string backend = "127.0.0.1";
+    int httpPort = 8000;
+    std::string user = "admin";
+    std::string pass = "123456";
+    std::string prefix = "sim-";
+};
+
+struct Stats
+{
+    std::atomic<uint64_t> enrolled{0};
+    std::atomic<uint64_t> exchangeFail{0};
+    std::atomic<uint64_t> connectFail{0};
+    std::atomic<uint64_t> published{0};
+    std::atomic<uint64_t> publishFail{0};
+    std::atomic<uint64_t> acked{0};
+    std::atomic<uint64_t> ackFailed{0};
+    std::atomic<uint64_t> churned{0};
+};
+
+struct SimDevice
+{
+    CryptoESP crypto;
+    int fd = -1;
+    bool started = false;
+    uint32_t seq = 0;
+    uint64_t nextActionUs = 0;  // Lần enroll/publish kế tiếp
+    uint64_t sessionEndUs = 0;  // Hết hạn session (churn), 0 = không
+    uint64_t lastSendUs = 0;
+};
+
+static Options opt;
+static Stats stats;
+static std::atomic<bool> stopping{false};
+static std::atomic<uint64_t> monitorEndUs{0}; // Monitor chạy thêm SIM_ACK_GRACE_MS sau khi dừng publish
+
+// Gói đang chờ ack: "<device>/<iv base64>" -> thời điểm publish
+static std::mutex pendingLock;
+static std::unordered_map<std::string, uint64_t> pending;
+static std::vector<uint32_t> latencyUs;
+
+static uint64_t nowUs() { return nativeMicros64(); }
+
+// ---------- Socket ----------
+
+static int tcpConnect(const std::string &host, int port)
+{
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *res = NULL;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0)
+        return -1;
+
+    int fd = -1;
+    for (addrinfo *ai = res; ai; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        timeval tv = {SIM_IO_TIMEOUT_MS / 1000, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+static bool sendAll(int fd, const void *buf, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    while (len > 0)
+    {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Đọc tới khi tách được đủ 1 gói MQTT (dùng cho CONNACK/SUBACK lúc bắt tay)
+static bool mqttReadPacket(int fd, uint8_t *buf, size_t bufSize, size_t *have, MqttPacket *pkt)
+{
+    for (;;)
+    {
+        size_t n = mqttParse(buf, *have, pkt);
+        if (n == (size_t)-1)
+            return false;
+        if (n > 0)
+        {
+            // Gói nằm đầu buffer; caller dùng xong mới dịch phần còn lại
+            return true;
+        }
+        if (*have >= bufSize)
+            return false;
+        ssize_t r = recv(fd, buf + *have, bufSize - *have, 0);
+        if (r <= 0)
+            return false;
+        *have += r;
+    }
+}
+
+static int mqttOpen(const char *clientId)
+{
+    int fd = tcpConnect(opt.broker, opt.mqttPort);
+    if (fd < 0)
+        return -1;
+
+    uint8_t buf[256];
+    size_t n = mqttEncodeConnect(buf, sizeof(buf), clientId, opt.user.c_str(), opt.pass.c_str(), SIM_KEEPALIVE_SEC);
+    size_t have = 0;
+    MqttPacket pkt;
+    if (n == 0 || !sendAll(fd, buf, n) || !mqttReadPacket(fd, buf, sizeof(buf), &have, &pkt) ||
+        mqttConnackCode(pkt) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// ---------- Trao đổi khóa ----------
+
+static bool httpExchange(CryptoESP &crypto)
+{
+    int fd = tcpConnect(opt.backend, opt.httpPort);
+    if (fd < 0)
+        return false;
+
+    char publicKeyHex[PUBLIC_KEY_HEX_SIZE];
+    crypto.getPublicKeyHex(publicKeyHex, sizeof(publicKeyHex));
+    char body[256];
+    int bodyLen = snprintf(body, sizeof(body), "{\"publicKey\":\"%s\",\"device\":\"%s\"}",
+                           publicKeyHex, crypto.getDeviceId());
+    char req[512];
+    int reqLen = snprintf(req, sizeof(req),
+                          "POST /exchange HTTP/1.1\r\nHost: %s\r\nContent-Type: application/json\r\n"
+                          "Content-Length: %d\r\nConnection: close\r\n\r\n%s",
+                          opt.backend.c_str(), bodyLen, body);
+
+    std::string resp;
+    if (sendAll(fd, req, reqLen))
+    {
+        char chunk[1024];
+        ssize_t r;
+        while ((r = recv(fd, chunk, sizeof(chunk), 0)) > 0)
+            resp.append(chunk, r);
+    }
+    close(fd);
+
+    size_t bodyAt = resp.find("\r\n\r\n");
+    if (resp.compare(0, 12, "HTTP/1.1 200") != 0 || bodyAt == std::string::npos)
+        return false;
+
+    DynamicJsonDocument res(512);
+    if (deserializeJson(res, resp.c_str() + bodyAt + 4))
+        return false;
+    const char *peerHex = res["publicKey"];
+    const char *sessionHex = res["sessionId"];
+    if (!peerHex || !crypto.setPeerPublicKeyHex(peerHex))
+        return false;
+    if (sessionHex)
+        crypto.setSessionIdHex(sessionHex);
+    return true;
+}
+
+// ---------- Thiết bị ảo ----------
+
+static uint64_t randomLifetimeUs()
+{
+    // Phân phối mũ quanh --churn giây
+    double u = (esp_random() + 1.0) / 4294967297.0;
+    return (uint64_t)(-log(u) * opt.churn * 1e6);
+}
+
+static void disconnect(SimDevice &dev)
+{
+    if (dev.fd < 0)
+        return;
+    uint8_t buf[2];
+    size_t n = mqttEncodeDisconnect(buf, sizeof(buf));
+    sendAll(dev.fd, buf, n);
+    close(dev.fd);
+    dev.fd = -1;
+}
+
+static void enroll(SimDevice &dev, uint64_t now)
+{
+    // Lần đầu begin() sinh key; các lần churn sau sinh cặp key mới
+    if (!dev.started)
+    {
+        dev.crypto.begin();
+        dev.started = true;
+    }
+    else
+    {
+        dev.crypto.generateNewKeys();
+    }
+
+    if (!httpExchange(dev.crypto))
+    {
+        stats.exchangeFail++;
+        dev.nextActionUs = now + 1000000 + random(1000000);
+        return;
+    }
+    dev.fd = mqttOpen(dev.crypto.getDeviceId());
+    if (dev.fd < 0)
+    {
+        stats.connectFail++;
+        dev.nextActionUs = now + 1000000 + random(1000000);
+        return;
+    }
+
+    stats.enrolled++;
+    dev.lastSendUs = now;
+    dev.sessionEndUs = opt.churn > 0 ? now + randomLifetimeUs() : 0;
+    // Lệch pha ngẫu nhiên để các thiết bị không publish cùng lúc
+    dev.nextActionUs = now + random((long)(1e6 / opt.rate));
+}
+
+static void publish(SimDevice &dev, uint64_t now)
+{
+    static thread_local char plaintext[1024];
+    static thread_local char json[2048];
+    static thread_local uint8_t frame[2100];
+
+    size_t len = std::min<size_t>(opt.payload, sizeof(plaintext));
+    int n = snprintf(plaintext, sizeof(plaintext), "sim %s seq %u ", dev.crypto.getDeviceId(), dev.seq++);
+    for (size_t i = n; i < len; i++)
+        plaintext[i] = 'x';
+    len = std::max<size_t>(len, n);
+
+    size_t pktLen = dev.crypto.createEncryptedPacket((const uint8_t *)plaintext, len, json, sizeof(json));
+    size_t frameLen = pktLen ? mqttEncodePublish(frame, sizeof(frame), "esp32/data", (const uint8_t *)json, pktLen) : 0;
+
+    // Khóa chờ ack: device id + IV (Base64, đúng chuỗi trong gói)
+    const char *iv = strstr(json, "\"iv\":\"");
+    std::string key = std::string(dev.crypto.getDeviceId()) + "/" + (iv ? std::string(iv + 6, 16) : "");
+    {
+        std::lock_guard<std::mutex> guard(pendingLock);
+        pending[key] = nowUs();
+    }
+
+    if (frameLen == 0 || !sendAll(dev.fd, frame, frameLen))
+    {
+        {
+            std::lock_guard<std::mutex> guard(pendingLock);
+            pending.erase(key);
+        }
+        stats.publishFail++;
+        close(dev.fd);
+        dev.fd = -1;
+        dev.nextActionUs = now + 1000000;
+        return;
+    }
+    stats.published++;
+    dev.lastSendUs = now;
+}
+
+static void service(SimDevice &dev, uint64_t now, uint64_t intervalUs)
+{
+    if (dev.fd < 0)
+    {
+        if (now >= dev.nextActionUs)
+            enroll(dev, now);
+        return;
+    }
+
+    if (dev.sessionEndUs && now >= dev.sessionEndUs)
+    {
+        disconnect(dev);
+        stats.churned++;
+        dev.nextActionUs = now;
+        return;
+    }
+
+    if (now >= dev.nextActionUs)
+    {
+        publish(dev, now);
+        dev.nextActionUs += intervalUs;
+        // Tụt lại quá 1 chu kỳ (máy quá tải): không dồn publish bù
+        if (dev.nextActionUs < now)
+            dev.nextActionUs = now + intervalUs;
+    }
+
+    if (dev.fd >= 0 && now - dev.lastSendUs > SIM_KEEPALIVE_SEC * 500000ULL)
+    {
+        uint8_t buf[2];
+        size_t n = mqttEncodePingReq(buf, sizeof(buf));
+        if (sendAll(dev.fd, buf, n))
+            dev.lastSendUs = now;
+    }
+
+    // Bỏ qua dữ liệu broker gửi về (PINGRESP) để buffer nhận không đầy
+    uint8_t sink[256];
+    while (dev.fd >= 0 && recv(dev.fd, sink, sizeof(sink), MSG_DONTWAIT) > 0)
+    {
+    }
+}
+
+static void workerTask(std::vector<SimDevice *> devices, uint64_t endUs)
+{
+    uint64_t intervalUs = (uint64_t)(1e6 / opt.rate);
+    while (!stopping && nowUs() < endUs)
+    {
+        uint64_t now = nowUs();
+        uint64_t next = now + 5000;
+        for (SimDevice *dev : devices)
+        {
+            service(*dev, now, intervalUs);
+            next = std::min(next, dev->nextActionUs);
+        }
+        now = nowUs();
+        if (next > now)
+            std::this_thread::sleep_for(std::chrono::microseconds(std::min<uint64_t>(next - now, 5000)));
+    }
+    for (SimDevice *dev : devices)
+        disconnect(*dev);
+}
+
+// ---------- Theo dõi ack của decoder ----------
+
+static void handleAck(const MqttPublish &pub, uint64_t now)
+{
+    static const char prefix[] = "esp32/decoded/";
+    if (pub.topicLen <= sizeof(prefix) - 1)
+        return;
+    std::string device(pub.topic + sizeof(prefix) - 1, pub.topicLen - (sizeof(prefix) - 1));
+
+    DynamicJsonDocument doc(256);
+    if (deserializeJson(doc, (const char *)pub.payload, pub.payloadLen))
+        return;
+    const char *iv = doc["iv"];
+    bool ok = doc["ok"] | false;
+    if (!iv)
+        return;
+
+    std::lock_guard<std::mutex> guard(pendingLock);
+    auto it = pending.find(device + "/" + iv);
+    if (it == pending.end())
+        return;
+    if (ok)
+    {
+        stats.acked++;
+        latencyUs.push_back((uint32_t)std::min<uint64_t>(now - it->second, UINT32_MAX));
+    }
+    else
+    {
+        stats.ackFailed++;
+    }
+    pending.erase(it);
+}
+
+static void monitorTask()
+{
+    static uint8_t buf[16384];
+    int fd = mqttOpen((opt.prefix + "monitor").c_str());
+    size_t n = fd >= 0 ? mqttEncodeSubscribe(buf, sizeof(buf), 1, "esp32/decoded/#") : 0;
+    if (n == 0 || !sendAll(fd, buf, n))
+    {
+        fprintf(stderr, "[Sim] Monitor cannot subscribe to esp32/decoded/#, latency will not be measured\n");
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+
+    timeval tv = {0, 200000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    size_t have = 0;
+    uint64_t lastPing = nowUs();
+    while (nowUs() < monitorEndUs)
+    {
+        ssize_t r = recv(fd, buf + have, sizeof(buf) - have, 0);
+        if (r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+            break;
+        if (r > 0)
+            have += r;
+
+        uint64_t now = nowUs();
+        size_t used = 0;
+        MqttPacket pkt;
+        MqttPublish pub;
+        for (;;)
+        {
+            size_t len = mqttParse(buf + used, have - used, &pkt);
+            if (len == 0 || len == (size_t)-1)
+                break;
+            if (mqttParsePublish(pkt, &pub))
+                handleAck(pub, now);
+            used += len;
+        }
+        memmove(buf, buf + used, have - used);
+        have -= used;
+        // Gói quá lớn không vừa buffer: bỏ luồng hiện tại
+        if (have == sizeof(buf))
+            have = 0;
+
+        if (now - lastPing > SIM_KEEPALIVE_SEC * 500000ULL)
+        {
+            n = mqttEncodePingReq(buf + have, sizeof(buf) - have);
+            sendAll(fd, buf + have, n);
+            lastPing = now;
+        }
+    }
+    close(fd);
+}
+
+// ---------- Báo cáo ----------
+
+static double percentileMs(std::vector<uint32_t> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    size_t idx = std::min(sorted.size() - 1, (size_t)(p * (sorted.size() - 1) + 0.5));
+    return sorted[idx] / 1000.0;
+}
+
+static void printProgress(double elapsed)
+{
+    printf("[%5.0fs] enrolled %llu  published %llu  acked %llu  ack-fail %llu  exch-fail %llu  conn-fail %llu\n",
+           elapsed, (unsigned long long)stats.enrolled.load(), (unsigned long long)stats.published.load(),
+           (unsigned long long)stats.acked.load(), (unsigned long long)stats.ackFailed.load(),
+           (unsigned long long)stats.exchangeFail.load(), (unsigned long long)stats.connectFail.load());
+    fflush(stdout);
+}
+
+static void printReport(double seconds)
+{
+    std::vector<uint32_t> sorted;
+    size_t lost;
+    {
+        std::lock_guard<std::mutex> guard(pendingLock);
+        sorted = latencyUs;
+        lost = pending.size();
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    uint64_t published = stats.published;
+    uint64_t acked = stats.acked;
+    printf("\n=== Fleet simulation: %d devices, %.2f msg/s each, %d B payload, %.0f s ===\n", opt.devices, opt.rate,
+           opt.payload, seconds);
+    printf("Enrollments        %llu ok, %llu exchange fail, %llu connect fail, %llu churned\n",
+           (unsigned long long)stats.enrolled.load(), (unsigned long long)stats.exchangeFail.load(),
+           (unsigned long long)stats.connectFail.load(), (unsigned long long)stats.churned.load());
+    printf("Published          %llu (%.1f msg/s), %llu send errors\n", (unsigned long long)published,
+           published / seconds, (unsigned long long)stats.publishFail.load());
+    if (acked + stats.ackFailed == 0)
+    {
+        printf("Decoded            no acks received (run decoder with DECODER_ACKS=1)\n");
+        return;
+    }
+    printf("Decoded            %llu ok (%.1f msg/s), %llu failed, %zu without ack\n", (unsigned long long)acked,
+           acked / seconds, (unsigned long long)stats.ackFailed.load(), lost);
+    printf("Decrypt success    %.2f %%\n", published ? 100.0 * acked / published : 0.0);
+    printf("Latency (ms)       p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n", percentileMs(sorted, 0.50),
+           percentileMs(sorted, 0.90), percentileMs(sorted, 0.99), percentileMs(sorted, 1.0));
+}
+
+// ---------- main ----------
+
+static void parseArgs(int argc, char **argv)
+{
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string name = argv[i];
+        const char *v = argv[i + 1];
+        if (name == "--devices")
+            opt.devices = atoi(v);
+        else if (name == "--rate")
+            opt.rate = atof(v);
+        else if (name == "--payload")
+            opt.payload = atoi(v);
+        else if (name == "--duration")
+            opt.duration = atoi(v);
+        else if (name == "--ramp")
+            opt.ramp = atof(v);
+        else if (name == "--churn")
+            opt.churn = atof(v);
+        else if (name == "--workers")
+            opt.workers = atoi(v);
+        else if (name == "--broker")
+            opt.broker = v;
+        else if (name == "--mqtt-port")
+            opt.mqttPort = atoi(v);
+        else if (name == "--backend")
+            opt.backend = v;
+        else if (name == "--http-port")
+            opt.httpPort = atoi(v);
+        else if (name == "--user")
+            opt.user = v;
+        else if (name == "--pass")
+            opt.pass = v;
+        else if (name == "--prefix")
+            opt.prefix = v;
+        else
+            fprintf(stderr, "[Sim] Unknown option %s\n", name.c_str());
+    }
+    opt.devices = std::max(opt.devices, 1);
+    opt.workers = std::max(1, std::min(opt.workers, opt.devices));
+    opt.rate = opt.rate > 0 ? opt.rate : 1.0;
+}
+
+static void onSignal(int) { stopping = true; }
+
+int main(int argc, char **argv)
+{
+    parseArgs(argc, argv);
+    signal(SIGINT, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+    // Log của CryptoESP cho hàng nghìn thiết bị làm nhiễu báo cáo
+    Serial.mute(true);
+
+    std::vector<std::unique_ptr<SimDevice>> fleet;
+    uint64_t start = nowUs();
+    for (int i = 0; i < opt.devices; i++)
+    {
+        std::unique_ptr<SimDevice> dev(new SimDevice());
+        char id[DEVICE_ID_LEN + 1];
+        snprintf(id, sizeof(id), "%s%06d", opt.prefix.c_str(), i);
+        dev->crypto.setDeviceId(id);
+        // Enroll rải đều trong --ramp giây đầu
+        dev->nextActionUs = start + (uint64_t)(opt.ramp * 1e6 * i / opt.devices);
+        fleet.push_back(std::move(dev));
+    }
+
+    uint64_t endUs = start + opt.duration * 1000000ULL;
+    monitorEndUs = endUs + SIM_ACK_GRACE_MS * 1000ULL;
+    std::thread monitor(monitorTask);
+
+    std::vector<std::thread> workers;
+    for (int w = 0; w < opt.workers; w++)
+    {
+        std::vector<SimDevice *> mine;
+        for (int i = w; i < opt.devices; i += opt.workers)
+            mine.push_back(fleet[i].get());
+        workers.emplace_back(workerTask, mine, endUs);
+    }
+
+    printf("[Sim] %d devices on %d workers -> broker %s:%d, backend %s:%d\n", opt.devices, opt.workers,
+           opt.broker.c_str(), opt.mqttPort, opt.backend.c_str(), opt.httpPort);
+    while (!stopping && nowUs() < endUs)
+    {
+        delay(1000);
+        uint64_t elapsed = nowUs() - start;
+        if ((elapsed / 1000000) % 5 == 0)
+            printProgress(elapsed / 1e6);
+    }
+    double seconds = (std::min(nowUs(), endUs) - start) / 1e6;
+    monitorEndUs = std::min<uint64_t>(monitorEndUs, nowUs() + SIM_ACK_GRACE_MS * 1000ULL);
+
+    for (std::thread &t : workers)
+        t.join();
+    // Chờ thêm ack của các gói cuối
+    monitor.join();
+
+    printReport(seconds);
+    return 0;
+}
@@ -0,0 +1,182 @@
+// Soak test heap: chạy đường gửi của firmware SOAK_MESSAGES lần (mặc định 1 triệu gói),
+// in free heap & khối trống lớn nhất định kỳ để kiểm tra không rò rỉ / phân mảnh.
+// Mỗi gói: đọc mẫu -> gắn header seq -> mã hóa JSON (buffer API) -> mã hóa gói MQTT QoS 1.
+// Mỗi SOAK_JSON_EVERY gói: đường trao đổi khóa (public key hex + parse reply) và parse
+// cấu hình hotspot, cả hai qua JsonDocument dùng JsonArena.
+// Build & chạy: pio run -e bench-soak -t upload && pio device monitor
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include "CryptoESP.h"
+#include "MqttCodec.h"
+#include "JsonArena.h"
+
+#ifndef SOAK_MESSAGES
+#define SOAK_MESSAGES 1000000UL
+#endif
+#ifndef SOAK_REPORT_EVERY
+#define SOAK_REPORT_EVERY 100000UL
+#endif
+#ifndef SOAK_JSON_EVERY
+#define SOAK_JSON_EVERY 1000UL
+#endif
+
+// Đếm số lần gọi allocator qua -Wl,--wrap (xem env:bench-soak trong platformio.ini)
+static volatile uint32_t heapOps = 0;
+
+extern "C"
+{
+    void *__real_malloc(size_t size);
+    void *__real_calloc(size_t n, size_t size);
+    void *__real_realloc(void *ptr, size_t size);
+    void __real_free(void *ptr);
+
+    void *__wrap_malloc(size_t size)
+    {
+        heapOps++;
+        return __real_malloc(size);
+    }
+    void *__wrap_calloc(size_t n, size_t size)
+    {
+        heapOps++;
+        return __real_calloc(n, size);
+    }
+    void *__wrap_realloc(void *ptr, size_t size)
+    {
+        heapOps++;
+        return __real_realloc(ptr, size);
+    }
+    void __wrap_free(void *ptr)
+    {
+        if (ptr)
+            heapOps++;
+        __real_free(ptr);
+    }
+}
+
+struct HeapSnapshot
+{
+    uint32_t freeHeap;
+    uint32_t largestBlock;
+    uint32_t minFree;
+};
+
+CryptoESP device;
+CryptoESP peer;
+
+static char plaintext[64];
+static uint8_t framed[SEQ_HEADER_LEN + sizeof(plaintext)];
+static char packet[512];
+static uint8_t mqttOut[640];
+static JsonArena<1536> keyJsonArena;
+static JsonArena<2048> configJsonArena;
+static char keyReply[256];
+
+static HeapSnapshot snapshot()
+{
+    return {ESP.getFreeHeap(), (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT), ESP.getMinFreeHeap()};
+}
+
+static void report(uint32_t done, const HeapSnapshot &s, uint32_t ops, uint32_t ms)
+{
+    Serial.printf("%8lu msgs  free %6lu  largest %6lu  min %6lu  heap ops %6lu  arena peak %4u/%4u  %6lu ms\n",
+                  (unsigned long)done, (unsigned long)s.freeHeap, (unsigned long)s.largestBlock,
+                  (unsigned long)s.minFree, (unsigned long)ops, (unsigned)keyJsonArena.peak(),
+                  (unsigned)configJsonArena.peak(), (unsigned long)ms);
+}
+
+// Giống đường gửi của CryptoTask + NetTask (main.cpp), bỏ hàng đợi & mạng
+static bool sendOne(uint32_t seq)
+{
+    size_t len = snprintf(plaintext, sizeof(plaintext), "Data: %lu", (unsigned long)millis());
+    for (int i = 0; i < 4; i++)
+        framed[i] = (seq >> (8 * i)) & 0xFF;
+    memset(framed + 4, 0, 8);
+    memcpy(framed + SEQ_HEADER_LEN, plaintext, len);
+
+    size_t pktLen = device.createEncryptedPacket(framed, SEQ_HEADER_LEN + len, packet, sizeof(packet), NULL,
+                                                 PACKET_FLAG_SEQ);
+    if (pktLen == 0)
+        return false;
+    return mqttEncodePublish(mqttOut, sizeof(mqttOut), "esp32/data", (const uint8_t *)packet, pktLen, 1,
+                             (uint16_t)(seq | 1)) > 0;
+}
+
+// Đường trao đổi khóa & cấu hình hotspot (main.cpp / HotspotManager.cpp)
+static bool jsonPaths()
+{
+    char publicKeyHex[PUBLIC_KEY_HEX_SIZE];
+    char body[64 + DEVICE_ID_LEN + PUBLIC_KEY_HEX_SIZE];
+    device.getPublicKeyHex(publicKeyHex, sizeof(publicKeyHex));
+    snprintf(body, sizeof(body), "{\"device\":\"%s\",\"publicKey\":\"%s\"}", device.getDeviceId(), publicKeyHex);
+
+    {
+        JsonDocument res(&keyJsonArena);
+        if (deserializeJson(res, keyReply))
+            return false;
+        const char *pk = res["publicKey"];
+        if (!pk || strlen(pk) != 128)
+            return false;
+    }
+
+    static const char config[] =
+        "{\"wifi_ssid\":\"soak-test-network\",\"wifi_pass\":\"0123456789abcdef\","
+        "\"mqtt_server\":\"broker.local\",\"mqtt_port\":1883,\"mqtt_user\":\"device\","
+        "\"mqtt_pass\":\"secret\",\"key_url\":\"http://192.168.1.10:8000/exchange\"}";
+    JsonDocument doc(&configJsonArena);
+    if (deserializeJson(doc, config, sizeof(config) - 1))
+        return false;
+    return (doc["mqtt_port"] | 0) == 1883;
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    delay(1000);
+
+    device.begin();
+    peer.begin();
+    device.setPeerPublicKeyRaw(peer.getPublicKeyRaw());
+    char peerHex[PUBLIC_KEY_HEX_SIZE];
+    peer.getPublicKeyHex(peerHex, sizeof(peerHex));
+    snprintf(keyReply, sizeof(keyReply), "{\"publicKey\":\"%s\",\"sessionId\":\"0011223344556677\"}", peerHex);
+
+    Serial.printf("CPU %lu MHz, %lu messages, JSON paths every %lu\n", (unsigned long)getCpuFrequencyMhz(),
+                  (unsigned long)SOAK_MESSAGES, (unsigned long)SOAK_JSON_EVERY);
+
+    // Lượt khởi động: cấp phát 1 lần (context GCM, ratchet...) không tính vào kết quả
+    sendOne(0);
+    jsonPaths();
+
+    HeapSnapshot first = snapshot();
+    HeapSnapshot last = first;
+    uint32_t ops0 = heapOps;
+    uint32_t failures = 0;
+    uint32_t t0 = millis();
+    report(0, first, 0, 0);
+
+    for (uint32_t i = 1; i <= SOAK_MESSAGES; i++)
+    {
+        if (!sendOne(i))
+            failures++;
+        if (i % SOAK_JSON_EVERY == 0 && !jsonPaths())
+            failures++;
+        if (i % SOAK_REPORT_EVERY == 0)
+        {
+            last = snapshot();
+            report(i, last, heapOps - ops0, millis() - t0);
+            delay(1); // Cho IDLE task chạy (watchdog)
+        }
+    }
+
+    // Ratchet (mỗi RATCHET_MAX_MESSAGES gói) được phép cấp phát tạm, nhưng phải trả lại hết
+    bool flat = last.freeHeap == first.freeHeap && last.largestBlock == first.largestBlock;
+    Serial.printf("\nFree heap %+ld B, largest block %+ld B, %lu heap ops (%.4f/msg), %lu failures -> %s\n",
+                  (long)last.freeHeap - (long)first.freeHeap, (long)last.largestBlock - (long)first.largestBlock,
+                  (unsigned long)(heapOps - ops0), (float)(heapOps - ops0) / SOAK_MESSAGES,
+                  (unsigned long)failures, flat ? "FLAT" : "DRIFT");
+}
+
+void loop()
+{
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,319 @@
+// Benchmark logic firmware trên máy Linux (env:native, shim Arduino/FreeRTOS trong native/)
+// Build & chạy: pio run -e native -t exec
+// Tham số tùy chọn: số vòng lặp mỗi phép đo (mặc định 20000)
+#include <Arduino.h>
+#include "CryptoESP.h"
+#include "ButtonHandler.h"
+#include "JsonArena.h"
+#include "PayloadCompressor.h"
+#include "EdgeAggregator.h"
+
+// Đếm số lần gọi allocator: định nghĩa lại malloc/free của glibc trong chương trình
+// nên bắt được cả cấp phát từ libstdc++ (operator new) và libmbedcrypto
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t n, size_t size);
+    void *__libc_realloc(void *ptr, size_t size);
+    void __libc_free(void *ptr);
+
+    static volatile uint64_t heapOps = 0;
+
+    void *malloc(size_t size)
+    {
+        heapOps++;
+        return __libc_malloc(size);
+    }
+    void *calloc(size_t n, size_t size)
+    {
+        heapOps++;
+        return __libc_calloc(n, size);
+    }
+    void *realloc(void *ptr, size_t size)
+    {
+        heapOps++;
+        return __libc_realloc(ptr, size);
+    }
+    void free(void *ptr)
+    {
+        if (ptr)
+            heapOps++;
+        __libc_free(ptr);
+    }
+}
+
+static int iterations = 20000;
+
+// Chặn compiler loại bỏ kết quả không dùng
+static volatile size_t sink = 0;
+
+template <typename F>
+static void bench(const char *name, F fn)
+{
+    fn(); // Làm nóng cache & cấp phát lười lần đầu
+
+    uint64_t ops0 = heapOps;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        fn();
+    auto t1 = std::chrono::steady_clock::now();
+    uint64_t ops = heapOps - ops0;
+
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+    printf("%-34s %10.1f ns/op %8.2f allocs/op\n", name, ns, (double)ops / iterations);
+}
+
+static CryptoESP device;
+static CryptoESP peer;
+
+static void benchBase64(size_t len)
+{
+    uint8_t data[256];
+    char out[((sizeof(data) + 2) / 3) * 4];
+    esp_fill_random(data, len);
+
+    char name[48];
+    snprintf(name, sizeof(name), "base64 %u B", (unsigned)len);
+    bench(name, [&] { sink = CryptoESP::base64EncodeTo(data, len, out); });
+}
+
+static void benchEncrypt(size_t len)
+{
+    char plaintext[257];
+    memset(plaintext, 'A', len);
+    plaintext[len] = '\0';
+    static char json[1024];
+    static uint8_t bin[512];
+    char name[48];
+
+    snprintf(name, sizeof(name), "encrypt binary %u B", (unsigned)len);
+    bench(name, [&] { sink = device.createBinaryPacket((const uint8_t *)plaintext, len, bin, sizeof(bin)); });
+
+    snprintf(name, sizeof(name), "encrypt+JSON buffer %u B", (unsigned)len);
+    bench(name, [&] { sink = device.createEncryptedPacket((const uint8_t *)plaintext, len, json, sizeof(json)); });
+
+    snprintf(name, sizeof(name), "encrypt+JSON String %u B", (unsigned)len);
+    bench(name, [&] { sink = device.createEncryptedPacket(plaintext).length(); });
+}
+
+static void benchJson()
+{
+    // Cùng cấu trúc gói JSON nhưng chỉ đo phần đóng gói ArduinoJson (không mã hóa)
+    static char out[512];
+    const char *cipher = "QUFBQUFBQUFBQUFBQUFBQUFBQUFBQUFBQUFBQUFBQUFBQUFBQUFBQUFBQUFBQUFBQUFBQUFBQUFBQUFBQUFBQUFB";
+    bench("JSON pack ArduinoJson", [&] {
+        DynamicJsonDocument doc(512);
+        doc["from"] = "esp32";
+        doc["ciphertext"] = cipher;
+        doc["iv"] = "AAAAAAAAAAAAAAAA";
+        doc["tag"] = "AAAAAAAAAAAAAAAAAAAAAA==";
+        doc["f"] = PACKET_FLAG_RATCHET;
+        sink = serializeJson(doc, out, sizeof(out));
+    });
+
+    bench("JSON parse key exchange reply", [&] {
+        static const char reply[] = "{\"publicKey\":\"0011223344556677\",\"sessionId\":\"0011223344556677\"}";
+        DynamicJsonDocument res(512);
+        deserializeJson(res, reply);
+        const char *pk = res["publicKey"];
+        sink = pk ? strlen(pk) : 0;
+    });
+
+    // Như firmware (performKeyExchange): JsonDocument trên arena tĩnh, không malloc
+    static JsonArena<1536> arena;
+    bench("JSON parse key exchange reply (arena)", [&] {
+        static const char reply[] = "{\"publicKey\":\"0011223344556677\",\"sessionId\":\"0011223344556677\"}";
+        JsonDocument res(&arena);
+        deserializeJson(res, reply);
+        const char *pk = res["publicKey"];
+        sink = pk ? strlen(pk) : 0;
+    });
+}
+
+// Một payload thử nén: tỉ lệ, thời gian nén / giải nén, và có bị bỏ qua (gửi nguyên bản) không
+static void benchCompressCase(const char *name, const uint8_t *data, size_t len)
+{
+    static PayloadCompressor compressor;
+    static uint8_t packed[2048];
+    static uint8_t restored[2048];
+    char label[64];
+
+    size_t packedLen = compressor.compress(data, len, packed, sizeof(packed));
+    if (!packedLen)
+    {
+        printf("%-34s %6u B -> skipped (not smaller)\n", name, (unsigned)len);
+        snprintf(label, sizeof(label), "compress try %s", name);
+        bench(label, [&] { sink = compressor.compress(data, len, packed, sizeof(packed)); });
+        return;
+    }
+    bool ok = PayloadCompressor::decompress(packed, packedLen, restored, sizeof(restored)) == len &&
+              memcmp(restored, data, len) == 0;
+    printf("%-34s %6u B -> %6u B (%.0f%%) %s\n", name, (unsigned)len, (unsigned)packedLen, 100.0 * packedLen / len,
+           ok ? "" : "(ROUND-TRIP FAILED)");
+    snprintf(label, sizeof(label), "compress %s", name);
+    bench(label, [&] { sink = compressor.compress(data, len, packed, sizeof(packed)); });
+    snprintf(label, sizeof(label), "decompress %s", name);
+    bench(label, [&] { sink = PayloadCompressor::decompress(packed, packedLen, restored, sizeof(restored)); });
+}
+
+static void benchCompress()
+{
+    // Gói đơn như firmware: [seq 4B][giờ gửi 8B] + "Data: <millis>" -> quá ngắn, luôn bỏ qua
+    uint8_t single[SEQ_HEADER_LEN + 32] = {};
+    size_t singleLen = SEQ_HEADER_LEN + snprintf((char *)single + SEQ_HEADER_LEN, 32, "Data: %lu", 123456UL);
+    benchCompressCase("single reading", single, singleLen);
+
+    // Batch 16 bản ghi (BatchBuffer): [timestamp 4B LE][len 2B LE]["Data: <millis>"]
+    uint8_t batch[SEQ_HEADER_LEN + 16 * 24] = {};
+    size_t batchLen = SEQ_HEADER_LEN;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        uint32_t ts = 1000000 + i * 30000;
+        int n = snprintf((char *)batch + batchLen + 6, 18, "Data: %lu", (unsigned long)ts);
+        memcpy(batch + batchLen, &ts, 4);
+        batch[batchLen + 4] = n;
+        batch[batchLen + 5] = 0;
+        batchLen += 6 + n;
+    }
+    benchCompressCase("batch 16 x Data", batch, batchLen);
+
+    // Batch JSON cảm biến: nhiều key lặp lại, trường hợp nén có lợi nhất
+    char json[1024];
+    size_t jsonLen = 0;
+    for (int i = 0; i < 16; i++)
+        jsonLen += snprintf(json + jsonLen, sizeof(json) - jsonLen,
+                            "{\"t\":%lu,\"temp\":%d.%d,\"hum\":%d,\"hall\":%d,\"rssi\":-%d}",
+                            1000000UL + i * 30000UL, 24 + i % 3, i % 10, 55 + i % 4, 12 - i % 5, 60 + i % 7);
+    benchCompressCase("batch 16 x JSON", (const uint8_t *)json, jsonLen);
+}
+
+// Số gói gửi trong 24 h: lấy mẫu 1 Hz qua EdgeAggregator so với 1 gói / 30 s như trước.
+// Tín hiệu giả lập: nhiệt độ phẳng + nhiễu, 6 lần đổi bậc 2 °C, 1 đỉnh Hall ngắn 3 s.
+static void benchAggregation()
+{
+    const uint32_t sampleMs = 1000;
+    const uint32_t dayMs = 24UL * 3600 * 1000;
+    EdgeAggregator agg(300000, 5000);
+    agg.addChannel("temp", 0.5f, 1);
+    agg.addChannel("hall", 10.0f, 0);
+
+    char out[112];
+    uint32_t seed = 1;
+    uint32_t bytes = 0;
+    bool spikeSeen = false;
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t now = 0; now < dayMs; now += sampleMs)
+    {
+        seed = seed * 1103515245 + 12345;
+        float noise = ((seed >> 16) % 100) / 500.0f - 0.1f; // +-0.1
+        float values[2];
+        values[0] = 24.0f + 2.0f * (now / (4 * 3600 * 1000UL)) + noise;
+        values[1] = (now >= 36000000 && now < 36003000) ? 80.0f : 12.0f + noise * 20;
+        agg.add(values, now);
+        if (agg.due(now) != AGG_NONE)
+        {
+            size_t n = agg.report(out, sizeof(out), now);
+            bytes += n;
+            if (strstr(out, ",80]") || strstr(out, ",80,"))
+                spikeSeen = true;
+        }
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    uint32_t samples = agg.samplesTotal();
+    printf("%-34s %6lu samples -> %lu reports (%lu change), %lu B, vs %lu fixed 30 s msgs %s\n",
+           "edge aggregation 24 h @1 Hz", (unsigned long)samples, (unsigned long)agg.reports(),
+           (unsigned long)agg.changeReports(), (unsigned long)bytes, (unsigned long)(dayMs / 30000),
+           spikeSeen ? "(spike reported)" : "(SPIKE LOST)");
+    printf("%-34s %10.1f ns/sample\n", "edge aggregation add+due", us * 1000 / samples);
+}
+
+static void benchRekey()
+{
+    // Thời gian NetTask bị chặn khi rekey: sinh khóa tại chỗ so với hoán đổi cặp dự phòng.
+    // Max - avg ~ jitter mà vòng lặp mạng phải chịu.
+    const int rounds = 50;
+    EcdhKeyPair pair;
+    double totalUs[2] = {0, 0};
+    double maxUs[2] = {0, 0};
+    for (int mode = 0; mode < 2; mode++)
+    {
+        for (int i = 0; i < rounds; i++)
+        {
+            if (mode == 1)
+            {
+                device.makeKeyPair(pair); // Phần này chạy ở KeygenTask, không tính
+                device.setSpareKeyPair(pair);
+            }
+            auto t0 = std::chrono::steady_clock::now();
+            device.generateNewKeys(true);
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+            totalUs[mode] += us;
+            if (us > maxUs[mode])
+                maxUs[mode] = us;
+        }
+    }
+    printf("%-34s %10.1f us avg %10.1f us max\n", "rekey inline keygen", totalUs[0] / rounds, maxUs[0]);
+    printf("%-34s %10.1f us avg %10.1f us max\n", "rekey precomputed spare", totalUs[1] / rounds, maxUs[1]);
+}
+
+static void benchButton()
+{
+    const uint8_t pin = 0;
+    ButtonHandler button(pin, 200, true);
+    button.begin();
+
+    // Tín hiệu rung liên tục: mỗi lần gọi là một cạnh, chỉ tốn phần việc của ISR
+    // (không còn task nào poll khi nút đứng yên)
+    int level = LOW;
+    bench("ButtonHandler ISR per bounce edge", [&] {
+        nativeSetPin(pin, level);
+        level = !level;
+    });
+
+    // Đưa về trạng thái nhả & bỏ sự kiện do đoạn rung ở trên sinh ra
+    ButtonEvent ev;
+    nativeSetPin(pin, HIGH);
+    while (button.waitEvent(ev, 100))
+    {
+    }
+
+    // Độ trễ từ cạnh nhấn cuối cùng tới lúc task nhận sự kiện (~ thời gian chống rung)
+    uint64_t t0 = nativeMicros64();
+    nativeSetPin(pin, LOW);
+    bool pressed = button.waitEvent(ev, 1000) && ev.type == BUTTON_PRESS;
+    uint64_t t1 = nativeMicros64();
+    bool longPress = button.waitEvent(ev, 1000) && ev.type == BUTTON_LONG_PRESS;
+    nativeSetPin(pin, HIGH);
+    printf("%-34s %10.1f ms %s\n", "ButtonHandler edge -> PRESS event", (t1 - t0) / 1000.0,
+           pressed && longPress ? "(press + long press OK)" : "(MISSING EVENT)");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1)
+        iterations = atoi(argv[1]) > 0 ? atoi(argv[1]) : iterations;
+
+    device.begin();
+    peer.begin();
+    device.setPeerPublicKeyRaw(peer.getPublicKeyRaw());
+
+    printf("%d iterations per case\n\n", iterations);
+    benchBase64(16);
+    benchBase64(64);
+    benchBase64(256);
+    printf("\n");
+    benchEncrypt(16);
+    benchEncrypt(64);
+    benchEncrypt(256);
+    printf("\n");
+    benchJson();
+    printf("\n");
+    benchCompress();
+    printf("\n");
+    benchAggregation();
+    printf("\n");
+    benchRekey();
+    printf("\n");
+    benchButton();
+    return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef BATCH_BUFFER_H
+#define BATCH_BUFFER_H
+
+#include <Arduino.h>
+
+// Dung lượng tối đa (byte) của một batch plaintext
+#ifndef BATCH_MAX_BYTES
+#define BATCH_MAX_BYTES 384
+#endif
+
+// Gom nhiều bản ghi vào một plaintext để mã hóa 1 lần (1 IV, 1 tag, 1 lần publish).
+// Mỗi bản ghi: [timestamp 4B LE][len 2B LE][data]
+class BatchBuffer
+{
+private:
+    uint8_t _buf[BATCH_MAX_BYTES];
+    size_t _size;
+    uint16_t _count;
+    uint16_t _maxRecords;    // Gửi khi đủ N bản ghi
+    uint32_t _maxAgeMs;      // Hoặc khi bản ghi đầu tiên đã chờ quá T ms
+    uint32_t _firstRecordMs; // Mốc thời gian bản ghi đầu tiên của batch
+
+public:
+    static const size_t RECORD_HEADER = 6;
+
+    BatchBuffer(uint16_t maxRecords = 10, uint32_t maxAgeMs = 60000);
+
+    // Thêm bản ghi, trả về false nếu batch không còn chỗ (cần gửi trước)
+    bool add(uint32_t timestamp, const uint8_t *data, size_t len);
+
+    // Đủ N bản ghi hoặc quá T ms kể từ bản ghi đầu tiên
+    bool isReady(uint32_t nowMs) const;
+
+    const uint8_t *data() const { return _buf; }
+    size_t size() const { return _size; }
+    uint16_t count() const { return _count; }
+    bool isEmpty() const { return _count == 0; }
+    void clear();
+};
+
+#endif
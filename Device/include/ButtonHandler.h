@@ -2,6 +2,29 @@
 #define BUTTON_HANDLER_H
 
 #include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/timers.h>
+
+// Nút nhấn theo ngắt: cạnh đầu tiên tắt ngắt của chân & chạy software timer chống rung,
+// callback của timer (timer task) bật lại ngắt, đọc mức đã ổn định rồi đẩy sự kiện vào queue. Không cần task nào
+// poll chân GPIO; task xử lý chỉ thức dậy khi có sự kiện (waitEvent).
+#ifndef BUTTON_EVENT_QUEUE_DEPTH
+#define BUTTON_EVENT_QUEUE_DEPTH 8
+#endif
+
+enum ButtonEventType : uint8_t
+{
+    BUTTON_PRESS,         // Vừa nhấn xuống (đã chống rung)
+    BUTTON_SHORT_RELEASE, // Nhả ra trước ngưỡng Long Press
+    BUTTON_LONG_PRESS     // Giữ đủ ngưỡng Long Press (báo 1 lần, không báo lúc nhả)
+};
+
+struct ButtonEvent
+{
+    ButtonEventType type;
+    uint32_t heldMs; // Thời gian đã giữ (0 với BUTTON_PRESS)
+};
 
 class ButtonHandler
 {
@@ -11,16 +34,19 @@ private:
     uint32_t _longPressTimeMs; // Thời gian quy định là Long Press
     uint32_t _debounceTimeMs;  // Thời gian chống rung (thường là 50ms)
 
-    // Biến trạng thái
-    bool _lastReading;          // Trạng thái đọc thô lần trước
-    bool _currentState;         // Trạng thái ổn định hiện tại (đã debounce)
-    uint32_t _lastDebounceTime; // Mốc thời gian bắt đầu chống rung
-    uint32_t _pressStartTime;   // Mốc thời gian bắt đầu nhấn
+    // Trạng thái, chỉ timer task ghi
+    volatile bool _pressed;   // Trạng thái ổn định hiện tại (đã debounce)
+    uint32_t _pressStartTime; // Mốc thời gian bắt đầu nhấn
+    bool _longPressTriggered; // Long Press đã báo trong lần nhấn này
 
-    // Cờ sự kiện (Flags)
-    bool _isJustPressed;      // Cờ báo: Vừa mới nhấn (One-shot)
-    bool _isLongPressed;      // Cờ báo: Đã đạt ngưỡng Long Press (One-shot)
-    bool _longPressTriggered; // Cờ khóa: Đảm bảo Long Press chỉ báo 1 lần mỗi lần nhấn
+    QueueHandle_t _events = NULL;
+    TimerHandle_t _debounceTimer = NULL; // One-shot, chạy từ cạnh đầu tiên (ngắt tắt tới khi hết giờ)
+    TimerHandle_t _longPressTimer = NULL; // One-shot, chạy từ lúc nhấn
+
+    static void IRAM_ATTR onEdge(void *arg);
+    static void onDebounce(TimerHandle_t timer);
+    static void onLongPress(TimerHandle_t timer);
+    void push(ButtonEventType type, uint32_t heldMs);
 
 public:
     // Constructor
@@ -29,17 +55,14 @@ public:
     // activeLow: true nếu nút nối đất (GND), false nếu nối nguồn (VCC)
     ButtonHandler(uint8_t pin, uint32_t longPressMs = 2000, bool activeLow = true);
 
+    // Cấu hình chân, tạo queue/timer và gắn ngắt (gọi 1 lần)
     void begin();
 
-    // Hàm này phải được gọi liên tục trong loop() hoặc Task
-    void loop();
-
-    // Kiểm tra sự kiện (Trả về true 1 lần duy nhất khi sự kiện xảy ra)
-    bool isJustPressed(); // Phát hiện ngay khi vừa nhấn xuống
-    bool isLongPressed(); // Phát hiện khi đã giữ đủ thời gian
+    // Chờ sự kiện tiếp theo tối đa `wait` tick, false nếu hết thời gian
+    bool waitEvent(ButtonEvent &event, TickType_t wait = portMAX_DELAY);
 
-    // Kiểm tra trạng thái hiện tại (Realtime)
-    bool isPressedRaw(); // Đang giữ nút?
+    // Kiểm tra trạng thái hiện tại (đã chống rung)
+    bool isPressedRaw();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,43 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <Arduino.h>
+
+// Cấu hình thiết bị: buffer cố định (kể cả '\0'), không dùng String/heap
+#define CONFIG_SSID_SIZE 33   // SSID tối đa 32 ký tự
+#define CONFIG_SECRET_SIZE 65 // WPA2 passphrase / mật khẩu MQTT tối đa 64 ký tự
+#define CONFIG_HOST_SIZE 64
+#define CONFIG_USER_SIZE 33
+#define CONFIG_URL_SIZE 128
+
+struct DeviceConfig
+{
+    char wifiSsid[CONFIG_SSID_SIZE];
+    char wifiPass[CONFIG_SECRET_SIZE];
+    char mqttServer[CONFIG_HOST_SIZE];
+    uint16_t mqttPort;
+    char mqttUser[CONFIG_USER_SIZE];
+    char mqttPass[CONFIG_SECRET_SIZE];
+    char keyUrl[CONFIG_URL_SIZE];
+};
+
+// Lưu DeviceConfig thành 1 blob duy nhất trong NVS: [version 2B][size 2B][DeviceConfig][CRC32].
+// Đọc/ghi bằng đúng 1 lệnh NVS; ghi blob của NVS là nguyên tử nên mất điện giữa chừng
+// vẫn còn nguyên bản cũ. Lần đầu chạy tự chuyển từ layout cũ (mỗi field 1 key) sang blob.
+class ConfigStore
+{
+private:
+    static uint32_t recordCrc(const void *record, size_t len);
+    // fits = false nếu có giá trị dài hơn field tương ứng (field đó giữ mặc định)
+    bool loadLegacy(DeviceConfig &config, bool &fits);
+
+public:
+    static void setDefaults(DeviceConfig &config);
+
+    // false nếu chưa có cấu hình (hoặc bản ghi hỏng), khi đó config là mặc định
+    bool load(DeviceConfig &config);
+    bool save(const DeviceConfig &config);
+    void clear();
+};
+
+#endif
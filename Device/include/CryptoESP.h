@@ -2,11 +2,65 @@
 #define CRYPTO_ESP_H
 
 #include <Arduino.h>
-#include <uECC.h>
+#include "EcdhBackend.h"
 #include <mbedtls/gcm.h>
 #include <mbedtls/md.h>
 #include <ArduinoJson.h>
 
+// Định dạng nhị phân (topic riêng), thay cho JSON/Base64:
+// [version 1B][flags 1B][idLen 1B][deviceId][sessionId 8B nếu có][IV 12B][ciphertext][tag 16B]
+// Header (version..sessionId) được xác thực như AAD của AES-GCM.
+// Gói JSON dùng đúng header này (dựng lại từ "f", "from", "sid") làm AAD, nên sửa
+// cờ hay device/session id trên đường truyền đều làm hỏng tag.
+#define BIN_PACKET_VERSION 1
+#define BIN_IV_LEN 12
+#define BIN_TAG_LEN 16
+#define SESSION_ID_LEN 8
+// Public key P-256 (X||Y, 64 byte) dạng hex + '\0'
+#define PUBLIC_KEY_HEX_SIZE 129
+#define PACKET_HEADER_MAX (3 + 255 + SESSION_ID_LEN)
+
+// Device id duy nhất: tiền tố + 6 byte MAC eFuse dạng hex (vd. "esp32-a1b2c3d4e5f6").
+// Gửi kèm khi trao đổi khóa và trong mọi gói để server tra đúng key của thiết bị.
+#ifndef DEVICE_ID_PREFIX
+#define DEVICE_ID_PREFIX "esp32-"
+#endif
+#define DEVICE_ID_LEN (sizeof(DEVICE_ID_PREFIX) - 1 + 12)
+
+// Cờ trong header gói tin (byte flags của gói nhị phân, field "f" của gói JSON)
+#define PACKET_FLAG_BATCH 0x01   // Plaintext là batch nhiều bản ghi (xem BatchBuffer.h)
+#define PACKET_FLAG_SESSION 0x02 // Header có session id (field "sid" của gói JSON), tự bật khi đã có session id
+#define PACKET_FLAG_RATCHET 0x04 // IV = epoch (4B BE) || counter (8B BE), key = key của epoch đó
+#define PACKET_FLAG_SEQ 0x08     // Plaintext bắt đầu bằng SEQ_HEADER_LEN byte: [seq 4B LE][giờ gửi 8B LE]
+// Giờ gửi là Unix ms theo SNTP, 0 nếu thiết bị chưa đồng bộ giờ
+#define SEQ_HEADER_LEN 12
+#define PACKET_FLAG_COMPRESSED 0x10 // Plaintext (kể cả header seq) đã nén (xem PayloadCompressor.h)
+
+// Nonce GCM xác định: mỗi epoch key dùng counter tăng dần từ 0, không bao giờ lặp.
+// Sau RATCHET_MAX_MESSAGES gói hoặc RATCHET_MAX_BYTES byte plaintext, thiết bị & server
+// cùng tự suy ra key epoch N+1 = HKDF-SHA256(key N, info = "CO3069 ratchet" || N+1),
+// không cần trao đổi khóa qua mạng. Đặt 0 để tắt ngưỡng tương ứng.
+#ifndef RATCHET_MAX_MESSAGES
+#define RATCHET_MAX_MESSAGES 65536UL
+#endif
+#ifndef RATCHET_MAX_BYTES
+#define RATCHET_MAX_BYTES (16UL * 1024 * 1024)
+#endif
+// Giới hạn cứng số gói của một key (kể cả khi tắt ratchet): hết thì từ chối mã hóa
+#define NONCE_COUNTER_LIMIT 0xFFFFFFFFULL
+
+// Toàn bộ trạng thái session cần để mã hóa tiếp đúng chỗ (key epoch hiện tại + counter),
+// vd. giữ trong RTC memory qua deep sleep để không phải trao đổi khóa lại khi thức dậy
+struct CryptoSessionState
+{
+    uint8_t aesKey[32];
+    uint8_t sessionId[SESSION_ID_LEN];
+    bool hasSessionId;
+    uint32_t epoch;
+    uint64_t counter;
+    uint64_t epochBytes;
+};
+
 class CryptoESP
 {
 private:
@@ -16,36 +70,123 @@ private:
     uint8_t _peerPublicKey[64]; // Laptop Public Key
     uint8_t _aesKey[32];        // Key sau khi đã qua KDF (SHA-256)
 
+    uint8_t _sessionId[SESSION_ID_LEN]; // Server cấp khi trao đổi khóa, gắn vào mỗi gói
+
+    // Cặp khóa dự phòng sinh sẵn ở nền: rekey chỉ cần hoán đổi, không chờ keygen
+    EcdhKeyPair _spare;
+    bool _hasSpare = false;
+
     bool _hasPeerKey = false;
     bool _hasSharedSecret = false;
+    bool _hasSessionId = false;
+
+    // Context AES-GCM đã nạp key (key schedule) trong computeSessionKey(),
+    // dùng lại cho mọi gói tin tới lần rekey tiếp theo
+    mbedtls_gcm_context _gcm;
 
-    // Hàm hỗ trợ RNG cho uECC
-    static int rng_wrapper(uint8_t *dest, unsigned int size);
+    EcdhBackend _ecdhBackend;
+    char _deviceId[DEVICE_ID_LEN + 1] = "";
+
+    // Trạng thái nonce / ratchet của key hiện tại
+    uint32_t _epoch = 0;
+    uint64_t _counter = 0;       // Số gói đã mã hóa trong epoch này
+    uint64_t _epochBytes = 0;    // Số byte plaintext đã mã hóa trong epoch này
+    void (*_ratchetCallback)(const uint8_t *key, uint32_t epoch) = NULL;
+
+    // Cấp nonce tiếp theo cho len byte plaintext, tự ratchet khi chạm ngưỡng
+    bool nextNonce(uint8_t *iv, size_t len);
+    // Ghi header chuẩn (version | flags | idLen | deviceId | sessionId nếu có) vào out,
+    // dùng làm AAD cho cả 2 định dạng. out cần PACKET_HEADER_MAX byte, trả về 0 nếu id quá dài.
+    size_t writeHeader(uint8_t *out, const char *deviceName, uint8_t flags);
+    bool loadKey(const uint8_t *key);
 
     // Hàm hỗ trợ Base64 nội bộ
     String base64Encode(const uint8_t *data, size_t length);
 
 public:
-    CryptoESP();
+    CryptoESP(EcdhBackend backend = (EcdhBackend)CRYPTO_ECDH_BACKEND);
+    ~CryptoESP();
+
+    // Ghi Base64 thẳng vào buffer, trả về số ký tự đã ghi (không thêm '\0')
+    static size_t base64EncodeTo(const uint8_t *data, size_t length, char *out);
+
+    // 1. Khởi tạo (đọc device id từ eFuse nếu chưa setDeviceId) và tạo Key pair mới.
+    // generateKeys = false: bỏ qua sinh khóa ECDH (vd. sẽ importSession), gọi generateNewKeys() khi cần
+    bool begin(bool generateKeys = true);
+    const char *getDeviceId() { return _deviceId; }
+    // Ghi đè device id (tối đa DEVICE_ID_LEN ký tự), vd. cho thiết bị giả lập
+    void setDeviceId(const char *id);
+    // keepSession = true: giữ session key hiện tại cho tới khi trao đổi khóa mới xong (rekey nền).
+    // Có cặp dự phòng thì dùng ngay (vài µs), không thì sinh khóa tại chỗ.
+    // Trả về true nếu đã dùng cặp dự phòng.
+    bool generateNewKeys(bool keepSession = false);
+
+    // Sinh cặp khóa mới vào pair mà không đụng trạng thái của object: gọi được từ task
+    // ưu tiên thấp mà không giữ khóa của caller trong suốt thời gian keygen
+    bool makeKeyPair(EcdhKeyPair &pair);
+    // Nạp cặp dự phòng cho lần generateNewKeys() kế tiếp (caller tự khóa như các hàm khác)
+    void setSpareKeyPair(const EcdhKeyPair &pair);
+    bool hasSpareKeyPair() { return _hasSpare; }
 
-    // 1. Khởi tạo và tạo Key pair mới
-    bool begin();
-    void generateNewKeys();
+    EcdhBackend getEcdhBackend() { return _ecdhBackend; }
 
     // 2. Các hàm Getter để lấy Key (phục vụ trao đổi HTTP)
-    String getPublicKeyHex();
+    // Ghi public key dạng hex (cả '\0') vào out, trả về số ký tự, 0 nếu outSize < PUBLIC_KEY_HEX_SIZE
+    size_t getPublicKeyHex(char *out, size_t outSize);
     const uint8_t *getPublicKeyRaw();
+    // Public key dạng nén (ECDH_COMPRESSED_KEY_LEN byte), trao đổi khóa qua MQTT
+    void getPublicKeyCompressed(uint8_t *out);
 
     // 3. Cập nhật Key của Laptop (Peer)
     bool setPeerPublicKeyHex(const char *hexString);
     bool setPeerPublicKeyRaw(const uint8_t *rawData);
+    bool setPeerPublicKeyCompressed(const uint8_t *compressed);
 
     // 4. Tính toán Shared Secret & Derive AES Key (KDF)
     bool computeSessionKey();
 
     // 5. Mã hóa & Đóng gói JSON (Tương đương việc "Sign & Encrypt")
-    // Trả về chuỗi JSON đầy đủ (ciphertext, iv, tag) để gửi đi
-    String createEncryptedPacket(const char *plaintext, const char *deviceName = "esp32");
+    // Trả về chuỗi JSON đầy đủ (ciphertext, iv, tag) để gửi đi.
+    // Cấp phát nhiều String tạm mỗi gói: chỉ giữ làm mốc so sánh trong bench/, firmware dùng bản 5b.
+    // deviceName = NULL: dùng device id của thiết bị (getDeviceId())
+    String createEncryptedPacket(const char *plaintext, const char *deviceName = NULL);
+
+    // 5b. Bản không cấp phát heap: ghi JSON vào buffer do caller cấp (outSize tính cả '\0').
+    // Dùng context GCM đã cache, mã hóa & Base64 theo từng khối trực tiếp vào out.
+    // flags khác 0 được thêm vào field "f". Trả về độ dài chuỗi JSON,
+    // 0 nếu chưa có key, lỗi, hoặc buffer không đủ.
+    size_t createEncryptedPacket(const uint8_t *plaintext, size_t len, char *out, size_t outSize,
+                                 const char *deviceName = NULL, uint8_t flags = 0);
+
+    // Kích thước buffer tối thiểu (cả '\0', tính cả session id) cho createEncryptedPacket() bản buffer
+    static size_t encryptedPacketSize(size_t plaintextLen, const char *deviceName = NULL);
+
+    // 6. Đóng gói nhị phân (không Base64/JSON), không cấp phát heap.
+    // Trả về số byte đã ghi vào out, 0 nếu chưa có key, lỗi, hoặc buffer không đủ.
+    size_t createBinaryPacket(const uint8_t *plaintext, size_t len, uint8_t *out, size_t outSize,
+                              const char *deviceName = NULL, uint8_t flags = 0);
+    // Kích thước tối đa (tính cả session id) của gói nhị phân
+    static size_t binaryPacketSize(size_t plaintextLen, const char *deviceName = NULL);
+
+    // 7. Session: id do server cấp & khôi phục session key đã lưu (bỏ qua ECDH lúc boot)
+    void setSessionId(const uint8_t *sessionId);
+    bool setSessionIdHex(const char *hexString);
+    const uint8_t *getSessionId();
+    bool hasSessionId() { return _hasSessionId; }
+    const uint8_t *getSessionKey() { return _aesKey; }
+    // epoch: epoch của aesKey đã lưu. Luôn ratchet sang epoch mới trước khi dùng để
+    // counter bắt đầu lại từ 0 mà không lặp nonce của lần chạy trước.
+    bool restoreSession(const uint8_t *aesKey, const uint8_t *sessionId, uint32_t epoch = 0);
+    // Chụp / nạp lại nguyên trạng thái session, counter tiếp tục (không ratchet).
+    // Chỉ import bản chụp mới nhất và chưa từng import: dùng lại bản cũ sẽ lặp nonce.
+    bool exportSession(CryptoSessionState *state);
+    bool importSession(const CryptoSessionState *state);
+
+    // 8. Ratchet key theo HKDF (không cần mạng)
+    bool ratchet();
+    uint32_t getEpoch() { return _epoch; }
+    // Gọi ngay sau mỗi lần ratchet, trước khi key mới được dùng (vd. để lưu vào NVS)
+    void setRatchetCallback(void (*callback)(const uint8_t *key, uint32_t epoch)) { _ratchetCallback = callback; }
 
     // Kiểm tra trạng thái
     bool isReadyToSend();
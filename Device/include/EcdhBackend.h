@@ -0,0 +1,41 @@
+#ifndef ECDH_BACKEND_H
+#define ECDH_BACKEND_H
+
+#include <Arduino.h>
+
+// Backend ECDH secp256r1. Cả hai dùng chung định dạng key thô:
+// public key 64 byte (X||Y), private key 32 byte, shared secret 32 byte (X).
+enum EcdhBackend
+{
+    ECDH_BACKEND_UECC = 0,   // micro-ecc, thuần phần mềm
+    ECDH_BACKEND_MBEDTLS = 1 // mbedtls ECP, dùng bộ tăng tốc big-number (MPI) phần cứng của ESP32
+};
+
+// Backend mặc định của CryptoESP, chọn lúc build bằng -DCRYPTO_ECDH_BACKEND=1
+#ifndef CRYPTO_ECDH_BACKEND
+#define CRYPTO_ECDH_BACKEND ECDH_BACKEND_UECC
+#endif
+
+// Cặp khóa thô (vd. cặp dự phòng sinh trước, xem CryptoESP::makeKeyPair)
+struct EcdhKeyPair
+{
+    uint8_t publicKey[64];
+    uint8_t privateKey[32];
+};
+
+const char *ecdhBackendName(EcdhBackend backend);
+
+// Tạo cặp khóa mới, trả về false nếu lỗi
+bool ecdhMakeKey(EcdhBackend backend, uint8_t *publicKey, uint8_t *privateKey);
+
+// Tính shared secret, trả về false nếu peer key không hợp lệ hoặc lỗi
+bool ecdhSharedSecret(EcdhBackend backend, const uint8_t *peerPublicKey, const uint8_t *privateKey,
+                      uint8_t *secret);
+
+// Dạng nén SEC1 của public key: 0x02/0x03 (tính chẵn lẻ của Y) || X, 33 byte
+#define ECDH_COMPRESSED_KEY_LEN 33
+void ecdhCompressPublicKey(const uint8_t *publicKey, uint8_t *compressed);
+// Khôi phục X||Y từ dạng nén (dùng micro-ecc cho cả hai backend), false nếu điểm không hợp lệ
+bool ecdhDecompressPublicKey(const uint8_t *compressed, uint8_t *publicKey);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef EDGE_AGGREGATOR_H
+#define EDGE_AGGREGATOR_H
+
+#include <Arduino.h>
+
+// Gộp mẫu cảm biến lấy ở tần số cao thành cửa sổ min/max/mean/last, chỉ báo cần gửi khi:
+//   * một kênh lệch khỏi giá trị đã gửi gần nhất quá deadband (report-on-change), hoặc
+//   * đã quá heartbeat kể từ lần gửi trước (để server biết thiết bị còn sống).
+// Lệch deadband được kiểm tra ở từng mẫu nên đỉnh ngắn trong cửa sổ không bị mất; các lần
+// gửi do thay đổi cách nhau ít nhất minIntervalMs, đỉnh giữa hai lần vẫn nằm trong min/max.
+// Không thread-safe: chỉ SampleTask dùng.
+
+#ifndef AGG_MAX_CHANNELS
+#define AGG_MAX_CHANNELS 4
+#endif
+#define AGG_NAME_LEN 8
+
+enum AggReason
+{
+    AGG_NONE,
+    AGG_CHANGE,   // Vượt deadband
+    AGG_HEARTBEAT // Hết heartbeat, giá trị không đổi
+};
+
+class EdgeAggregator
+{
+private:
+    struct Channel
+    {
+        char name[AGG_NAME_LEN];
+        float deadband;
+        uint8_t decimals; // Số chữ số thập phân khi in
+        float min;
+        float max;
+        float sum;
+        float last;
+        float reported; // last của lần gửi trước, mốc so deadband
+    };
+
+    Channel _channels[AGG_MAX_CHANNELS];
+    uint8_t _channelCount;
+    uint32_t _samples; // Số mẫu trong cửa sổ hiện tại
+    uint32_t _heartbeatMs;
+    uint32_t _minIntervalMs;
+    uint32_t _lastReportMs;
+    bool _hasReported; // Chưa gửi lần nào: mẫu đầu tiên luôn là thay đổi
+    bool _changed;     // Có kênh vượt deadband, chờ tới lượt gửi
+
+    uint32_t _samplesTotal;
+    uint32_t _reports;
+    uint32_t _changeReports;
+
+public:
+    EdgeAggregator(uint32_t heartbeatMs, uint32_t minIntervalMs = 0);
+
+    // Thêm kênh (trước mẫu đầu tiên), trả về chỉ số kênh hoặc -1 nếu đã đủ AGG_MAX_CHANNELS
+    int addChannel(const char *name, float deadband, uint8_t decimals = 1);
+    // 1 mẫu của mọi kênh, values[i] ứng với kênh i
+    void add(const float *values, uint32_t nowMs);
+    // Có cần gửi cửa sổ hiện tại không
+    AggReason due(uint32_t nowMs) const;
+    // Ghi cửa sổ hiện tại vào out rồi bắt đầu cửa sổ mới, trả về số byte (0 nếu trống / không đủ chỗ):
+    //   {"n":<số mẫu>,"why":"change"|"heartbeat","<kênh>":[min,max,mean,last],...}
+    size_t report(char *out, size_t size, uint32_t nowMs);
+
+    uint8_t channelCount() const { return _channelCount; }
+    uint32_t samplesTotal() const { return _samplesTotal; }
+    uint32_t reports() const { return _reports; }
+    uint32_t changeReports() const { return _changeReports; }
+};
+
+#endif
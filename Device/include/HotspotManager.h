@@ -6,28 +6,33 @@
 #include <ESPAsyncWebServer.h>
 #include <ArduinoJson.h>
 #include <AsyncTCP.h>
-
-// Cập nhật cấu trúc dữ liệu config
-struct ConfigData {
-    String wifi_ssid;
-    String wifi_pass;
-    String mqtt_server;
-    int    mqtt_port;
-    String mqtt_user;
-    String mqtt_pass;
-    String key_exchange_url;
-};
+#include "ConfigStore.h"
+#include "JsonArena.h"
+
+// Kích thước tối đa body JSON của POST /config (buffer cố định, lớn hơn thì trả 413)
+#ifndef HOTSPOT_BODY_MAX
+#define HOTSPOT_BODY_MAX 1024
+#endif
+// Vùng nhớ tĩnh cho JsonDocument parse body (slot + bản sao chuỗi), thay cho heap
+#ifndef HOTSPOT_JSON_ARENA_SIZE
+#define HOTSPOT_JSON_ARENA_SIZE 2048
+#endif
 
 class HotspotManager {
 private:
     AsyncWebServer _server;
     bool _dataReceived;
-    ConfigData _receivedData;
+    DeviceConfig _receivedData;
     const char* _apSSID;
     const char* _apPass;
 
-    static const char index_html[];
+    // Body POST /config đang nhận (xem handleConfigData)
+    char _body[HOTSPOT_BODY_MAX];
+    size_t _bodyLen = 0;
+    int _bodyStatus = 400; // Mã HTTP trả về khi nhận xong body
+    JsonArena<HOTSPOT_JSON_ARENA_SIZE> _jsonArena;
 
+    static bool copyField(JsonVariantConst value, char *out, size_t size);
     void handleConfigData(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total);
 
 public:
@@ -36,7 +41,8 @@ public:
     void begin();
     void stop();
     bool isDataReceived();
-    ConfigData getConfigData();
+    // Tham chiếu tới cấu hình vừa nhận (hợp lệ tới lần POST kế tiếp)
+    const DeviceConfig &getConfigData();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,95 @@
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include <ArduinoJson.h>
+
+// Allocator cho JsonDocument dùng 1 vùng nhớ tĩnh N byte thay cho heap.
+// Cấp phát kiểu bump: khối cuối được trả lại ngay, cả vùng reset khi mọi khối đã free
+// (JsonDocument bị hủy hoặc clear()). Vượt N thì trả NULL -> ArduinoJson báo NoMemory,
+// không bao giờ rơi xuống malloc nên không gây phân mảnh heap khi chạy lâu.
+// Không thread-safe: mỗi task dùng 1 arena riêng.
+template <size_t N>
+class JsonArena : public ArduinoJson::Allocator
+{
+private:
+    static const size_t ALIGN = 8; // Header mỗi khối (lưu kích thước), giữ căn lề 8 byte
+
+    alignas(8) uint8_t _buf[N];
+    size_t _used = 0;
+    size_t _peak = 0;
+    uint16_t _live = 0;
+    uint32_t _failures = 0;
+
+    static size_t roundUp(size_t n) { return (n + ALIGN - 1) & ~(ALIGN - 1); }
+    static size_t &blockSize(void *p) { return *(size_t *)((uint8_t *)p - ALIGN); }
+    size_t offsetOf(void *p) const { return (uint8_t *)p - ALIGN - _buf; }
+    bool isLast(void *p) const { return offsetOf(p) + ALIGN + roundUp(blockSize(p)) == _used; }
+
+public:
+    void *allocate(size_t size) override
+    {
+        size_t need = ALIGN + roundUp(size);
+        if (need > N - _used)
+        {
+            _failures++;
+            return NULL;
+        }
+        uint8_t *p = _buf + _used + ALIGN;
+        blockSize(p) = size;
+        _used += need;
+        _live++;
+        if (_used > _peak)
+            _peak = _used;
+        return p;
+    }
+
+    void deallocate(void *ptr) override
+    {
+        if (!ptr)
+            return;
+        if (isLast(ptr))
+            _used = offsetOf(ptr);
+        if (--_live == 0)
+            _used = 0;
+    }
+
+    void *reallocate(void *ptr, size_t newSize) override
+    {
+        if (!ptr)
+            return allocate(newSize);
+
+        // Khối cuối: co/giãn tại chỗ
+        if (isLast(ptr))
+        {
+            size_t start = offsetOf(ptr) + ALIGN;
+            if (roundUp(newSize) > N - start)
+            {
+                _failures++;
+                return NULL;
+            }
+            blockSize(ptr) = newSize;
+            _used = start + roundUp(newSize);
+            if (_used > _peak)
+                _peak = _used;
+            return ptr;
+        }
+        // Khối giữa: co thì giữ nguyên chỗ (bỏ phí phần thừa), giãn thì chép sang khối mới
+        if (newSize <= blockSize(ptr))
+            return ptr;
+        void *p = allocate(newSize);
+        if (p)
+        {
+            memcpy(p, ptr, blockSize(ptr));
+            deallocate(ptr);
+        }
+        return p;
+    }
+
+    size_t capacity() const { return N; }
+    size_t used() const { return _used; }
+    // Mức dùng cao nhất, dùng để chỉnh N cho vừa
+    size_t peak() const { return _peak; }
+    uint32_t failures() const { return _failures; }
+};
+
+#endif
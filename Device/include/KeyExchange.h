@@ -0,0 +1,43 @@
+#ifndef KEY_EXCHANGE_H
+#define KEY_EXCHANGE_H
+
+#include <Arduino.h>
+
+// Trao đổi khóa qua MQTT (request/response trên chính kết nối MQTT đang mở, không cần HTTP).
+// Thiết bị subscribe <TOPIC_KX_RES_PREFIX><device id>, publish request lên
+// <TOPIC_KX_REQ_PREFIX><device id>; backend trả lời trên topic response của đúng thiết bị.
+//
+//   Request:  [version 1B][flags 1B][reqId 2B BE][public key thiết bị]
+//   Response: [version 1B][status 1B][reqId 2B BE][sessionId 8B][public key server]
+//
+// Public key: 33 byte nén (0x02/0x03 || X) nếu bật KX_FLAG_COMPRESSED, ngược lại 64 byte X||Y.
+// Server trả key cùng định dạng với request. status khác KX_STATUS_OK thì response chỉ có 4 byte đầu.
+// reqId do thiết bị chọn và được trả lại nguyên văn, để bỏ response của request cũ.
+
+#define TOPIC_KX_REQ_PREFIX "esp32/kx/req/" // + device id
+#define TOPIC_KX_RES_PREFIX "esp32/kx/res/" // + device id
+
+#define KX_VERSION 1
+#define KX_FLAG_COMPRESSED 0x01
+#define KX_STATUS_OK 0
+#define KX_SESSION_ID_LEN 8
+#define KX_HEADER_LEN 4
+#define KX_REQUEST_MAX (KX_HEADER_LEN + 64)
+#define KX_RESPONSE_MAX (KX_HEADER_LEN + KX_SESSION_ID_LEN + 64)
+
+struct KxResponse
+{
+    uint8_t status;
+    uint16_t reqId;
+    const uint8_t *sessionId; // Trỏ vào buffer response, NULL nếu status lỗi
+    const uint8_t *publicKey;
+    size_t publicKeyLen; // 33 hoặc 64
+};
+
+// Trả về số byte đã ghi, 0 nếu buffer không đủ hoặc publicKeyLen không phải 33/64
+size_t kxEncodeRequest(uint8_t *out, size_t outSize, uint16_t reqId, const uint8_t *publicKey, size_t publicKeyLen);
+
+// false nếu sai version / độ dài
+bool kxParseResponse(const uint8_t *in, size_t len, KxResponse *res);
+
+#endif
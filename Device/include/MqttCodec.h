@@ -0,0 +1,60 @@
+#ifndef MQTT_CODEC_H
+#define MQTT_CODEC_H
+
+#include <Arduino.h>
+
+// Mã hóa / tách gói MQTT 3.1.1 trên buffer do caller cấp, không cấp phát heap
+// và không phụ thuộc transport (dùng được với WiFiClient, AsyncTCP hay socket Linux).
+// Các hàm encode trả về số byte đã ghi, 0 nếu buffer không đủ hoặc tham số sai.
+
+enum MqttPacketType
+{
+    MQTT_CONNECT = 1,
+    MQTT_CONNACK = 2,
+    MQTT_PUBLISH = 3,
+    MQTT_PUBACK = 4,
+    MQTT_SUBSCRIBE = 8,
+    MQTT_SUBACK = 9,
+    MQTT_PINGREQ = 12,
+    MQTT_PINGRESP = 13,
+    MQTT_DISCONNECT = 14
+};
+
+// Gói đã tách khỏi luồng byte: body trỏ vào buffer gốc (không copy)
+struct MqttPacket
+{
+    uint8_t type;  // MqttPacketType
+    uint8_t flags; // 4 bit thấp của byte đầu (DUP/QoS/RETAIN với PUBLISH)
+    const uint8_t *body;
+    size_t bodyLen;
+};
+
+struct MqttPublish
+{
+    const char *topic; // Không kết thúc bằng '\0'
+    size_t topicLen;
+    uint8_t qos;
+    uint16_t packetId; // 0 nếu QoS 0
+    const uint8_t *payload;
+    size_t payloadLen;
+};
+
+size_t mqttEncodeConnect(uint8_t *out, size_t outSize, const char *clientId, const char *user, const char *pass,
+                         uint16_t keepAliveSec, bool cleanSession = true);
+size_t mqttEncodePublish(uint8_t *out, size_t outSize, const char *topic, const uint8_t *payload, size_t len,
+                         uint8_t qos = 0, uint16_t packetId = 0, bool retain = false);
+size_t mqttEncodeSubscribe(uint8_t *out, size_t outSize, uint16_t packetId, const char *topic, uint8_t qos = 0);
+size_t mqttEncodePubAck(uint8_t *out, size_t outSize, uint16_t packetId);
+size_t mqttEncodePingReq(uint8_t *out, size_t outSize);
+size_t mqttEncodeDisconnect(uint8_t *out, size_t outSize);
+
+// Tách 1 gói từ đầu buf. Trả về số byte của gói, 0 nếu chưa đủ dữ liệu,
+// (size_t)-1 nếu luồng byte hỏng (remaining length sai).
+size_t mqttParse(const uint8_t *buf, size_t len, MqttPacket *pkt);
+
+bool mqttParsePublish(const MqttPacket &pkt, MqttPublish *pub);
+
+// CONNACK: trả về return code (0 = chấp nhận), -1 nếu gói sai
+int mqttConnackCode(const MqttPacket &pkt);
+
+#endif
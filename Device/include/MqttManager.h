@@ -1,35 +1,186 @@
 #ifndef MQTT_MANAGER_H
 #define MQTT_MANAGER_H
 
-#include <WiFi.h>
-#include <PubSubClient.h>
+#include <Arduino.h>
+#include <AsyncTCP.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "MqttCodec.h"
+
+// Client MQTT 3.1.1 bất đồng bộ trên AsyncTCP (mã hóa gói bằng MqttCodec).
+// Kết nối, gửi & nhận chạy trong task của AsyncTCP; publish() không bao giờ chờ mạng.
+// QoS 1: tối đa MQTT_INFLIGHT_WINDOW gói chờ PUBACK cùng lúc (pipelining, không
+// phải 1 round-trip mỗi gói); gói chưa được ack được gửi lại (DUP) sau khi reconnect.
+// Callback hoàn tất & tin nhắn đến được gọi từ loop(), tức trong task của caller.
+// Gói QoS 1 thất bại được trả lại nguyên topic + payload qua callback để caller lưu lại,
+// slot chỉ được giải phóng sau khi callback chạy xong.
+
+// Kích thước tối đa 1 gói MQTT (cả header + topic), gói lớn hơn bị từ chối ngay
+#ifndef MQTT_PACKET_SIZE
+#define MQTT_PACKET_SIZE 1024
+#endif
+// Số gói QoS 1 chờ PUBACK tối đa (mỗi slot giữ 1 bản sao gói để gửi lại)
+#ifndef MQTT_INFLIGHT_WINDOW
+#define MQTT_INFLIGHT_WINDOW 4
+#endif
+// QoS mặc định của publish() khi không chỉ định
+#ifndef MQTT_DEFAULT_QOS
+#define MQTT_DEFAULT_QOS 1
+#endif
+// Số lần gửi lại (sau mỗi lần reconnect) trước khi báo gói thất bại
+#ifndef MQTT_MAX_RESENDS
+#define MQTT_MAX_RESENDS 3
+#endif
+#ifndef MQTT_KEEPALIVE_S
+#define MQTT_KEEPALIVE_S 15
+#endif
+// Thời gian chờ TCP connect + CONNACK
+#ifndef MQTT_CONNECT_TIMEOUT_MS
+#define MQTT_CONNECT_TIMEOUT_MS 10000
+#endif
+
+// Backoff khi reconnect: tăng gấp đôi từ MIN tới MAX, có jitter ngẫu nhiên
+#ifndef MQTT_BACKOFF_MIN_MS
+#define MQTT_BACKOFF_MIN_MS 1000
+#endif
+#ifndef MQTT_BACKOFF_MAX_MS
+#define MQTT_BACKOFF_MAX_MS 60000
+#endif
+
+// Số topic tối đa được tự động subscribe lại sau khi reconnect
+#ifndef MQTT_MAX_SUBSCRIPTIONS
+#define MQTT_MAX_SUBSCRIPTIONS 4
+#endif
+#define MQTT_MAX_TOPIC_LEN 64
+
+enum MqttState
+{
+    MQTT_STATE_DISCONNECTED, // Chưa kết nối lần nào
+    MQTT_STATE_CONNECTING,   // Đang mở TCP / chờ CONNACK
+    MQTT_STATE_BACKOFF,      // Mất kết nối / thử thất bại, đang chờ tới lượt thử lại
+    MQTT_STATE_CONNECTED,
+    MQTT_STATE_STOPPED // Đã gọi disconnect(): loop() không tự kết nối lại, chờ connect()
+};
+
+// Gọi từ loop() khi gói QoS 1 được PUBACK (delivered = true) hoặc bị bỏ (false).
+// topic/payload là bản gốc đã publish, chỉ hợp lệ trong lúc callback chạy.
+typedef void (*MqttPublishCallback)(uint16_t packetId, bool delivered, const char *topic, const uint8_t *payload,
+                                    size_t len, void *ctx);
 
 class MqttManager
 {
 private:
+    struct InFlight
+    {
+        bool used;
+        bool done;      // Đã có kết quả, chờ loop() gọi callback rồi mới giải phóng slot
+        bool delivered; // Kết quả khi done
+        uint8_t resends;
+        uint16_t packetId;
+        MqttPublishCallback callback;
+        void *ctx;
+        uint16_t len;
+        uint8_t data[MQTT_PACKET_SIZE]; // Gói đã mã hóa, gửi lại nguyên văn (bật DUP)
+    };
+
     const char *_broker;
     int _port;
     const char *_user;
     const char *_pass;
     const char *_clientIdPrefix;
 
-    WiFiClient _espClient;
-    PubSubClient _client;
+    AsyncClient _client;
+    SemaphoreHandle_t _lock; // Bảo vệ mọi state dưới đây giữa task AsyncTCP và caller
+
+    // Pointer đến hàm callback tin nhắn đến
+    void (*_callbackFunc)(char *, uint8_t *, unsigned int) = NULL;
+
+    uint32_t _publishFailures = 0;
 
-    // Pointer đến hàm callback
-    void (*_callbackFunc)(char *, uint8_t *, unsigned int);
+    // State machine reconnect (không blocking)
+    volatile MqttState _state = MQTT_STATE_DISCONNECTED;
+    uint32_t _backoffMs = MQTT_BACKOFF_MIN_MS;
+    uint32_t _nextAttemptMs = 0;
+    uint32_t _connectStartMs = 0;
+    uint32_t _reconnectCount = 0;
+    bool _connectedOnce = false;
+
+    // Keepalive
+    uint32_t _lastTxMs = 0;
+    uint32_t _pingSentMs = 0; // 0 = không có PINGREQ chờ trả lời
+
+    uint16_t _nextPacketId = 1;
+    InFlight _inflight[MQTT_INFLIGHT_WINDOW];
+
+    // Luồng byte nhận (chưa đủ 1 gói) & 1 tin nhắn đến chờ loop() giao cho callback
+    uint8_t _rx[MQTT_PACKET_SIZE];
+    size_t _rxLen = 0;
+    char _inTopic[MQTT_MAX_TOPIC_LEN];
+    uint8_t _inPayload[MQTT_PACKET_SIZE];
+    size_t _inLen = 0;
+    bool _inPending = false;
+    uint32_t _inDropped = 0;
+
+    uint8_t _tx[MQTT_PACKET_SIZE];
+
+    char _topics[MQTT_MAX_SUBSCRIPTIONS][MQTT_MAX_TOPIC_LEN];
+    uint8_t _topicCount = 0;
+
+    // Các hàm *Locked yêu cầu đang giữ _lock
+    void scheduleRetry();
+    bool sendLocked(const uint8_t *data, size_t len);
+    void resubscribeLocked();
+    void resendInFlightLocked();
+    void completeLocked(InFlight &slot, bool delivered);
+    void handlePacketLocked(const MqttPacket &pkt);
+    void dropConnectionLocked(const char *reason);
+    uint16_t nextPacketIdLocked();
+    InFlight *freeSlotLocked();
+    void dispatchCompletions();
+
+    static void onTcpConnect(void *arg, AsyncClient *client);
+    static void onTcpDisconnect(void *arg, AsyncClient *client);
+    static void onTcpData(void *arg, AsyncClient *client, void *data, size_t len);
+    static void onTcpError(void *arg, AsyncClient *client, int8_t error);
 
 public:
     MqttManager(const char *broker, int port, const char *user, const char *pass);
+    ~MqttManager();
 
     void begin();
     void setCallback(void (*callback)(char *, uint8_t *, unsigned int));
+    // Không bao giờ chờ: thử kết nối khi hết backoff, keepalive, gọi các callback đang chờ
     void loop();
+    // Bắt đầu kết nối (không chờ kết quả), false nếu không mở được TCP
     bool connect();
+    // Chờ kết nối xong tối đa timeoutMs (vd. chu kỳ deep sleep), vẫn gọi loop()
+    bool waitConnected(uint32_t timeoutMs);
     bool connected();
 
+    MqttState state() const { return _state; }
+    uint32_t msUntilReconnect() const;
+    uint32_t reconnectCount() const { return _reconnectCount; }
+
+    // Publish không chờ mạng. QoS 0: true khi đã đưa vào buffer TCP.
+    // QoS 1: true khi đã nhận vào cửa sổ in-flight; kết quả cuối cùng báo qua callback.
+    // false nếu chưa kết nối, cửa sổ đầy, buffer TCP đầy hoặc gói vượt MQTT_PACKET_SIZE.
     bool publish(const char *topic, const char *payload);
+    bool publish(const char *topic, const uint8_t *payload, size_t length);
+    bool publish(const char *topic, const uint8_t *payload, size_t length, uint8_t qos,
+                 MqttPublishCallback callback = NULL, void *ctx = NULL);
+    // Đang kết nối & còn slot in-flight (publish QoS 1 sẽ được nhận)
+    bool canPublish();
+    uint8_t inFlight();
+    // Chờ mọi gói QoS 1 được ack tối đa timeoutMs (vẫn gọi loop()), vd. trước khi deep sleep
+    bool flush(uint32_t timeoutMs);
+    // Topic được ghi nhớ và subscribe lại sau mỗi lần reconnect
     bool subscribe(const char *topic);
+
+    // Gửi DISCONNECT và đóng socket (vd. trước khi deep sleep). Gói QoS 1 chưa ack báo thất bại.
+    // Sau đó không tự reconnect nữa cho tới khi gọi connect().
+    void disconnect();
+
+    uint32_t publishFailures() const { return _publishFailures; }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,105 @@
+#ifndef OFFLINE_QUEUE_H
+#define OFFLINE_QUEUE_H
+
+#include <Arduino.h>
+
+// Số slot của ring log và kích thước tối đa mỗi slot (header + topic + gói tin đã mã hóa)
+#ifndef SFQ_CAPACITY
+#define SFQ_CAPACITY 256
+#endif
+#ifndef SFQ_SLOT_SIZE
+#define SFQ_SLOT_SIZE 1024
+#endif
+// Tốc độ xả sau khi có mạng lại: tối đa N gói mỗi T ms
+#ifndef SFQ_BURST_SIZE
+#define SFQ_BURST_SIZE 5
+#endif
+#ifndef SFQ_BURST_INTERVAL_MS
+#define SFQ_BURST_INTERVAL_MS 1000
+#endif
+
+#define SFQ_MAX_TOPIC 64
+// Số gói đã xả tối đa đang chờ PUBACK (bitmask 32 bit tính từ tail)
+#define SFQ_ACK_WINDOW 32
+
+// Hàng đợi store-and-forward trên LittleFS cho các gói đã mã hóa lúc mất mạng.
+//
+// - Ring log cố định SFQ_CAPACITY slot, mỗi slot là 1 file nhỏ /sfq/<seq % SFQ_CAPACITY>.bin.
+//   Mỗi lần push ghi file tạm rồi rename đè slot cũ: LittleFS chỉ ghi đúng 1 gói
+//   (không copy-on-write lại cả ring như khi ghi giữa 1 file lớn), khi đầy thì ghi đè
+//   gói cũ nhất -> dung lượng & số lần ghi flash bị chặn.
+// - Mỗi slot mang số thứ tự (seq) + CRC32; head được dựng lại bằng cách quét seq
+//   lúc khởi động, không cần ghi con trỏ head sau mỗi gói.
+// - Tail (seq cũ nhất chưa được ack) chỉ tiến khi broker PUBACK (ack()), gói publish
+//   thất bại (nack()) được gửi lại ở đợt sau. Tail ghi xuống flash ở đầu mỗi đợt xả
+//   hoặc khi gọi commit(), qua file tạm + rename (atomic trên LittleFS).
+//   Mất điện giữa chừng chỉ gây gửi lặp, không mất gói.
+class OfflineQueue
+{
+public:
+    // seq dùng để báo lại kết quả qua ack()/nack() khi có PUBACK hoặc gói thất bại
+    typedef bool (*PublishFn)(const char *topic, const uint8_t *payload, size_t len, uint32_t seq);
+
+private:
+    struct SlotHeader
+    {
+        uint32_t magic;
+        uint32_t seq;
+        uint16_t len;     // Độ dài payload
+        uint8_t topicLen; // Độ dài topic (không có '\0')
+        uint8_t reserved;
+        uint32_t crc; // CRC32 của seq, len, topicLen, topic và payload
+    };
+
+    static const size_t SLOT_PAYLOAD = SFQ_SLOT_SIZE - sizeof(SlotHeader);
+
+    bool _ready;
+    uint32_t _head; // seq sẽ ghi tiếp theo
+    uint32_t _tail; // seq cũ nhất chưa được ack
+    uint32_t _savedTail;
+    uint32_t _sentMask;  // Bit i: seq _tail + i đã publish, đang chờ kết quả
+    uint32_t _ackedMask; // Bit i: seq _tail + i đã được ack (chờ các gói trước nó)
+    uint32_t _dropped;
+    uint32_t _corrupt;
+
+    uint16_t _burstSize;
+    uint32_t _burstIntervalMs;
+    uint32_t _lastBurstMs;
+
+    uint8_t _slotBuf[SLOT_PAYLOAD];
+
+    static uint32_t slotCrc(const SlotHeader &h, const uint8_t *body);
+    static void slotPath(char *path, size_t size, uint32_t seq);
+    bool loadTail(uint32_t &tail);
+    bool saveTail();
+    void advanceTail(uint32_t n);
+
+public:
+    OfflineQueue(uint16_t burstSize = SFQ_BURST_SIZE, uint32_t burstIntervalMs = SFQ_BURST_INTERVAL_MS);
+
+    // Mount LittleFS (format nếu cần) và dựng lại head/tail từ flash
+    bool begin();
+
+    // Ghi 1 gói vào ring log, ghi đè gói cũ nhất nếu đầy
+    bool push(const char *topic, const uint8_t *payload, size_t len);
+
+    // Xả tối đa 1 đợt (burstSize gói) nếu đã qua burstInterval kể từ đợt trước.
+    // Dừng ở gói đầu tiên publish thất bại. Trả về số gói đã gửi.
+    // Gói đã gửi vẫn nằm trong hàng đợi tới khi ack().
+    size_t drain(PublishFn publish, uint32_t nowMs);
+    // Broker đã nhận gói seq: tail tiến qua mọi gói liên tiếp đã được ack
+    void ack(uint32_t seq);
+    // Gói seq không tới được broker: gửi lại ở đợt xả sau
+    void nack(uint32_t seq);
+    // Ghi tail xuống flash nếu đã đổi (vd. trước khi deep sleep)
+    void commit();
+
+    void setDrainRate(uint16_t burstSize, uint32_t burstIntervalMs);
+
+    uint32_t size() const { return _head - _tail; }
+    bool isEmpty() const { return _head == _tail; }
+    uint32_t dropped() const { return _dropped; }
+    uint32_t corrupt() const { return _corrupt; }
+};
+
+#endif
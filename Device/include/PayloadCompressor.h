@@ -0,0 +1,34 @@
+#ifndef PAYLOAD_COMPRESSOR_H
+#define PAYLOAD_COMPRESSOR_H
+
+#include <Arduino.h>
+
+// Nén plaintext trước khi mã hóa (PACKET_FLAG_COMPRESSED), định dạng khối LZ4 chuẩn:
+//   [độ dài gốc 2B LE][LZ4 block]
+// Tham lam 1 lượt, bảng hash 2^COMPRESS_HASH_BITS vị trí (uint16_t) nằm trong object,
+// không cấp phát heap. Chỉ đáng dùng cho payload lặp lại (JSON, batch nhiều bản ghi).
+
+#ifndef COMPRESS_HASH_BITS
+#define COMPRESS_HASH_BITS 10 // 2 KB RAM
+#endif
+// Payload ngắn hơn thì không thử nén (header + token chắc chắn lớn hơn phần tiết kiệm được)
+#ifndef COMPRESS_MIN_BYTES
+#define COMPRESS_MIN_BYTES 32
+#endif
+#define COMPRESS_HEADER_LEN 2
+
+class PayloadCompressor
+{
+private:
+    uint16_t _table[1 << COMPRESS_HASH_BITS];
+
+public:
+    // Trả về số byte đã ghi vào dst (kể cả header), 0 nếu không nén được nhỏ hơn len
+    // (payload ngắn / không lặp, dst không đủ chỗ) -> caller gửi bản gốc.
+    size_t compress(const uint8_t *src, size_t len, uint8_t *dst, size_t dstSize);
+
+    // Giải nén (kiểm tra biên đầy đủ), trả về độ dài gốc, 0 nếu dữ liệu hỏng hoặc dst không đủ
+    static size_t decompress(const uint8_t *src, size_t len, uint8_t *dst, size_t dstSize);
+};
+
+#endif
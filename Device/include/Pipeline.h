@@ -0,0 +1,63 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+// Pipeline 3 tầng nối bằng FreeRTOS queue:
+//   SampleTask (lấy mẫu) -> sampleQueue -> CryptoTask (batch + mã hóa, core 1)
+//   -> publishQueue -> NetTask (WiFi/MQTT/key exchange, core 0)
+// Broker chậm hay TLS/HTTP handshake chỉ làm đầy publishQueue, không chặn lấy mẫu/mã hóa.
+
+#ifndef SAMPLE_QUEUE_DEPTH
+#define SAMPLE_QUEUE_DEPTH 16
+#endif
+#ifndef PUBLISH_QUEUE_DEPTH
+#define PUBLISH_QUEUE_DEPTH 8
+#endif
+// Thời gian tối đa CryptoTask chờ khi publishQueue đầy trước khi bỏ gói
+#ifndef PUBLISH_QUEUE_WAIT_MS
+#define PUBLISH_QUEUE_WAIT_MS 1000
+#endif
+
+#define READING_MAX_LEN 112 // Đủ cho báo cáo EdgeAggregator 2 kênh (xem EdgeAggregator.h)
+#define PACKET_MAX_LEN 768
+
+// Một bản ghi từ tầng lấy mẫu
+struct Reading
+{
+    uint32_t timestamp; // millis() lúc lấy mẫu
+    uint8_t len;
+    uint8_t data[READING_MAX_LEN];
+};
+
+// Một gói đã mã hóa chờ publish
+struct OutPacket
+{
+    const char *topic; // Trỏ tới hằng topic, không cần copy
+    uint16_t len;
+    uint8_t data[PACKET_MAX_LEN];
+};
+
+// Bộ đếm backpressure (chỉ tăng, đọc không cần khóa)
+struct PipelineStats
+{
+    volatile uint32_t samplesProduced;
+    volatile uint32_t sampleDrops; // sampleQueue đầy, bản ghi bị bỏ
+    volatile uint32_t packetsEncrypted;
+    volatile uint32_t packetDrops; // publishQueue đầy quá PUBLISH_QUEUE_WAIT_MS
+    volatile uint32_t packetsPublished;
+    volatile uint32_t packetsStored; // Chuyển vào hàng đợi flash vì đang offline
+    volatile uint32_t encryptUsLast; // Thời gian mã hóa + đóng gói gói gần nhất
+    volatile uint32_t encryptUsMax;
+    volatile uint32_t encryptUsTotal; // Chia cho packetsEncrypted để ra trung bình
+    volatile uint32_t rekeyUsLast; // NetTask bị chặn bao lâu khi đổi cặp khóa ECDH
+    volatile uint32_t rekeyUsMax;
+    volatile uint32_t netLoopUsMax; // Vòng lặp NetTask bận lâu nhất (không tính lúc chờ gói), reset mỗi lần gửi metrics
+    volatile uint32_t compressBytesIn;  // Plaintext của các gói đã nén được
+    volatile uint32_t compressBytesOut; // Kích thước sau nén của các gói đó
+    volatile uint32_t compressSkipped;  // Gói gửi nguyên bản vì nén không nhỏ hơn
+};
+
+#endif
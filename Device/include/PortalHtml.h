@@ -0,0 +1,136 @@
+// File sinh tự động bởi scripts/gen_portal.py từ web/index.html, không sửa tay.
+#ifndef PORTAL_HTML_H
+#define PORTAL_HTML_H
+
+#include <Arduino.h>
+
+// 5282 byte HTML -> 1951 byte gzip
+#define PORTAL_HTML_ETAG "\"68783552e70975c7\""
+#define PORTAL_HTML_GZ_LEN 1951
+
+static const uint8_t PORTAL_HTML_GZ[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xad, 0x58, 0x5b, 0x6f, 0xdb, 0xc8,
+    0x15, 0x7e, 0xcf, 0xaf, 0x38, 0x61, 0x10, 0x48, 0x2a, 0x24, 0xea, 0x66, 0x39, 0x8e, 0x6e, 0x05,
+    0x12, 0x27, 0x1b, 0x77, 0xb3, 0x1b, 0xb7, 0x56, 0xb6, 0xe8, 0x53, 0x30, 0x22, 0x47, 0xe4, 0xac,
+    0x29, 0x92, 0x1e, 0x0e, 0x6d, 0xab, 0x41, 0x9e, 0x8a, 0x22, 0x28, 0xda, 0x02, 0xbb, 0x28, 0x8a,
+    0xa2, 0x68, 0x17, 0xbb, 0x41, 0xb0, 0x0f, 0x2d, 0xba, 0x68, 0x1e, 0x0a, 0x14, 0xb5, 0x50, 0xf4,
+    0xc1, 0x41, 0xfe, 0x07, 0xfb, 0x0b, 0xfa, 0x13, 0x7a, 0x66, 0x78, 0x11, 0x49, 0x49, 0x76, 0xbb,
+    0x1b, 0x1a, 0xb0, 0x39, 0xc3, 0x33, 0xe7, 0x7c, 0xe7, 0x7e, 0xc6, 0xc3, 0x9b, 0xfb, 0x4f, 0xee,
+    0x4f, 0x7e, 0x72, 0xf8, 0x00, 0x6c, 0x31, 0x77, 0xc6, 0x37, 0x86, 0xf2, 0x0f, 0x38, 0xc4, 0xb5,
+    0x46, 0xda, 0x29, 0xd3, 0xe4, 0x06, 0x25, 0xe6, 0xf8, 0x06, 0xe0, 0x33, 0x9c, 0x53, 0x41, 0xc0,
+    0xb0, 0x09, 0x0f, 0xa8, 0x18, 0x69, 0x4f, 0x27, 0x0f, 0x1b, 0x7b, 0xda, 0x38, 0xd9, 0x76, 0xc9,
+    0x9c, 0xca, 0x23, 0xf4, 0xcc, 0xf7, 0xb8, 0xd0, 0xc0, 0xf0, 0x5c, 0x41, 0x5d, 0x24, 0x3b, 0x63,
+    0xa6, 0xb0, 0x47, 0x26, 0x3d, 0x65, 0x06, 0x6d, 0xa8, 0x45, 0x1d, 0x98, 0xcb, 0x04, 0x23, 0x4e,
+    0x23, 0x30, 0x88, 0x43, 0x47, 0x6d, 0xbd, 0x25, 0xd9, 0x08, 0x26, 0x1c, 0x3a, 0xbe, 0x1f, 0x5d,
+    0x7c, 0x1d, 0x82, 0x7d, 0xf9, 0x17, 0xd7, 0x86, 0x47, 0xd1, 0xf2, 0x25, 0x08, 0x3b, 0x5a, 0x7e,
+    0xee, 0x5a, 0xc3, 0x66, 0xfc, 0x3d, 0x46, 0x12, 0x88, 0x45, 0xfa, 0x2e, 0x9f, 0xef, 0xc1, 0x73,
+    0x98, 0x13, 0x6e, 0x31, 0xb7, 0x0f, 0xad, 0x01, 0xf8, 0xc4, 0x34, 0x99, 0x6b, 0xa9, 0xf7, 0xa9,
+    0x77, 0xde, 0x08, 0xd8, 0x4f, 0xd5, 0x72, 0xea, 0x71, 0x93, 0xf2, 0x06, 0x6e, 0x0d, 0xe0, 0x45,
+    0x76, 0x78, 0xea, 0x99, 0x0b, 0x3c, 0x3f, 0x43, 0xc0, 0x8d, 0x19, 0x99, 0x33, 0x67, 0xd1, 0x87,
+    0xca, 0x11, 0xb5, 0x3c, 0x0a, 0x4f, 0x0f, 0x2a, 0x75, 0x98, 0x10, 0xdb, 0x9b, 0x93, 0x3a, 0x7c,
+    0x40, 0x5d, 0x7a, 0x8a, 0x7f, 0x3f, 0xa1, 0xdc, 0x24, 0x2e, 0xbe, 0x04, 0xc4, 0x0d, 0x1a, 0x01,
+    0xe5, 0x6c, 0x86, 0x62, 0x88, 0x71, 0x6c, 0x71, 0x2f, 0x74, 0xcd, 0x3e, 0x38, 0xcc, 0xa5, 0x84,
+    0x37, 0x2c, 0x4e, 0x4c, 0x86, 0x26, 0xa8, 0xb6, 0xbb, 0x3d, 0x93, 0x5a, 0x75, 0xb8, 0xd5, 0xa6,
+    0x5d, 0xe3, 0x4e, 0x07, 0x5a, 0xb7, 0xf1, 0xbd, 0x43, 0x7a, 0x9d, 0xbb, 0x7b, 0xd0, 0x6e, 0xb5,
+    0x6e, 0xd7, 0x06, 0x30, 0x67, 0x6e, 0xc3, 0xa6, 0xcc, 0xb2, 0x45, 0x5f, 0x6e, 0x9d, 0xda, 0x03,
+    0x30, 0x59, 0xe0, 0x3b, 0x04, 0xb1, 0xcc, 0x1c, 0x8a, 0x78, 0x3f, 0x0d, 0x03, 0xc1, 0x66, 0x8b,
+    0x46, 0x62, 0xd7, 0x3e, 0x18, 0xf8, 0x9b, 0xf2, 0x01, 0x10, 0x87, 0x59, 0x6e, 0x83, 0x09, 0x3a,
+    0x0f, 0x56, 0x9b, 0x99, 0x05, 0x3a, 0x2d, 0x1f, 0x0f, 0x1b, 0x9e, 0xe3, 0xf1, 0x3e, 0xdc, 0xea,
+    0x76, 0xbb, 0x79, 0xcd, 0x75, 0xc9, 0x8c, 0x20, 0x5a, 0x8e, 0xfa, 0xe7, 0x35, 0xe0, 0xd6, 0x94,
+    0x54, 0x3b, 0xbd, 0x5e, 0x1d, 0x56, 0xbf, 0x5a, 0xfa, 0xdd, 0x5e, 0x2d, 0xc7, 0xb9, 0xab, 0x38,
+    0x27, 0x26, 0x95, 0xaa, 0x86, 0x28, 0xbf, 0xdd, 0x8b, 0x37, 0xd1, 0xe6, 0x36, 0x31, 0xbd, 0x33,
+    0x74, 0x01, 0xea, 0xe3, 0x9f, 0x2b, 0xea, 0x98, 0x6d, 0xab, 0xae, 0x7e, 0xf4, 0x2e, 0x32, 0x53,
+    0xe1, 0xa0, 0x34, 0xbe, 0x8d, 0x36, 0x20, 0xe7, 0x8d, 0x64, 0x63, 0xa7, 0xa7, 0x98, 0xaf, 0x90,
+    0xda, 0x1d, 0x44, 0x28, 0xe8, 0xb9, 0x68, 0x28, 0x75, 0x57, 0x8a, 0xa6, 0x9a, 0xc5, 0xa6, 0x1d,
+    0x24, 0x51, 0x80, 0x2e, 0x16, 0xc2, 0x9b, 0xa7, 0xea, 0x67, 0x7e, 0x4f, 0x36, 0x11, 0x4a, 0xe0,
+    0x39, 0xcc, 0x84, 0x5b, 0x94, 0xd2, 0x4c, 0xa5, 0xec, 0x7b, 0xbb, 0x24, 0x5c, 0x97, 0x66, 0xf1,
+    0x1b, 0x2a, 0xfe, 0xd2, 0x40, 0xc1, 0x90, 0xa2, 0x48, 0xb9, 0x93, 0xb7, 0xee, 0xee, 0xee, 0x6e,
+    0x06, 0x40, 0x78, 0x7e, 0x6a, 0x8d, 0x12, 0x24, 0xb5, 0xa7, 0x54, 0x11, 0x1c, 0x03, 0x68, 0xe6,
+    0x71, 0xdc, 0x0c, 0x7d, 0x9f, 0x72, 0x83, 0x04, 0x88, 0x46, 0xb1, 0x3f, 0x4b, 0x62, 0x61, 0xea,
+    0x39, 0x66, 0x86, 0xdf, 0xa1, 0x33, 0xdc, 0xea, 0xae, 0xd0, 0xa7, 0x4a, 0xa7, 0x0a, 0xc4, 0x04,
+    0x7b, 0x25, 0xf4, 0x52, 0x42, 0x43, 0xa9, 0x90, 0x65, 0xc9, 0x4a, 0xd5, 0x4e, 0x91, 0xd8, 0x21,
+    0x53, 0xea, 0x20, 0x59, 0x16, 0x7c, 0x53, 0xc7, 0x33, 0x8e, 0x4b, 0xa0, 0x76, 0x5b, 0xad, 0xcd,
+    0x5a, 0xe5, 0x2d, 0xd3, 0x2d, 0x32, 0x66, 0xae, 0x1f, 0x0a, 0x64, 0x5c, 0xf0, 0x78, 0x16, 0x4b,
+    0xed, 0x9c, 0x9b, 0x70, 0xb5, 0xd2, 0xd0, 0x30, 0x8c, 0xb5, 0x18, 0xdb, 0x2d, 0x8b, 0x52, 0x4e,
+    0x50, 0xc6, 0xc4, 0xaa, 0xe2, 0xc9, 0x12, 0xa0, 0x77, 0x83, 0x35, 0xe1, 0xfd, 0x99, 0x67, 0x84,
+    0x81, 0x0c, 0xf4, 0x98, 0x5d, 0x39, 0x72, 0xbc, 0x50, 0xc8, 0xc4, 0xed, 0x83, 0xeb, 0xb9, 0xb4,
+    0x1c, 0xc3, 0x2d, 0xa9, 0x60, 0x1c, 0xbf, 0xdd, 0x56, 0x7d, 0xb7, 0x55, 0x6f, 0xb7, 0x77, 0x92,
+    0x18, 0xce, 0x15, 0x92, 0x10, 0x6d, 0xe1, 0x6e, 0x57, 0x52, 0xd9, 0x3a, 0x9f, 0x66, 0x99, 0xec,
+    0x04, 0xcb, 0x99, 0x8d, 0x69, 0xbc, 0xb2, 0x43, 0x0a, 0xe4, 0x6a, 0xed, 0x57, 0x1b, 0xc5, 0xa0,
+    0x31, 0x42, 0x1e, 0x48, 0xa6, 0xbe, 0xc7, 0xe2, 0x54, 0xc9, 0x47, 0x66, 0x9c, 0x17, 0x57, 0xd9,
+    0x2c, 0x56, 0xa6, 0x6f, 0x7b, 0xa7, 0x6b, 0xd5, 0x21, 0xa9, 0x5d, 0x85, 0x20, 0x9b, 0xd3, 0x20,
+    0x20, 0x16, 0x5d, 0x45, 0x58, 0x2e, 0x01, 0x36, 0xba, 0xb9, 0xa8, 0xd0, 0xa6, 0xd4, 0xce, 0x62,
+    0x30, 0xb6, 0xc3, 0x9a, 0xc7, 0x73, 0xd2, 0x83, 0xd0, 0x30, 0x10, 0x40, 0x19, 0xa7, 0xb9, 0x43,
+    0x4d, 0x93, 0xe4, 0x8a, 0x44, 0xaf, 0x77, 0xa7, 0xb3, 0xb3, 0x39, 0xd0, 0xba, 0x74, 0xd7, 0x98,
+    0x16, 0x98, 0x52, 0xce, 0xbd, 0x35, 0xd5, 0x67, 0x7b, 0xe6, 0x9d, 0x3c, 0xcb, 0x3b, 0x9d, 0xb6,
+    0xb1, 0x85, 0xe5, 0xac, 0x67, 0xe4, 0x58, 0x0e, 0x9b, 0x49, 0xcf, 0x1a, 0x36, 0xe3, 0x8e, 0x3a,
+    0x94, 0x7d, 0x27, 0x69, 0x67, 0x26, 0x3b, 0x05, 0xc3, 0x21, 0x41, 0x30, 0xd2, 0xb2, 0x92, 0xac,
+    0xad, 0xda, 0xdb, 0xd0, 0xee, 0x8c, 0xff, 0xf3, 0xe5, 0x6f, 0x5e, 0xc1, 0xc4, 0x66, 0xd1, 0xc5,
+    0xbf, 0x04, 0x38, 0xd1, 0xc5, 0x37, 0x7e, 0xb6, 0x9a, 0x46, 0xcb, 0x5f, 0x22, 0xd7, 0x4e, 0xee,
+    0x80, 0xcc, 0x79, 0x60, 0xa6, 0x62, 0x37, 0x63, 0xd6, 0x43, 0x5c, 0xe6, 0xf8, 0xc9, 0xa7, 0xb0,
+    0xc8, 0x03, 0xc8, 0x15, 0x3b, 0x6d, 0xfc, 0xa1, 0x12, 0xe0, 0x62, 0x07, 0x66, 0xf0, 0x63, 0xf6,
+    0x90, 0x0d, 0x9b, 0x48, 0x39, 0xde, 0x7a, 0x76, 0x55, 0x6a, 0xb4, 0xf1, 0x30, 0x4e, 0x79, 0xb1,
+    0xf0, 0x71, 0x2e, 0x90, 0xfe, 0xd5, 0x14, 0xa0, 0x33, 0x36, 0x63, 0xcf, 0x82, 0x80, 0x99, 0x1a,
+    0xa0, 0x77, 0x0d, 0x6a, 0x63, 0xb0, 0x52, 0x3e, 0xd2, 0x26, 0x97, 0x7f, 0x76, 0x95, 0x08, 0xa8,
+    0x1e, 0x1d, 0x1d, 0xec, 0xd7, 0x34, 0xe0, 0xf4, 0x24, 0x64, 0x9c, 0x9a, 0xe3, 0x6f, 0x2b, 0xd4,
+    0xc7, 0xcf, 0x67, 0xe8, 0x97, 0x9c, 0x60, 0xb9, 0x55, 0x12, 0xfc, 0x11, 0xda, 0x52, 0xc0, 0xb1,
+    0x1d, 0x5d, 0xfc, 0x29, 0x54, 0x00, 0xb4, 0x54, 0xe0, 0xff, 0x66, 0xa2, 0xfc, 0xc0, 0xf2, 0xd1,
+    0x0f, 0x27, 0x13, 0xb8, 0xc7, 0xbd, 0x63, 0xca, 0xbf, 0xbb, 0xa5, 0xe6, 0x27, 0x42, 0x3c, 0xc3,
+    0xf1, 0x02, 0x13, 0xb0, 0x04, 0xf9, 0xed, 0x67, 0xe8, 0x71, 0x39, 0x89, 0x45, 0xcb, 0x5f, 0xc0,
+    0xc1, 0x61, 0x22, 0x11, 0xaa, 0x9f, 0xec, 0x63, 0x00, 0xde, 0xed, 0xe8, 0xed, 0xdd, 0x3d, 0xbd,
+    0xad, 0xb7, 0x5b, 0xef, 0xc3, 0x88, 0x6e, 0x38, 0x9f, 0x4a, 0x00, 0x19, 0xa2, 0x78, 0xbc, 0x2b,
+    0xe0, 0x39, 0xc4, 0x2d, 0xa8, 0xa2, 0x21, 0xff, 0x6e, 0xc0, 0xdb, 0xcf, 0x11, 0x9b, 0x2b, 0xab,
+    0xdf, 0xde, 0x5e, 0x17, 0x01, 0x9c, 0x12, 0x27, 0x44, 0x36, 0x72, 0xf5, 0x1e, 0xd0, 0x94, 0xac,
+    0x13, 0x06, 0x6b, 0xb6, 0x51, 0x2e, 0x78, 0x8a, 0xfb, 0x72, 0x20, 0xd5, 0xde, 0x53, 0xec, 0xc4,
+    0x8a, 0x6f, 0x88, 0x1d, 0x29, 0xec, 0x30, 0x25, 0xfd, 0xff, 0xe2, 0xe6, 0x5e, 0x74, 0xf1, 0xda,
+    0x83, 0xb9, 0x8a, 0xbe, 0xea, 0x87, 0x74, 0x01, 0x0f, 0xce, 0x71, 0xb4, 0x76, 0x2d, 0x5a, 0xfb,
+    0xee, 0xc6, 0x39, 0xa6, 0x8b, 0x67, 0x21, 0x77, 0x4a, 0x68, 0x9f, 0xfe, 0xe8, 0xb1, 0xac, 0x1c,
+    0x5f, 0x2f, 0x40, 0x8a, 0x3b, 0x09, 0x09, 0x3c, 0x9a, 0x4c, 0x0e, 0xa1, 0x2a, 0x2e, 0xff, 0xb1,
+    0x50, 0xc1, 0xf4, 0x6b, 0xb7, 0xae, 0xfc, 0xf7, 0x33, 0xec, 0x0c, 0x6a, 0xe8, 0x86, 0x91, 0xec,
+    0x11, 0x9e, 0xda, 0xfc, 0x2d, 0x53, 0x47, 0xa4, 0xca, 0xb5, 0x2d, 0xaa, 0x26, 0x0d, 0x30, 0x46,
+    0x13, 0x84, 0xd3, 0x39, 0x13, 0xda, 0xf8, 0xf1, 0xbb, 0x37, 0x21, 0xc4, 0x49, 0xf2, 0x48, 0x26,
+    0xc9, 0xb0, 0x19, 0x93, 0xe5, 0xaa, 0x55, 0x53, 0xaa, 0x94, 0x5b, 0x4b, 0x65, 0x95, 0xd9, 0xe3,
+    0xa6, 0xa2, 0xa5, 0x9a, 0xa7, 0xeb, 0xbc, 0x57, 0xf3, 0xaf, 0x81, 0xc1, 0x99, 0x2f, 0x56, 0x8c,
+    0x4c, 0xec, 0xf8, 0x73, 0xec, 0x26, 0xba, 0x45, 0xc5, 0x03, 0x87, 0xca, 0xd7, 0x7b, 0x8b, 0x03,
+    0xb3, 0x5a, 0x59, 0x55, 0xc5, 0x4a, 0x4d, 0xc7, 0xee, 0xf4, 0xe0, 0x14, 0x3f, 0x3d, 0x66, 0x01,
+    0x4e, 0xd6, 0x94, 0x57, 0x2b, 0x31, 0x74, 0x1c, 0xfd, 0x67, 0xa1, 0x6b, 0xc8, 0xf6, 0x58, 0xa5,
+    0x35, 0x78, 0x5e, 0xd0, 0x95, 0xea, 0x3e, 0xa7, 0xf2, 0xd4, 0x3e, 0x9d, 0x91, 0xd0, 0x11, 0xd5,
+    0xda, 0xa0, 0xf0, 0x1d, 0x25, 0x04, 0x58, 0x99, 0x85, 0x8b, 0x26, 0xcc, 0x60, 0x9c, 0x84, 0x94,
+    0x2f, 0x8e, 0xa8, 0x43, 0x0d, 0xe1, 0xa1, 0x98, 0xd8, 0x0e, 0x95, 0xd2, 0x49, 0x3c, 0xa3, 0x4b,
+    0x4f, 0xde, 0x8f, 0x07, 0x7d, 0x3c, 0x8f, 0xf9, 0x8e, 0x71, 0x01, 0x0e, 0x1a, 0x52, 0xd7, 0x75,
+    0x6d, 0xa0, 0x48, 0xb0, 0x3b, 0x92, 0xa9, 0x43, 0x4d, 0xe5, 0xa2, 0x90, 0x0e, 0x6e, 0x6c, 0x10,
+    0x6f, 0x12, 0xbc, 0x98, 0x8d, 0x4a, 0xc8, 0xe5, 0x93, 0x15, 0xe1, 0xfe, 0x76, 0x1b, 0x65, 0x34,
+    0x68, 0x22, 0x95, 0xc4, 0xf5, 0xcd, 0x6c, 0x64, 0x5a, 0x5c, 0xc7, 0x46, 0xd2, 0x6c, 0x67, 0x93,
+    0x2b, 0x74, 0x57, 0x30, 0xca, 0x51, 0x5d, 0xc3, 0x4a, 0x56, 0x28, 0x9c, 0x7b, 0xe4, 0x35, 0xf5,
+    0x00, 0xaf, 0x5f, 0x57, 0x73, 0x94, 0xc4, 0x29, 0xbf, 0xda, 0x16, 0x86, 0xb2, 0xcc, 0x5c, 0x87,
+    0x4c, 0xd2, 0x5c, 0x87, 0xeb, 0x6a, 0x4b, 0x65, 0x34, 0xdb, 0xd9, 0x24, 0x79, 0x7d, 0x05, 0x93,
+    0x84, 0x22, 0x65, 0x51, 0xe0, 0xf0, 0xa2, 0x14, 0x24, 0x33, 0x2a, 0x0c, 0xbb, 0x5a, 0x69, 0xc6,
+    0xd9, 0x80, 0xe1, 0xbe, 0x1e, 0x28, 0x78, 0xb5, 0xb7, 0x3d, 0x8c, 0x92, 0xca, 0xe1, 0x93, 0xa3,
+    0x09, 0x52, 0xc8, 0xd1, 0x85, 0x72, 0xd4, 0xe2, 0x79, 0x25, 0x89, 0xcf, 0xc6, 0x04, 0xb3, 0xbd,
+    0x82, 0x14, 0xc4, 0xf7, 0x1d, 0x66, 0x10, 0x99, 0x2e, 0xcd, 0x4f, 0x03, 0x8c, 0xeb, 0x17, 0x75,
+    0x75, 0xb5, 0xee, 0xc3, 0x0f, 0x8e, 0x9e, 0x7c, 0xac, 0x07, 0x82, 0xe3, 0x0c, 0x88, 0x37, 0xd8,
+    0xaa, 0x8c, 0xca, 0x5a, 0x11, 0x58, 0x71, 0xa9, 0x0b, 0x9b, 0xba, 0x55, 0x0e, 0xa3, 0xf1, 0x06,
+    0x44, 0x71, 0x64, 0xcf, 0x03, 0x2b, 0x9f, 0x58, 0x6b, 0xa6, 0x8c, 0x0b, 0x45, 0x39, 0xb5, 0x94,
+    0x46, 0x81, 0xa5, 0xab, 0x49, 0x4c, 0x4f, 0xe6, 0x4b, 0xe4, 0x53, 0x51, 0xb7, 0x9c, 0xca, 0x3a,
+    0x31, 0x9b, 0x41, 0x95, 0xeb, 0xde, 0x71, 0x6d, 0x03, 0x90, 0x94, 0x59, 0x31, 0x57, 0x2b, 0xff,
+    0xfe, 0xe3, 0xcf, 0xe1, 0xed, 0x67, 0x97, 0xaf, 0x55, 0xba, 0x82, 0xb0, 0x2f, 0xbf, 0xc2, 0xb9,
+    0xc0, 0xb8, 0xfc, 0x9b, 0x6b, 0xdd, 0x2c, 0x0c, 0x6c, 0x10, 0x44, 0x17, 0xff, 0x94, 0x63, 0xc7,
+    0xf2, 0x4b, 0xa6, 0xea, 0xeb, 0xef, 0x65, 0x8a, 0x47, 0x17, 0xaf, 0x98, 0xbe, 0x01, 0x48, 0x2a,
+    0x4c, 0x15, 0xc2, 0x8f, 0xb1, 0xb3, 0x49, 0x51, 0xe9, 0xcc, 0x9d, 0x4c, 0xbf, 0x5b, 0x8e, 0x71,
+    0x2a, 0x42, 0xee, 0xae, 0x7f, 0x7b, 0xb1, 0xb6, 0xd3, 0x6c, 0xc2, 0x4e, 0xab, 0x15, 0xfb, 0x0b,
+    0x02, 0xc2, 0xa0, 0x89, 0xf8, 0x25, 0x62, 0xd4, 0x83, 0xbf, 0x7b, 0x13, 0x2d, 0xbf, 0x40, 0x88,
+    0xcd, 0xdc, 0xfb, 0x49, 0x78, 0xf9, 0x0a, 0xcc, 0xcb, 0xaf, 0x58, 0x1d, 0x76, 0xda, 0xdd, 0x7e,
+    0xfc, 0x9f, 0x14, 0xb5, 0xe9, 0x44, 0xcb, 0x3f, 0xb8, 0x37, 0xae, 0x37, 0x17, 0x47, 0x5f, 0x10,
+    0x81, 0xd7, 0xb2, 0xd1, 0x68, 0x24, 0x79, 0x6c, 0xd4, 0xe0, 0xfb, 0x68, 0xd5, 0x2f, 0x7e, 0x05,
+    0xfb, 0xd1, 0xf2, 0xaf, 0xe0, 0xb0, 0x68, 0xf9, 0x32, 0xcc, 0x09, 0xa9, 0x63, 0xe7, 0x7a, 0xf7,
+    0x86, 0xc4, 0xd5, 0xb1, 0xb2, 0xf1, 0x7c, 0x3f, 0x3e, 0x9f, 0x1f, 0xd4, 0x8e, 0x6d, 0xe9, 0x11,
+    0x40, 0xeb, 0xbf, 0xf6, 0x25, 0x9f, 0x97, 0xd8, 0x05, 0xd7, 0x54, 0xb5, 0x3d, 0x35, 0xd1, 0x64,
+    0x5a, 0xd6, 0x8a, 0xb2, 0x36, 0xc7, 0xd6, 0x46, 0x0f, 0xa9, 0xab, 0xc4, 0x86, 0x03, 0x1b, 0x6a,
+    0x7d, 0xb9, 0x5d, 0xae, 0x97, 0xfb, 0x19, 0x71, 0x02, 0x3a, 0xb8, 0x32, 0x81, 0x30, 0x0d, 0x31,
+    0xb3, 0x51, 0xea, 0xe6, 0x1c, 0x7a, 0x5f, 0x62, 0xe5, 0x43, 0x1c, 0xca, 0x45, 0x55, 0x7b, 0x1c,
+    0x2d, 0x7f, 0xc7, 0xd0, 0xac, 0x0c, 0xac, 0x68, 0xf9, 0x0d, 0x03, 0x73, 0xe5, 0xac, 0x9b, 0x5a,
+    0xad, 0x8c, 0x76, 0xb5, 0x4e, 0xdf, 0xf1, 0x7a, 0x94, 0x34, 0x6f, 0x9c, 0x0f, 0xd4, 0xc5, 0x08,
+    0x6f, 0x34, 0xea, 0x3f, 0x92, 0xff, 0x05, 0x98, 0x74, 0x61, 0x7e, 0xa2, 0x14, 0x00, 0x00,
+};
+
+#endif
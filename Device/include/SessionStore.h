@@ -0,0 +1,42 @@
+#ifndef SESSION_STORE_H
+#define SESSION_STORE_H
+
+#include <Arduino.h>
+#include "CryptoESP.h"
+
+// Lưu session key + session id để thiết bị gửi được ngay sau khi reboot,
+// không phải chờ ECDH + HTTP.
+//
+// Bản ghi nằm trong partition NVS riêng (SESSION_NVS_PARTITION) được mã hóa bằng
+// NVS Encryption: key XTS nằm trong partition nvs_keys, partition này lại được
+// Flash Encryption mã hóa bằng key trong eFuse (không đọc ra được). Dump flash
+// sang máy khác không khôi phục được session key.
+// Chỉ hoạt động khi chip đã bật Flash Encryption và partition table có nvs_keys +
+// SESSION_NVS_PARTITION (xem partitions_session.csv, env esp-wrover-kit-session);
+// nếu không, save()/load() luôn trả về false và thiết bị trao đổi khóa như bình thường.
+#ifndef SESSION_NVS_PARTITION
+#define SESSION_NVS_PARTITION "nvs_sess"
+#endif
+
+class SessionStore
+{
+private:
+    enum State : uint8_t
+    {
+        STORE_UNINIT,
+        STORE_READY,
+        STORE_UNAVAILABLE
+    };
+    State _state = STORE_UNINIT;
+
+    // Khởi tạo partition mã hóa ở lần dùng đầu tiên
+    bool open();
+
+public:
+    // aesKey là key của epoch hiện tại (xem CryptoESP::ratchet), không phải key gốc
+    bool save(const uint8_t *aesKey, const uint8_t *sessionId, uint32_t epoch);
+    bool load(uint8_t *aesKey, uint8_t *sessionId, uint32_t *epoch);
+    void clear();
+};
+
+#endif
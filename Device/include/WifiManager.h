@@ -0,0 +1,93 @@
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+// Kết nối nhanh: nhớ BSSID, kênh và IP (lease DHCP gần nhất hoặc IP tĩnh cấu hình sẵn)
+// của lần kết nối thành công vào NVS. Lần sau WiFi.begin() nhắm thẳng AP/kênh đó
+// (bỏ quét toàn bộ kênh) và dùng lại IP (bỏ DHCP). Thất bại thì quay về quét đầy đủ + DHCP.
+#ifndef WIFI_FAST_TIMEOUT_MS
+#define WIFI_FAST_TIMEOUT_MS 4000
+#endif
+#ifndef WIFI_SCAN_TIMEOUT_MS
+#define WIFI_SCAN_TIMEOUT_MS 10000
+#endif
+// 1 = dùng lại lease DHCP đã nhớ. Chỉ tắt nếu router hay cấp lại IP khác cho thiết bị
+#ifndef WIFI_REUSE_LEASE
+#define WIFI_REUSE_LEASE 1
+#endif
+// Dùng lại lease tối đa N lần liên tiếp rồi chạy DHCP 1 lần để gia hạn: lease thật có
+// hạn, hết hạn thì router có thể cấp IP đó cho máy khác. Bộ đếm nằm trong RTC memory,
+// nên sau khi mất nguồn / reset cứng lần kết nối đầu tiên luôn chạy DHCP.
+#ifndef WIFI_LEASE_MAX_REUSES
+#define WIFI_LEASE_MAX_REUSES 60
+#endif
+// IP tĩnh (ưu tiên hơn lease đã nhớ), "" = dùng DHCP
+#ifndef WIFI_STATIC_IP
+#define WIFI_STATIC_IP ""
+#endif
+#ifndef WIFI_STATIC_GATEWAY
+#define WIFI_STATIC_GATEWAY ""
+#endif
+#ifndef WIFI_STATIC_SUBNET
+#define WIFI_STATIC_SUBNET "255.255.255.0"
+#endif
+#ifndef WIFI_STATIC_DNS
+#define WIFI_STATIC_DNS ""
+#endif
+
+// Bản ghi trong NVS, gắn với SSID (đổi SSID thì cache tự hết hiệu lực)
+struct WifiCache
+{
+    uint8_t version;
+    uint8_t channel;
+    uint8_t bssid[6];
+    uint32_t ssidHash;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+};
+
+// Thời gian các pha của lần kết nối gần nhất (ms)
+struct WifiTimings
+{
+    uint32_t associateMs; // WiFi.begin() -> liên kết được với AP
+    uint32_t ipMs;        // Liên kết -> có IP (≈0 khi dùng IP tĩnh / lease đã nhớ)
+    uint32_t totalMs;     // Cả lần connect(), gồm lần thử nhanh thất bại nếu có
+    bool fast;            // Thành công bằng đường nhanh
+};
+
+class WifiManager
+{
+private:
+    const char *_ssid = NULL;
+    const char *_pass = NULL;
+    WifiCache _cache;
+    bool _cacheValid = false;
+    WifiTimings _timings = {};
+
+    static volatile uint32_t _associatedAt;
+    static volatile uint32_t _gotIpAt;
+    static void onEvent(arduino_event_id_t event);
+
+    static uint32_t hashSsid(const char *ssid);
+    void loadCache();
+    void saveCache();
+    bool staticConfig(IPAddress &ip, IPAddress &gateway, IPAddress &subnet, IPAddress &dns);
+    // Chờ có IP, trả về false khi hết thời gian hoặc abortFn() báo dừng
+    bool waitConnected(uint32_t startMs, uint32_t timeoutMs, bool (*abortFn)());
+
+public:
+    void begin(const char *ssid, const char *pass);
+    // Blocking tối đa WIFI_FAST_TIMEOUT_MS + WIFI_SCAN_TIMEOUT_MS; abortFn (có thể NULL)
+    // được gọi trong lúc chờ để thoát sớm (vd. người dùng chuyển sang chế độ cấu hình)
+    bool connect(bool (*abortFn)() = NULL);
+    // Xóa cache (vd. khi đổi cấu hình WiFi)
+    void forget();
+
+    const WifiTimings &timings() const { return _timings; }
+};
+
+#endif
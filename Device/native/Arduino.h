@@ -0,0 +1,315 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// Shim Arduino-ESP32 tối thiểu để build logic firmware trên Linux (env:native).
+// Chỉ có đúng phần API mà CryptoESP, EcdhBackend, ButtonHandler, BatchBuffer dùng.
+// Thời gian lấy từ steady_clock; chân GPIO là mảng giả lập (nativeSetPin),
+// đổi mức qua nativeSetPin() gọi ngắt đã attach ngay trên thread gọi (như một ISR).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define HEX 16
+#define DEC 10
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define PROGMEM
+
+// ---------- Thời gian ----------
+
+inline uint64_t nativeMicros64()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline uint32_t millis() { return (uint32_t)(nativeMicros64() / 1000); }
+inline uint32_t micros() { return (uint32_t)nativeMicros64(); }
+inline void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void yield() { std::this_thread::yield(); }
+
+// ---------- Ngẫu nhiên ----------
+
+inline void esp_fill_random(void *buf, size_t len)
+{
+    static thread_local std::random_device rd;
+    uint8_t *p = (uint8_t *)buf;
+    for (size_t i = 0; i < len; i++)
+        p[i] = (uint8_t)rd();
+}
+
+inline uint32_t esp_random()
+{
+    uint32_t v;
+    esp_fill_random(&v, sizeof(v));
+    return v;
+}
+
+inline long random(long howbig) { return howbig > 0 ? (long)(esp_random() % (uint32_t)howbig) : 0; }
+inline long random(long howsmall, long howbig) { return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall); }
+
+// ---------- GPIO giả lập ----------
+
+inline uint8_t *nativePins()
+{
+    static uint8_t pins[64];
+    return pins;
+}
+
+struct NativeInterrupt
+{
+    void (*handler)(void *);
+    void *arg;
+    int mode;
+};
+
+inline NativeInterrupt *nativeInterrupts()
+{
+    static NativeInterrupt isr[64];
+    return isr;
+}
+
+inline void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode)
+{
+    nativeInterrupts()[pin & 63] = {handler, arg, mode};
+}
+inline void detachInterrupt(uint8_t pin) { nativeInterrupts()[pin & 63] = {NULL, NULL, 0}; }
+
+inline void nativeSetPin(uint8_t pin, int level)
+{
+    uint8_t &current = nativePins()[pin & 63];
+    uint8_t next = level ? HIGH : LOW;
+    if (current == next)
+        return;
+    current = next;
+
+    const NativeInterrupt &isr = nativeInterrupts()[pin & 63];
+    if (isr.handler && (isr.mode == CHANGE || isr.mode == (next ? RISING : FALLING)))
+        isr.handler(isr.arg);
+}
+inline void pinMode(uint8_t pin, uint8_t mode)
+{
+    if (mode == INPUT_PULLUP)
+        nativePins()[pin & 63] = HIGH;
+}
+inline int digitalRead(uint8_t pin) { return nativePins()[pin & 63]; }
+inline void digitalWrite(uint8_t pin, uint8_t val) { nativeSetPin(pin, val); }
+
+// ---------- String ----------
+
+// Bọc std::string, đủ cho code firmware và ArduinoJson (ARDUINOJSON_ENABLE_ARDUINO_STRING)
+class String
+{
+private:
+    std::string _s;
+
+public:
+    String() {}
+    String(const char *s) { if (s) _s = s; }
+    String(const String &other) = default;
+    String(char c) : _s(1, c) {}
+    String(int v, unsigned char base = DEC) { fromLong(v, base); }
+    String(unsigned int v, unsigned char base = DEC) { fromULong(v, base); }
+    String(long v, unsigned char base = DEC) { fromLong(v, base); }
+    String(unsigned long v, unsigned char base = DEC) { fromULong(v, base); }
+
+    String &operator=(const String &other) = default;
+    String &operator=(const char *s)
+    {
+        if (s)
+            _s = s;
+        else
+            _s.clear();
+        return *this;
+    }
+
+    bool reserve(unsigned int size)
+    {
+        _s.reserve(size);
+        return true;
+    }
+    bool concat(const char *s)
+    {
+        if (!s)
+            return false;
+        _s += s;
+        return true;
+    }
+    bool concat(const char *s, unsigned int len)
+    {
+        if (!s)
+            return false;
+        _s.append(s, len);
+        return true;
+    }
+    bool concat(const String &s)
+    {
+        _s += s._s;
+        return true;
+    }
+    bool concat(char c)
+    {
+        _s += c;
+        return true;
+    }
+
+    String &operator+=(const String &s) { concat(s); return *this; }
+    String &operator+=(const char *s) { concat(s); return *this; }
+    String &operator+=(char c) { concat(c); return *this; }
+
+    const char *c_str() const { return _s.c_str(); }
+    unsigned int length() const { return _s.length(); }
+    bool isEmpty() const { return _s.empty(); }
+    char operator[](unsigned int i) const { return i < _s.length() ? _s[i] : 0; }
+
+    bool operator==(const String &rhs) const { return _s == rhs._s; }
+    bool operator==(const char *rhs) const { return _s == (rhs ? rhs : ""); }
+    bool operator!=(const String &rhs) const { return !(*this == rhs); }
+    bool operator!=(const char *rhs) const { return !(*this == rhs); }
+
+private:
+    void fromULong(unsigned long v, unsigned char base)
+    {
+        char buf[33];
+        char *p = buf + sizeof(buf) - 1;
+        *p = '\0';
+        do
+        {
+            unsigned d = v % base;
+            *--p = d < 10 ? '0' + d : 'a' + d - 10;
+            v /= base;
+        } while (v);
+        _s = p;
+    }
+    void fromLong(long v, unsigned char base)
+    {
+        if (v < 0 && base == DEC)
+        {
+            fromULong(-(unsigned long)v, base);
+            _s.insert(0, 1, '-');
+        }
+        else
+        {
+            fromULong((unsigned long)v, base);
+        }
+    }
+};
+
+// ArduinoJson nhận diện cả kiểu kết quả của phép nối chuỗi
+class StringSumHelper : public String
+{
+public:
+    StringSumHelper(const String &s) : String(s) {}
+};
+
+inline StringSumHelper operator+(const String &lhs, const String &rhs)
+{
+    StringSumHelper r(lhs);
+    r += rhs;
+    return r;
+}
+inline StringSumHelper operator+(const String &lhs, const char *rhs)
+{
+    StringSumHelper r(lhs);
+    r += rhs;
+    return r;
+}
+inline StringSumHelper operator+(const char *lhs, const String &rhs)
+{
+    StringSumHelper r(lhs);
+    r += rhs;
+    return r;
+}
+
+// ---------- Serial / ESP ----------
+
+class HardwareSerial
+{
+private:
+    bool _muted = false;
+
+public:
+    void begin(unsigned long) {}
+    // Chỉ có trên native: tắt log của module (vd. khi giả lập hàng nghìn thiết bị)
+    void mute(bool muted) { _muted = muted; }
+    int available() { return 0; }
+    int read() { return -1; }
+    size_t write(const uint8_t *buf, size_t len) { return _muted ? len : fwrite(buf, 1, len, stdout); }
+
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t print(const String &s) { return print(s.c_str()); }
+    size_t print(char c) { return write((const uint8_t *)&c, 1); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned int v) { return printf("%u", v); }
+    size_t print(double v) { return printf("%.2f", v); }
+
+    template <typename T>
+    size_t println(const T &v)
+    {
+        size_t n = print(v);
+        return n + print('\n');
+    }
+    size_t println() { return print('\n'); }
+
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)))
+    {
+        if (_muted)
+            return 0;
+        va_list args;
+        va_start(args, fmt);
+        int n = vprintf(fmt, args);
+        va_end(args);
+        return n < 0 ? 0 : n;
+    }
+};
+
+inline HardwareSerial Serial;
+
+class EspClass
+{
+public:
+    // Bộ đếm chu kỳ của CPU host (TSC), chỉ dùng để so sánh tương đối.
+    // Host không phải x86 (ARM...): dùng ns của steady_clock thay cho chu kỳ
+    uint32_t getCycleCount()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return (uint32_t)__rdtsc();
+#else
+        return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+#endif
+    }
+    uint64_t getEfuseMac() { return 0x0000AABBCCDDEEFFULL; }
+    uint32_t getFreeHeap() { return 0; }
+    uint32_t getMinFreeHeap() { return 0; }
+    void restart() { exit(0); }
+};
+
+inline EspClass ESP;
+
+inline uint32_t getCpuFrequencyMhz() { return 0; }
+
+#endif
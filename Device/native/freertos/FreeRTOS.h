@@ -0,0 +1,30 @@
+#ifndef NATIVE_FREERTOS_H
+#define NATIVE_FREERTOS_H
+
+// Shim FreeRTOS cho env:native: tick = 1 ms, task = std::thread, queue/mutex dùng std::mutex.
+// Chỉ mô phỏng ngữ nghĩa chặn/timeout, không mô phỏng độ ưu tiên hay core.
+
+#include <stdint.h>
+#include <chrono>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskIDLE_PRIORITY 0
+#define portYIELD_FROM_ISR(...)
+
+inline TickType_t xTaskGetTickCount()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+#endif
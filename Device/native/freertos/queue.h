@@ -0,0 +1,83 @@
+#ifndef NATIVE_FREERTOS_QUEUE_H
+#define NATIVE_FREERTOS_QUEUE_H
+
+#include "FreeRTOS.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <string.h>
+
+// Queue sao chép theo giá trị như FreeRTOS, độ sâu cố định
+struct NativeQueue
+{
+    std::mutex lock;
+    std::condition_variable changed;
+    std::deque<std::vector<uint8_t>> items;
+    UBaseType_t depth;
+    UBaseType_t itemSize;
+};
+
+typedef NativeQueue *QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t depth, UBaseType_t itemSize)
+{
+    QueueHandle_t q = new NativeQueue();
+    q->depth = depth;
+    q->itemSize = itemSize;
+    return q;
+}
+
+template <typename Pred>
+inline bool nativeQueueWait(std::unique_lock<std::mutex> &guard, QueueHandle_t q, TickType_t ticks, Pred ready)
+{
+    if (ticks == portMAX_DELAY)
+    {
+        q->changed.wait(guard, ready);
+        return true;
+    }
+    return q->changed.wait_for(guard, std::chrono::milliseconds(ticks), ready);
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> guard(q->lock);
+    if (!nativeQueueWait(guard, q, ticks, [q] { return q->items.size() < q->depth; }))
+        return pdFALSE;
+    const uint8_t *p = (const uint8_t *)item;
+    q->items.emplace_back(p, p + q->itemSize);
+    q->changed.notify_all();
+    return pdTRUE;
+}
+
+inline BaseType_t xQueueSendFromISR(QueueHandle_t q, const void *item, BaseType_t *woken)
+{
+    if (woken)
+        *woken = pdFALSE;
+    return xQueueSend(q, item, 0);
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> guard(q->lock);
+    if (!nativeQueueWait(guard, q, ticks, [q] { return !q->items.empty(); }))
+        return pdFALSE;
+    memcpy(item, q->items.front().data(), q->itemSize);
+    q->items.pop_front();
+    q->changed.notify_all();
+    return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    std::lock_guard<std::mutex> guard(q->lock);
+    return q->items.size();
+}
+
+inline UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q)
+{
+    std::lock_guard<std::mutex> guard(q->lock);
+    return q->depth - q->items.size();
+}
+
+#endif
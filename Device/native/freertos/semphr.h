@@ -0,0 +1,27 @@
+#ifndef NATIVE_FREERTOS_SEMPHR_H
+#define NATIVE_FREERTOS_SEMPHR_H
+
+#include "FreeRTOS.h"
+#include <mutex>
+
+typedef std::timed_mutex *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new std::timed_mutex(); }
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t m, TickType_t ticks)
+{
+    if (ticks == portMAX_DELAY)
+    {
+        m->lock();
+        return pdTRUE;
+    }
+    return m->try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE : pdFALSE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t m)
+{
+    m->unlock();
+    return pdTRUE;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef NATIVE_FREERTOS_TASK_H
+#define NATIVE_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+#include <thread>
+
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+inline void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
+
+inline void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment)
+{
+    *previousWake += increment;
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(*previousWake - now) > 0)
+        vTaskDelay(*previousWake - now);
+}
+
+// Task chạy trên thread riêng (detached); handle luôn là NULL
+inline BaseType_t xTaskCreate(TaskFunction_t fn, const char *, uint32_t, void *param, UBaseType_t, TaskHandle_t *handle)
+{
+    std::thread(fn, param).detach();
+    if (handle)
+        *handle = NULL;
+    return pdPASS;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *param,
+                                          UBaseType_t prio, TaskHandle_t *handle, BaseType_t)
+{
+    return xTaskCreate(fn, name, stack, param, prio, handle);
+}
+
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+
+#endif
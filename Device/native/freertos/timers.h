@@ -0,0 +1,146 @@
+#ifndef NATIVE_FREERTOS_TIMERS_H
+#define NATIVE_FREERTOS_TIMERS_H
+
+#include "FreeRTOS.h"
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+
+// Software timer: mọi callback chạy tuần tự trên 1 thread dịch vụ như timer task của FreeRTOS.
+// Lệnh start/stop/reset có hiệu lực ngay (không qua hàng đợi lệnh), tham số ticks bị bỏ qua.
+
+struct NativeTimer;
+typedef NativeTimer *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t);
+
+struct NativeTimer
+{
+    TickType_t period;
+    bool autoReload;
+    void *id;
+    TimerCallbackFunction_t callback;
+    bool active = false;
+    TickType_t expiry = 0;
+};
+
+struct NativeTimerService
+{
+    std::mutex lock;
+    std::condition_variable changed;
+    std::list<NativeTimer *> timers;
+
+    static NativeTimerService &get()
+    {
+        static NativeTimerService *service = []
+        {
+            NativeTimerService *s = new NativeTimerService();
+            std::thread([s] { s->run(); }).detach();
+            return s;
+        }();
+        return *service;
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        for (;;)
+        {
+            NativeTimer *next = NULL;
+            for (NativeTimer *t : timers)
+                if (t->active && (!next || (int32_t)(t->expiry - next->expiry) < 0))
+                    next = t;
+
+            if (!next)
+            {
+                changed.wait(guard);
+                continue;
+            }
+            int32_t remaining = (int32_t)(next->expiry - xTaskGetTickCount());
+            if (remaining > 0)
+            {
+                changed.wait_for(guard, std::chrono::milliseconds(remaining));
+                continue;
+            }
+
+            if (next->autoReload)
+                next->expiry += next->period;
+            else
+                next->active = false;
+            // Callback được phép gọi lại API timer
+            guard.unlock();
+            next->callback(next);
+            guard.lock();
+        }
+    }
+
+    void arm(NativeTimer *t)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        t->active = true;
+        t->expiry = xTaskGetTickCount() + t->period;
+        changed.notify_all();
+    }
+
+    void disarm(NativeTimer *t)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        t->active = false;
+        changed.notify_all();
+    }
+};
+
+inline TimerHandle_t xTimerCreate(const char *, TickType_t period, UBaseType_t autoReload, void *id,
+                                  TimerCallbackFunction_t callback)
+{
+    TimerHandle_t t = new NativeTimer();
+    t->period = period;
+    t->autoReload = autoReload;
+    t->id = id;
+    t->callback = callback;
+    NativeTimerService &service = NativeTimerService::get();
+    std::lock_guard<std::mutex> guard(service.lock);
+    service.timers.push_back(t);
+    return t;
+}
+
+inline void *pvTimerGetTimerID(TimerHandle_t t) { return t->id; }
+
+inline BaseType_t xTimerStart(TimerHandle_t t, TickType_t)
+{
+    NativeTimerService::get().arm(t);
+    return pdPASS;
+}
+
+inline BaseType_t xTimerReset(TimerHandle_t t, TickType_t ticks) { return xTimerStart(t, ticks); }
+
+inline BaseType_t xTimerStop(TimerHandle_t t, TickType_t)
+{
+    NativeTimerService::get().disarm(t);
+    return pdPASS;
+}
+
+inline BaseType_t xTimerChangePeriod(TimerHandle_t t, TickType_t period, TickType_t ticks)
+{
+    {
+        std::lock_guard<std::mutex> guard(NativeTimerService::get().lock);
+        t->period = period;
+    }
+    return xTimerStart(t, ticks);
+}
+
+inline BaseType_t xTimerResetFromISR(TimerHandle_t t, BaseType_t *woken)
+{
+    if (woken)
+        *woken = pdFALSE;
+    return xTimerReset(t, 0);
+}
+
+inline BaseType_t xTimerStopFromISR(TimerHandle_t t, BaseType_t *woken)
+{
+    if (woken)
+        *woken = pdFALSE;
+    return xTimerStop(t, 0);
+}
+
+#endif
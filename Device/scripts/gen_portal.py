@@ -0,0 +1,59 @@
+"""Nén web/index.html (gzip) thành include/PortalHtml.h lúc build.
+
+PlatformIO chạy script này trước khi build (extra_scripts = pre:scripts/gen_portal.py);
+cũng chạy tay được: python scripts/gen_portal.py
+Header chỉ được ghi lại khi nội dung HTML đổi, ETag là SHA-1 của bản nén.
+"""
+import gzip
+import hashlib
+import os
+
+try:
+    Import("env")  # noqa: F821 (SCons)
+    PROJECT_DIR = env["PROJECT_DIR"]  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+SOURCE = os.path.join(PROJECT_DIR, "web", "index.html")
+OUTPUT = os.path.join(PROJECT_DIR, "include", "PortalHtml.h")
+
+
+def render(html):
+    # mtime=0: cùng HTML luôn ra cùng bản nén (và cùng ETag)
+    data = gzip.compress(html, compresslevel=9, mtime=0)
+    etag = hashlib.sha1(data).hexdigest()[:16]
+    rows = []
+    for i in range(0, len(data), 16):
+        rows.append("    " + ", ".join(f"0x{b:02x}" for b in data[i:i + 16]) + ",")
+    return (
+        "// File sinh tự động bởi scripts/gen_portal.py từ web/index.html, không sửa tay.\n"
+        "#ifndef PORTAL_HTML_H\n"
+        "#define PORTAL_HTML_H\n"
+        "\n"
+        "#include <Arduino.h>\n"
+        "\n"
+        f"// {len(html)} byte HTML -> {len(data)} byte gzip\n"
+        f"#define PORTAL_HTML_ETAG \"\\\"{etag}\\\"\"\n"
+        f"#define PORTAL_HTML_GZ_LEN {len(data)}\n"
+        "\n"
+        "static const uint8_t PORTAL_HTML_GZ[] PROGMEM = {\n"
+        + "\n".join(rows) + "\n"
+        "};\n"
+        "\n"
+        "#endif\n"
+    )
+
+
+def main():
+    with open(SOURCE, "rb") as f:
+        content = render(f.read())
+    if os.path.exists(OUTPUT):
+        with open(OUTPUT, encoding="utf-8") as f:
+            if f.read() == content:
+                return
+    with open(OUTPUT, "w", encoding="utf-8", newline="\n") as f:
+        f.write(content)
+    print(f"[gen_portal] {OUTPUT} updated")
+
+
+main()
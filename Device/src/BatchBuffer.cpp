@@ -0,0 +1,41 @@
+#include "BatchBuffer.h"
+
+BatchBuffer::BatchBuffer(uint16_t maxRecords, uint32_t maxAgeMs)
+    : _size(0), _count(0), _maxRecords(maxRecords), _maxAgeMs(maxAgeMs), _firstRecordMs(0)
+{
+}
+
+bool BatchBuffer::add(uint32_t timestamp, const uint8_t *data, size_t len)
+{
+    if (len > 0xFFFF || _size + RECORD_HEADER + len > BATCH_MAX_BYTES)
+        return false;
+
+    if (_count == 0)
+        _firstRecordMs = millis();
+
+    uint8_t *p = _buf + _size;
+    p[0] = timestamp & 0xFF;
+    p[1] = (timestamp >> 8) & 0xFF;
+    p[2] = (timestamp >> 16) & 0xFF;
+    p[3] = (timestamp >> 24) & 0xFF;
+    p[4] = len & 0xFF;
+    p[5] = (len >> 8) & 0xFF;
+    memcpy(p + RECORD_HEADER, data, len);
+
+    _size += RECORD_HEADER + len;
+    _count++;
+    return true;
+}
+
+bool BatchBuffer::isReady(uint32_t nowMs) const
+{
+    if (_count == 0)
+        return false;
+    return _count >= _maxRecords || (nowMs - _firstRecordMs) >= _maxAgeMs;
+}
+
+void BatchBuffer::clear()
+{
+    _size = 0;
+    _count = 0;
+}
@@ -1,4 +1,5 @@
 #include "ButtonHandler.h"
+#include <driver/gpio.h>
 
 ButtonHandler::ButtonHandler(uint8_t pin, uint32_t longPressMs, bool activeLow)
 {
@@ -7,13 +8,8 @@ ButtonHandler::ButtonHandler(uint8_t pin, uint32_t longPressMs, bool activeLow)
     _activeLow = activeLow;
     _debounceTimeMs = 50; // 50ms là đủ để chống rung cơ học
 
-    _lastReading = !activeLow; // Mặc định trạng thái ban đầu là chưa nhấn
-    _currentState = !activeLow;
-    _lastDebounceTime = 0;
+    _pressed = false; // Mặc định trạng thái ban đầu là chưa nhấn
     _pressStartTime = 0;
-
-    _isJustPressed = false;
-    _isLongPressed = false;
     _longPressTriggered = false;
 }
 
@@ -27,75 +23,81 @@ void ButtonHandler::begin()
     {
         pinMode(_pin, INPUT);
     }
+
+    _events = xQueueCreate(BUTTON_EVENT_QUEUE_DEPTH, sizeof(ButtonEvent));
+    _debounceTimer = xTimerCreate("btnDebounce", pdMS_TO_TICKS(_debounceTimeMs), pdFALSE, this, onDebounce);
+    _longPressTimer = xTimerCreate("btnLong", pdMS_TO_TICKS(_longPressTimeMs), pdFALSE, this, onLongPress);
+
+    // Nút đang được giữ lúc khởi động: kiểm tra ngay như vừa có cạnh tín hiệu
+    if (digitalRead(_pin) == (_activeLow ? LOW : HIGH))
+        xTimerStart(_debounceTimer, 0);
+
+    attachInterruptArg(_pin, onEdge, this, CHANGE);
 }
 
-void ButtonHandler::loop()
+// ISR: cạnh đầu tiên tắt ngắt của chân và hẹn giờ kiểm tra sau _debounceTimeMs,
+// các cạnh rung sau đó không còn gửi lệnh vào timer queue nữa.
+// Timer queue đầy (lệnh không vào được) thì bật lại ngắt để cạnh kế tiếp thử lại.
+void IRAM_ATTR ButtonHandler::onEdge(void *arg)
 {
-    // 1. Đọc trạng thái vật lý
-    int reading = digitalRead(_pin);
-    bool pressedState = _activeLow ? LOW : HIGH; // Trạng thái logic khi nhấn
+    ButtonHandler *self = (ButtonHandler *)arg;
+    BaseType_t woken = pdFALSE;
+    gpio_intr_disable((gpio_num_t)self->_pin);
+    if (xTimerStartFromISR(self->_debounceTimer, &woken) != pdPASS)
+        gpio_intr_enable((gpio_num_t)self->_pin);
+    if (woken)
+        portYIELD_FROM_ISR();
+}
 
-    // 2. Xử lý chống rung (Debounce Logic)
-    if (reading != _lastReading)
-    {
-        _lastDebounceTime = millis(); // Reset timer khi tín hiệu thay đổi
-    }
-    _lastReading = reading;
+// Hết thời gian chống rung: đọc mức hiện tại, phát sự kiện nếu khác trạng thái cũ
+void ButtonHandler::onDebounce(TimerHandle_t timer)
+{
+    ButtonHandler *self = (ButtonHandler *)pvTimerGetTimerID(timer);
+    // Bật lại ngắt trước khi đọc: cạnh trong lúc ngắt tắt đã nằm trong mức vừa đọc,
+    // cạnh sau đó lại hẹn 1 lần kiểm tra mới
+    gpio_intr_enable((gpio_num_t)self->_pin);
+    bool pressed = digitalRead(self->_pin) == (self->_activeLow ? LOW : HIGH);
+    if (pressed == self->_pressed)
+        return;
+    self->_pressed = pressed;
 
-    // Nếu tín hiệu ổn định đủ lâu (> debounceTime)
-    if ((millis() - _lastDebounceTime) > _debounceTimeMs)
+    if (pressed)
     {
-
-        // Nếu trạng thái ổn định khác với trạng thái hiện tại của hệ thống
-        if (reading != _currentState)
-        {
-            _currentState = reading;
-
-            // --- SỰ KIỆN NHẤN XUỐNG (FALLING EDGE cho ActiveLow) ---
-            if (_currentState == pressedState)
-            {
-                _isJustPressed = true;       // Bật cờ "Vừa nhấn"
-                _pressStartTime = millis();  // Ghi lại thời gian bắt đầu
-                _longPressTriggered = false; // Reset cờ Long Press
-            }
-        }
+        self->_pressStartTime = millis();
+        self->_longPressTriggered = false;
+        xTimerStart(self->_longPressTimer, 0);
+        self->push(BUTTON_PRESS, 0);
     }
-
-    // 3. Xử lý Long Press
-    // Nếu đang nhấn VÀ chưa báo Long Press lần nào VÀ thời gian giữ > ngưỡng
-    if ((_currentState == pressedState) && !_longPressTriggered)
+    else
     {
-        if ((millis() - _pressStartTime) >= _longPressTimeMs)
-        {
-            _isLongPressed = true;      // Bật cờ "Long Press"
-            _longPressTriggered = true; // Khóa lại để không báo liên tục
-        }
+        xTimerStop(self->_longPressTimer, 0);
+        if (!self->_longPressTriggered)
+            self->push(BUTTON_SHORT_RELEASE, millis() - self->_pressStartTime);
     }
 }
 
-// Hàm lấy cờ và tự động reset cờ (Read-and-Clear)
-bool ButtonHandler::isJustPressed()
+void ButtonHandler::onLongPress(TimerHandle_t timer)
 {
-    if (_isJustPressed)
-    {
-        _isJustPressed = false;
-        return true;
-    }
-    return false;
+    ButtonHandler *self = (ButtonHandler *)pvTimerGetTimerID(timer);
+    if (!self->_pressed || self->_longPressTriggered)
+        return;
+    self->_longPressTriggered = true;
+    self->push(BUTTON_LONG_PRESS, millis() - self->_pressStartTime);
 }
 
-bool ButtonHandler::isLongPressed()
+// Chạy trong timer task: không bao giờ chờ, queue đầy thì bỏ sự kiện
+void ButtonHandler::push(ButtonEventType type, uint32_t heldMs)
 {
-    if (_isLongPressed)
-    {
-        _isLongPressed = false;
-        return true;
-    }
-    return false;
+    ButtonEvent event = {type, heldMs};
+    xQueueSend(_events, &event, 0);
+}
+
+bool ButtonHandler::waitEvent(ButtonEvent &event, TickType_t wait)
+{
+    return _events && xQueueReceive(_events, &event, wait) == pdTRUE;
 }
 
 bool ButtonHandler::isPressedRaw()
 {
-    bool pressedState = _activeLow ? LOW : HIGH;
-    return (_currentState == pressedState);
-}
\ No newline at end of file
+    return _pressed;
+}
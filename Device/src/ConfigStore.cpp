@@ -0,0 +1,123 @@
+#include "ConfigStore.h"
+#include <Preferences.h>
+#include <esp_rom_crc.h>
+#include <stddef.h>
+
+static const char *CONFIG_NS = "my-app";
+static const char *CONFIG_KEY = "cfg";
+static const uint16_t CONFIG_VERSION = 1;
+
+// Các key của layout cũ (trước khi gộp thành 1 blob)
+static const char *LEGACY_KEYS[] = {"ssid", "pass", "mq_srv", "mq_port", "mq_usr", "mq_pwd", "key_url"};
+
+struct ConfigRecord
+{
+    uint16_t version;
+    uint16_t size; // sizeof(DeviceConfig) lúc ghi, phát hiện đổi layout mà quên tăng version
+    DeviceConfig config;
+    uint32_t crc; // CRC32 của mọi byte phía trước
+};
+
+uint32_t ConfigStore::recordCrc(const void *record, size_t len)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)record, len);
+}
+
+void ConfigStore::setDefaults(DeviceConfig &config)
+{
+    memset(&config, 0, sizeof(config));
+    config.mqttPort = 1883;
+}
+
+bool ConfigStore::load(DeviceConfig &config)
+{
+    ConfigRecord record;
+    Preferences prefs;
+    prefs.begin(CONFIG_NS, true);
+    size_t len = prefs.getBytes(CONFIG_KEY, &record, sizeof(record));
+    prefs.end();
+
+    if (len == sizeof(record) && record.version == CONFIG_VERSION && record.size == sizeof(DeviceConfig) &&
+        record.crc == recordCrc(&record, offsetof(ConfigRecord, crc)))
+    {
+        config = record.config;
+        return true;
+    }
+    if (len > 0)
+        Serial.printf("[Config] Record invalid (len %u, version %u), ignoring\n", (unsigned)len,
+                      len >= sizeof(record.version) ? (unsigned)record.version : 0);
+
+    // Chưa có blob: thử chuyển từ layout cũ
+    bool fits = true;
+    if (loadLegacy(config, fits))
+    {
+        // Giá trị không vừa layout mới: không lưu & giữ key cũ, tránh mất dữ liệu vĩnh viễn
+        if (!fits)
+            Serial.println("[Config] Legacy value too long, keeping legacy keys (not migrated)");
+        else if (save(config))
+        {
+            prefs.begin(CONFIG_NS, false);
+            for (const char *key : LEGACY_KEYS)
+                prefs.remove(key);
+            prefs.end();
+            Serial.println("[Config] Migrated legacy per-key config");
+        }
+        return true;
+    }
+
+    setDefaults(config);
+    return false;
+}
+
+// getString trả về 0 cả khi thiếu key lẫn khi giá trị dài hơn buffer: chỉ trường hợp sau là lỗi
+static bool getLegacyString(Preferences &prefs, const char *key, char *value, size_t size)
+{
+    return !prefs.isKey(key) || prefs.getString(key, value, size) > 0;
+}
+
+bool ConfigStore::loadLegacy(DeviceConfig &config, bool &fits)
+{
+    setDefaults(config);
+    Preferences prefs;
+    prefs.begin(CONFIG_NS, true);
+    bool found = prefs.isKey("ssid");
+    fits = true;
+    if (found)
+    {
+        fits = getLegacyString(prefs, "ssid", config.wifiSsid, sizeof(config.wifiSsid)) && fits;
+        fits = getLegacyString(prefs, "pass", config.wifiPass, sizeof(config.wifiPass)) && fits;
+        fits = getLegacyString(prefs, "mq_srv", config.mqttServer, sizeof(config.mqttServer)) && fits;
+        config.mqttPort = prefs.getInt("mq_port", 1883);
+        fits = getLegacyString(prefs, "mq_usr", config.mqttUser, sizeof(config.mqttUser)) && fits;
+        fits = getLegacyString(prefs, "mq_pwd", config.mqttPass, sizeof(config.mqttPass)) && fits;
+        fits = getLegacyString(prefs, "key_url", config.keyUrl, sizeof(config.keyUrl)) && fits;
+    }
+    prefs.end();
+    return found;
+}
+
+bool ConfigStore::save(const DeviceConfig &config)
+{
+    ConfigRecord record;
+    memset(&record, 0, sizeof(record)); // Byte đệm cũng phải cố định vì nằm trong CRC
+    record.version = CONFIG_VERSION;
+    record.size = sizeof(DeviceConfig);
+    record.config = config;
+    record.crc = recordCrc(&record, offsetof(ConfigRecord, crc));
+
+    Preferences prefs;
+    prefs.begin(CONFIG_NS, false);
+    bool ok = prefs.putBytes(CONFIG_KEY, &record, sizeof(record)) == sizeof(record);
+    prefs.end();
+    if (!ok)
+        Serial.println("[Config] Save failed!");
+    return ok;
+}
+
+void ConfigStore::clear()
+{
+    Preferences prefs;
+    prefs.begin(CONFIG_NS, false);
+    prefs.remove(CONFIG_KEY);
+    prefs.end();
+}
@@ -1,47 +1,162 @@
 #include "CryptoESP.h"
+#include <mbedtls/version.h>
 
-// Wrapper RNG static để tương thích với uECC
-int CryptoESP::rng_wrapper(uint8_t *dest, unsigned int size)
+// Khung JSON của gói tin (giữ đúng thứ tự field như bản ArduinoJson)
+static const char PKT_HEAD[] = "{\"from\":\"";
+static const char PKT_SID[] = "\",\"sid\":\"";
+static const char PKT_CIPHER[] = "\",\"ciphertext\":\"";
+static const char PKT_IV[] = "\",\"iv\":\"";
+static const char PKT_TAG[] = "\",\"tag\":\"";
+static const char PKT_FLAGS[] = "\",\"f\":";
+static const char PKT_TAIL[] = "\"}";
+
+// Mã hóa theo khối 48 byte: bội số của 16 (yêu cầu của mbedtls_gcm_update 2.x)
+// và của 3 (để Base64 từng khối không sinh padding giữa chừng)
+static const size_t GCM_CHUNK = 48;
+
+// Lớp tương thích API GCM streaming giữa mbedtls 2.x và 3.x
+static int gcmStart(mbedtls_gcm_context *ctx, const uint8_t *iv, size_t ivLen, const uint8_t *aad, size_t aadLen)
+{
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+    int ret = mbedtls_gcm_starts(ctx, MBEDTLS_GCM_ENCRYPT, iv, ivLen);
+    return ret != 0 ? ret : mbedtls_gcm_update_ad(ctx, aad, aadLen);
+#else
+    return mbedtls_gcm_starts(ctx, MBEDTLS_GCM_ENCRYPT, iv, ivLen, aad, aadLen);
+#endif
+}
+
+static int gcmUpdate(mbedtls_gcm_context *ctx, const uint8_t *in, size_t len, uint8_t *out)
+{
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+    size_t olen;
+    return mbedtls_gcm_update(ctx, in, len, out, len, &olen);
+#else
+    return mbedtls_gcm_update(ctx, len, in, out);
+#endif
+}
+
+static int gcmFinish(mbedtls_gcm_context *ctx, uint8_t *tag, size_t tagLen)
+{
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+    size_t olen;
+    return mbedtls_gcm_finish(ctx, NULL, 0, &olen, tag, tagLen);
+#else
+    return mbedtls_gcm_finish(ctx, tag, tagLen);
+#endif
+}
+
+// HKDF-SHA256 (RFC 5869), salt rỗng, đầu ra 32 byte = đúng 1 block expand
+static bool hkdfSha256(const uint8_t *ikm, size_t ikmLen, const uint8_t *info, size_t infoLen, uint8_t *out)
 {
-    esp_fill_random(dest, size);
-    return 1;
+    const mbedtls_md_info_t *md = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    uint8_t salt[32] = {0};
+    uint8_t prk[32];
+    const uint8_t one = 0x01;
+
+    // Extract: PRK = HMAC(salt, IKM)
+    if (mbedtls_md_hmac(md, salt, sizeof(salt), ikm, ikmLen, prk) != 0)
+        return false;
+
+    // Expand: T(1) = HMAC(PRK, info || 0x01)
+    mbedtls_md_context_t ctx;
+    mbedtls_md_init(&ctx);
+    int ret = mbedtls_md_setup(&ctx, md, 1);
+    if (ret == 0)
+        ret = mbedtls_md_hmac_starts(&ctx, prk, sizeof(prk));
+    if (ret == 0)
+        ret = mbedtls_md_hmac_update(&ctx, info, infoLen);
+    if (ret == 0)
+        ret = mbedtls_md_hmac_update(&ctx, &one, 1);
+    if (ret == 0)
+        ret = mbedtls_md_hmac_finish(&ctx, out);
+    mbedtls_md_free(&ctx);
+    memset(prk, 0, sizeof(prk));
+    return ret == 0;
+}
+
+CryptoESP::CryptoESP(EcdhBackend backend) : _ecdhBackend(backend)
+{
+    mbedtls_gcm_init(&_gcm);
 }
 
-CryptoESP::CryptoESP()
+CryptoESP::~CryptoESP()
 {
-    // Constructor
+    mbedtls_gcm_free(&_gcm);
 }
 
-bool CryptoESP::begin()
+bool CryptoESP::begin(bool generateKeys)
 {
-    // Đăng ký hàm RNG
-    uECC_set_rng(&CryptoESP::rng_wrapper);
-    generateNewKeys();
+    if (_deviceId[0] == '\0')
+    {
+        // getEfuseMac() trả MAC theo thứ tự byte thấp trước = byte đầu của địa chỉ MAC
+        uint64_t mac = ESP.getEfuseMac();
+        int n = snprintf(_deviceId, sizeof(_deviceId), "%s", DEVICE_ID_PREFIX);
+        for (int i = 0; i < 6; i++)
+            n += snprintf(_deviceId + n, sizeof(_deviceId) - n, "%02x", (unsigned)((mac >> (8 * i)) & 0xFF));
+    }
+    Serial.printf("[Crypto] Device id: %s\n", _deviceId);
+    Serial.printf("[Crypto] ECDH backend: %s\n", ecdhBackendName(_ecdhBackend));
+    if (generateKeys)
+        generateNewKeys();
     return true;
 }
 
-void CryptoESP::generateNewKeys()
+void CryptoESP::setDeviceId(const char *id)
+{
+    snprintf(_deviceId, sizeof(_deviceId), "%s", id);
+}
+
+bool CryptoESP::generateNewKeys(bool keepSession)
 {
-    const struct uECC_Curve_t *curve = uECC_secp256r1();
-    if (!uECC_make_key(_publicKey, _privateKey, curve))
+    bool usedSpare = _hasSpare;
+    if (usedSpare)
+    {
+        memcpy(_publicKey, _spare.publicKey, sizeof(_publicKey));
+        memcpy(_privateKey, _spare.privateKey, sizeof(_privateKey));
+        memset(&_spare, 0, sizeof(_spare));
+        _hasSpare = false;
+        Serial.println("[Crypto] Switched to precomputed ECDH Key Pair.");
+    }
+    else if (!ecdhMakeKey(_ecdhBackend, _publicKey, _privateKey))
     {
         Serial.println("[Crypto] Key generation failed!");
+        return false;
     }
     else
     {
         Serial.println("[Crypto] New ECDH Key Pair generated.");
+    }
+    if (!keepSession)
+    {
         _hasSharedSecret = false; // Reset lại trạng thái khi có key mới
+        _hasSessionId = false;
     }
+    return usedSpare;
+}
+
+bool CryptoESP::makeKeyPair(EcdhKeyPair &pair)
+{
+    return ecdhMakeKey(_ecdhBackend, pair.publicKey, pair.privateKey);
+}
+
+void CryptoESP::setSpareKeyPair(const EcdhKeyPair &pair)
+{
+    _spare = pair;
+    _hasSpare = true;
 }
 
-String CryptoESP::getPublicKeyHex()
+size_t CryptoESP::getPublicKeyHex(char *out, size_t outSize)
 {
-    char hexStr[129] = {0};
+    static const char *hex = "0123456789ABCDEF";
+    if (outSize < PUBLIC_KEY_HEX_SIZE)
+        return 0;
     for (int i = 0; i < 64; i++)
     {
-        sprintf(hexStr + i * 2, "%02X", _publicKey[i]);
+        out[i * 2] = hex[_publicKey[i] >> 4];
+        out[i * 2 + 1] = hex[_publicKey[i] & 0x0F];
     }
-    return String(hexStr);
+    out[128] = '\0';
+    return 128;
 }
 
 const uint8_t *CryptoESP::getPublicKeyRaw()
@@ -49,6 +164,11 @@ const uint8_t *CryptoESP::getPublicKeyRaw()
     return _publicKey;
 }
 
+void CryptoESP::getPublicKeyCompressed(uint8_t *out)
+{
+    ecdhCompressPublicKey(_publicKey, out);
+}
+
 bool CryptoESP::setPeerPublicKeyHex(const char *hexString)
 {
     if (strlen(hexString) != 128)
@@ -70,15 +190,22 @@ bool CryptoESP::setPeerPublicKeyRaw(const uint8_t *rawData)
     return computeSessionKey();
 }
 
+bool CryptoESP::setPeerPublicKeyCompressed(const uint8_t *compressed)
+{
+    if (!ecdhDecompressPublicKey(compressed, _peerPublicKey))
+        return false;
+    _hasPeerKey = true;
+    return computeSessionKey();
+}
+
 bool CryptoESP::computeSessionKey()
 {
     if (!_hasPeerKey)
         return false;
 
-    const struct uECC_Curve_t *curve = uECC_secp256r1();
     uint8_t sharedSecret[32];
 
-    if (!uECC_shared_secret(_peerPublicKey, _privateKey, sharedSecret, curve))
+    if (!ecdhSharedSecret(_ecdhBackend, _peerPublicKey, _privateKey, sharedSecret))
     {
         Serial.println("[Crypto] Shared secret calculation failed!");
         return false;
@@ -93,11 +220,155 @@ bool CryptoESP::computeSessionKey()
     mbedtls_md_finish(&sha_ctx, _aesKey);
     mbedtls_md_free(&sha_ctx);
 
+    // Nạp key vào context GCM một lần, dùng lại tới lần rekey sau
+    uint8_t derived[32];
+    memcpy(derived, _aesKey, sizeof(derived));
+    if (!loadKey(derived))
+        return false;
+    _epoch = 0;
+
     _hasSharedSecret = true;
+    _hasSessionId = false; // Key mới: session id cũ không còn đúng, chờ server cấp id mới
     Serial.println("[Crypto] AES Session Key ready.");
     return true;
 }
 
+void CryptoESP::setSessionId(const uint8_t *sessionId)
+{
+    memcpy(_sessionId, sessionId, SESSION_ID_LEN);
+    _hasSessionId = true;
+}
+
+bool CryptoESP::setSessionIdHex(const char *hexString)
+{
+    if (strlen(hexString) != SESSION_ID_LEN * 2)
+        return false;
+
+    uint8_t sid[SESSION_ID_LEN];
+    for (int i = 0; i < SESSION_ID_LEN; i++)
+    {
+        char byteHex[3] = {hexString[i * 2], hexString[i * 2 + 1], 0};
+        sid[i] = (uint8_t)strtol(byteHex, NULL, 16);
+    }
+    setSessionId(sid);
+    return true;
+}
+
+const uint8_t *CryptoESP::getSessionId()
+{
+    return _sessionId;
+}
+
+bool CryptoESP::restoreSession(const uint8_t *aesKey, const uint8_t *sessionId, uint32_t epoch)
+{
+    if (!loadKey(aesKey))
+        return false;
+
+    _epoch = epoch;
+    setSessionId(sessionId);
+    _hasSharedSecret = true;
+
+    // Counter của epoch cũ không được lưu: sang epoch mới để không lặp nonce
+    if (!ratchet())
+    {
+        _hasSharedSecret = false;
+        return false;
+    }
+    Serial.printf("[Crypto] Session resumed from flash (epoch %lu).\n", (unsigned long)_epoch);
+    return true;
+}
+
+bool CryptoESP::exportSession(CryptoSessionState *state)
+{
+    if (!_hasSharedSecret)
+        return false;
+    memcpy(state->aesKey, _aesKey, 32);
+    memcpy(state->sessionId, _sessionId, SESSION_ID_LEN);
+    state->hasSessionId = _hasSessionId;
+    state->epoch = _epoch;
+    state->counter = _counter;
+    state->epochBytes = _epochBytes;
+    return true;
+}
+
+bool CryptoESP::importSession(const CryptoSessionState *state)
+{
+    if (!loadKey(state->aesKey))
+        return false;
+
+    _epoch = state->epoch;
+    _counter = state->counter;
+    _epochBytes = state->epochBytes;
+    _hasSessionId = state->hasSessionId;
+    if (_hasSessionId)
+        memcpy(_sessionId, state->sessionId, SESSION_ID_LEN);
+    _hasSharedSecret = true;
+    return true;
+}
+
+bool CryptoESP::loadKey(const uint8_t *key)
+{
+    memcpy(_aesKey, key, 32);
+    _counter = 0;
+    _epochBytes = 0;
+    if (mbedtls_gcm_setkey(&_gcm, MBEDTLS_CIPHER_ID_AES, _aesKey, 256) != 0)
+    {
+        Serial.println("[Crypto] GCM setkey failed!");
+        _hasSharedSecret = false;
+        return false;
+    }
+    return true;
+}
+
+bool CryptoESP::ratchet()
+{
+    // info = "CO3069 ratchet" || epoch mới (4 byte big-endian)
+    static const char label[] = "CO3069 ratchet";
+    uint32_t next = _epoch + 1;
+    uint8_t info[sizeof(label) - 1 + 4];
+    memcpy(info, label, sizeof(label) - 1);
+    info[sizeof(label) - 1] = next >> 24;
+    info[sizeof(label)] = next >> 16;
+    info[sizeof(label) + 1] = next >> 8;
+    info[sizeof(label) + 2] = next;
+
+    uint8_t nextKey[32];
+    if (!hkdfSha256(_aesKey, sizeof(_aesKey), info, sizeof(info), nextKey) || !loadKey(nextKey))
+        return false;
+    memset(nextKey, 0, sizeof(nextKey));
+    _epoch = next;
+
+    if (_ratchetCallback)
+        _ratchetCallback(_aesKey, _epoch);
+    return true;
+}
+
+bool CryptoESP::nextNonce(uint8_t *iv, size_t len)
+{
+    bool msgLimit = RATCHET_MAX_MESSAGES > 0 && _counter >= RATCHET_MAX_MESSAGES;
+    bool byteLimit = RATCHET_MAX_BYTES > 0 && _epochBytes + len > RATCHET_MAX_BYTES && _counter > 0;
+    if ((msgLimit || byteLimit) && !ratchet())
+        return false;
+
+    // Hết không gian nonce cho phép của key này: bắt buộc rekey, không mã hóa tiếp
+    if (_counter >= NONCE_COUNTER_LIMIT)
+    {
+        Serial.println("[Crypto] Nonce limit reached, rekey required!");
+        return false;
+    }
+
+    iv[0] = _epoch >> 24;
+    iv[1] = _epoch >> 16;
+    iv[2] = _epoch >> 8;
+    iv[3] = _epoch;
+    for (int i = 0; i < 8; i++)
+        iv[4 + i] = (uint8_t)(_counter >> (56 - 8 * i));
+
+    _counter++;
+    _epochBytes += len;
+    return true;
+}
+
 bool CryptoESP::isReadyToSend()
 {
     return _hasSharedSecret;
@@ -108,9 +379,19 @@ String CryptoESP::createEncryptedPacket(const char *plaintext, const char *devic
     if (!_hasSharedSecret)
         return "{}";
 
-    // 1. Tạo IV ngẫu nhiên (12 bytes)
+    size_t len = strlen(plaintext);
+    if (deviceName == NULL)
+        deviceName = _deviceId;
+    uint8_t flags = PACKET_FLAG_RATCHET | (_hasSessionId ? PACKET_FLAG_SESSION : 0);
+    uint8_t aad[PACKET_HEADER_MAX];
+    size_t aadLen = writeHeader(aad, deviceName, flags);
+    if (aadLen == 0)
+        return "{}";
+
+    // 1. Nonce theo counter/epoch (12 bytes)
     uint8_t iv[12];
-    esp_fill_random(iv, 12);
+    if (!nextNonce(iv, len))
+        return "{}";
 
     // 2. Chuẩn bị AES-GCM
     mbedtls_gcm_context gcm;
@@ -122,12 +403,11 @@ String CryptoESP::createEncryptedPacket(const char *plaintext, const char *devic
         return "{}";
     }
 
-    size_t len = strlen(plaintext);
     // Cấp phát động để tiết kiệm RAM nếu chuỗi lớn, hoặc dùng buffer tĩnh nếu muốn nhanh
     uint8_t *ciphertext = (uint8_t *)malloc(len);
     uint8_t tag[16];
 
-    int ret = mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_ENCRYPT, len, iv, 12, NULL, 0,
+    int ret = mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_ENCRYPT, len, iv, 12, aad, aadLen,
                                         (const uint8_t *)plaintext, ciphertext, 16, tag);
     mbedtls_gcm_free(&gcm);
 
@@ -147,15 +427,186 @@ String CryptoESP::createEncryptedPacket(const char *plaintext, const char *devic
     // 4. Đóng gói JSON
     DynamicJsonDocument doc(1024);
     doc["from"] = deviceName;
+    if (_hasSessionId)
+    {
+        char sidHex[SESSION_ID_LEN * 2 + 1];
+        for (int i = 0; i < SESSION_ID_LEN; i++)
+            sprintf(sidHex + i * 2, "%02x", _sessionId[i]);
+        doc["sid"] = sidHex;
+    }
     doc["ciphertext"] = cipherB64;
     doc["iv"] = ivB64;
     doc["tag"] = tagB64;
+    doc["f"] = flags;
 
     String output;
     serializeJson(doc, output);
     return output;
 }
 
+size_t CryptoESP::encryptedPacketSize(size_t plaintextLen, const char *deviceName)
+{
+    size_t size = sizeof(PKT_HEAD) + sizeof(PKT_CIPHER) + sizeof(PKT_IV) + sizeof(PKT_TAG) + sizeof(PKT_TAIL) - 5;
+    size += deviceName ? strlen(deviceName) : DEVICE_ID_LEN;
+    size += ((plaintextLen + 2) / 3) * 4; // Base64(ciphertext)
+    size += 16 + 24;                      // Base64(IV 12 byte) + Base64(tag 16 byte)
+    size += sizeof(PKT_FLAGS) - 1 + 3;    // ,"f":<0..255> (nếu có)
+    size += sizeof(PKT_SID) - 1 + SESSION_ID_LEN * 2; // ,"sid":"<hex>" (nếu có)
+    return size + 1;                      // '\0'
+}
+
+size_t CryptoESP::createEncryptedPacket(const uint8_t *plaintext, size_t len, char *out, size_t outSize,
+                                        const char *deviceName, uint8_t flags)
+{
+    if (deviceName == NULL)
+        deviceName = _deviceId;
+    if (!_hasSharedSecret || out == NULL || outSize < encryptedPacketSize(len, deviceName))
+        return 0;
+
+    flags |= PACKET_FLAG_RATCHET;
+    if (_hasSessionId)
+        flags |= PACKET_FLAG_SESSION;
+    // Header chuẩn làm AAD: "f", "from", "sid" bị sửa thì server xác thực thất bại
+    uint8_t aad[PACKET_HEADER_MAX];
+    size_t aadLen = writeHeader(aad, deviceName, flags);
+    if (aadLen == 0)
+        return 0;
+
+    uint8_t iv[12];
+    if (!nextNonce(iv, len))
+        return 0;
+
+    if (gcmStart(&_gcm, iv, sizeof(iv), aad, aadLen) != 0)
+        return 0;
+
+    char *p = out;
+    size_t n = strlen(deviceName);
+    memcpy(p, PKT_HEAD, sizeof(PKT_HEAD) - 1);
+    p += sizeof(PKT_HEAD) - 1;
+    memcpy(p, deviceName, n);
+    p += n;
+    if (_hasSessionId)
+    {
+        memcpy(p, PKT_SID, sizeof(PKT_SID) - 1);
+        p += sizeof(PKT_SID) - 1;
+        for (int i = 0; i < SESSION_ID_LEN; i++)
+            p += sprintf(p, "%02x", _sessionId[i]);
+    }
+    memcpy(p, PKT_CIPHER, sizeof(PKT_CIPHER) - 1);
+    p += sizeof(PKT_CIPHER) - 1;
+
+    // Mã hóa từng khối vào buffer trên stack rồi Base64 thẳng vào out
+    uint8_t block[GCM_CHUNK];
+    for (size_t off = 0; off < len; off += GCM_CHUNK)
+    {
+        size_t chunk = (len - off < GCM_CHUNK) ? (len - off) : GCM_CHUNK;
+        if (gcmUpdate(&_gcm, plaintext + off, chunk, block) != 0)
+            return 0;
+        p += base64EncodeTo(block, chunk, p);
+    }
+
+    uint8_t tag[16];
+    if (gcmFinish(&_gcm, tag, sizeof(tag)) != 0)
+        return 0;
+
+    memcpy(p, PKT_IV, sizeof(PKT_IV) - 1);
+    p += sizeof(PKT_IV) - 1;
+    p += base64EncodeTo(iv, sizeof(iv), p);
+    memcpy(p, PKT_TAG, sizeof(PKT_TAG) - 1);
+    p += sizeof(PKT_TAG) - 1;
+    p += base64EncodeTo(tag, sizeof(tag), p);
+    if (flags)
+    {
+        memcpy(p, PKT_FLAGS, sizeof(PKT_FLAGS) - 1);
+        p += sizeof(PKT_FLAGS) - 1;
+        p += sprintf(p, "%u}", flags);
+    }
+    else
+    {
+        memcpy(p, PKT_TAIL, sizeof(PKT_TAIL) - 1);
+        p += sizeof(PKT_TAIL) - 1;
+        *p = '\0';
+    }
+
+    return p - out;
+}
+
+size_t CryptoESP::writeHeader(uint8_t *out, const char *deviceName, uint8_t flags)
+{
+    size_t idLen = strlen(deviceName);
+    if (idLen > 255)
+        return 0;
+    uint8_t *p = out;
+    *p++ = BIN_PACKET_VERSION;
+    *p++ = flags;
+    *p++ = (uint8_t)idLen;
+    memcpy(p, deviceName, idLen);
+    p += idLen;
+    if (flags & PACKET_FLAG_SESSION)
+    {
+        memcpy(p, _sessionId, SESSION_ID_LEN);
+        p += SESSION_ID_LEN;
+    }
+    return p - out;
+}
+
+size_t CryptoESP::binaryPacketSize(size_t plaintextLen, const char *deviceName)
+{
+    return 3 + (deviceName ? strlen(deviceName) : DEVICE_ID_LEN) + SESSION_ID_LEN + BIN_IV_LEN + plaintextLen + BIN_TAG_LEN;
+}
+
+size_t CryptoESP::createBinaryPacket(const uint8_t *plaintext, size_t len, uint8_t *out, size_t outSize,
+                                     const char *deviceName, uint8_t flags)
+{
+    if (deviceName == NULL)
+        deviceName = _deviceId;
+    size_t idLen = strlen(deviceName);
+    if (!_hasSharedSecret || out == NULL || idLen > 255 || outSize < binaryPacketSize(len, deviceName))
+        return 0;
+
+    uint8_t iv[BIN_IV_LEN];
+    if (!nextNonce(iv, len))
+        return 0;
+
+    flags |= PACKET_FLAG_RATCHET;
+    if (_hasSessionId)
+        flags |= PACKET_FLAG_SESSION;
+
+    // Header: version | flags | idLen | deviceId | sessionId
+    size_t headerLen = writeHeader(out, deviceName, flags);
+    uint8_t *p = out + headerLen;
+
+    memcpy(p, iv, BIN_IV_LEN);
+    p += BIN_IV_LEN;
+
+    // Ciphertext ghi thẳng vào out, tag nối ngay sau
+    int ret = mbedtls_gcm_crypt_and_tag(&_gcm, MBEDTLS_GCM_ENCRYPT, len, iv, BIN_IV_LEN, out, headerLen,
+                                        plaintext, p, BIN_TAG_LEN, p + len);
+    if (ret != 0)
+        return 0;
+
+    return headerLen + BIN_IV_LEN + len + BIN_TAG_LEN;
+}
+
+size_t CryptoESP::base64EncodeTo(const uint8_t *data, size_t length, char *out)
+{
+    static const char *table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char *p = out;
+    for (size_t i = 0; i < length; i += 3)
+    {
+        uint32_t v = data[i] << 16;
+        if (i + 1 < length)
+            v |= data[i + 1] << 8;
+        if (i + 2 < length)
+            v |= data[i + 2];
+        *p++ = table[(v >> 18) & 63];
+        *p++ = table[(v >> 12) & 63];
+        *p++ = (i + 1 < length) ? table[(v >> 6) & 63] : '=';
+        *p++ = (i + 2 < length) ? table[v & 63] : '=';
+    }
+    return p - out;
+}
+
 String CryptoESP::base64Encode(const uint8_t *data, size_t length)
 {
     // (Giữ nguyên hàm base64 của bạn ở đây, hoặc dùng thư viện <base64.h>)
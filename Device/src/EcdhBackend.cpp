@@ -0,0 +1,129 @@
+#include "EcdhBackend.h"
+#include <uECC.h>
+#include <mbedtls/ecp.h>
+#include <mbedtls/ecdh.h>
+
+// ---------- micro-ecc ----------
+
+// Wrapper RNG static để tương thích với uECC
+static int uecc_rng(uint8_t *dest, unsigned int size)
+{
+    esp_fill_random(dest, size);
+    return 1;
+}
+
+static bool ueccMakeKey(uint8_t *publicKey, uint8_t *privateKey)
+{
+    uECC_set_rng(&uecc_rng);
+    return uECC_make_key(publicKey, privateKey, uECC_secp256r1()) == 1;
+}
+
+static bool ueccSharedSecret(const uint8_t *peerPublicKey, const uint8_t *privateKey, uint8_t *secret)
+{
+    uECC_set_rng(&uecc_rng);
+    return uECC_shared_secret(peerPublicKey, privateKey, secret, uECC_secp256r1()) == 1;
+}
+
+// ---------- mbedtls ECP ----------
+
+static int mbedtls_rng(void *ctx, unsigned char *dest, size_t size)
+{
+    esp_fill_random(dest, size);
+    return 0;
+}
+
+static bool mbedtlsMakeKey(uint8_t *publicKey, uint8_t *privateKey)
+{
+    mbedtls_ecp_group grp;
+    mbedtls_mpi d;
+    mbedtls_ecp_point Q;
+    mbedtls_ecp_group_init(&grp);
+    mbedtls_mpi_init(&d);
+    mbedtls_ecp_point_init(&Q);
+
+    uint8_t point[65]; // 0x04 || X || Y
+    size_t olen = 0;
+    int ret = mbedtls_ecp_group_load(&grp, MBEDTLS_ECP_DP_SECP256R1);
+    if (ret == 0)
+        ret = mbedtls_ecp_gen_keypair(&grp, &d, &Q, mbedtls_rng, NULL);
+    if (ret == 0)
+        ret = mbedtls_mpi_write_binary(&d, privateKey, 32);
+    if (ret == 0)
+        ret = mbedtls_ecp_point_write_binary(&grp, &Q, MBEDTLS_ECP_PF_UNCOMPRESSED, &olen, point, sizeof(point));
+    if (ret == 0 && olen == sizeof(point))
+        memcpy(publicKey, point + 1, 64);
+
+    mbedtls_ecp_point_free(&Q);
+    mbedtls_mpi_free(&d);
+    mbedtls_ecp_group_free(&grp);
+    return ret == 0 && olen == sizeof(point);
+}
+
+static bool mbedtlsSharedSecret(const uint8_t *peerPublicKey, const uint8_t *privateKey, uint8_t *secret)
+{
+    mbedtls_ecp_group grp;
+    mbedtls_mpi d, z;
+    mbedtls_ecp_point P;
+    mbedtls_ecp_group_init(&grp);
+    mbedtls_mpi_init(&d);
+    mbedtls_mpi_init(&z);
+    mbedtls_ecp_point_init(&P);
+
+    uint8_t point[65];
+    point[0] = 0x04;
+    memcpy(point + 1, peerPublicKey, 64);
+
+    int ret = mbedtls_ecp_group_load(&grp, MBEDTLS_ECP_DP_SECP256R1);
+    if (ret == 0)
+        ret = mbedtls_ecp_point_read_binary(&grp, &P, point, sizeof(point));
+    if (ret == 0)
+        ret = mbedtls_ecp_check_pubkey(&grp, &P);
+    if (ret == 0)
+        ret = mbedtls_mpi_read_binary(&d, privateKey, 32);
+    if (ret == 0)
+        ret = mbedtls_ecdh_compute_shared(&grp, &z, &P, &d, mbedtls_rng, NULL);
+    if (ret == 0)
+        ret = mbedtls_mpi_write_binary(&z, secret, 32);
+
+    mbedtls_ecp_point_free(&P);
+    mbedtls_mpi_free(&z);
+    mbedtls_mpi_free(&d);
+    mbedtls_ecp_group_free(&grp);
+    return ret == 0;
+}
+
+// ---------- API chung ----------
+
+const char *ecdhBackendName(EcdhBackend backend)
+{
+    return backend == ECDH_BACKEND_MBEDTLS ? "mbedtls-ecp" : "micro-ecc";
+}
+
+bool ecdhMakeKey(EcdhBackend backend, uint8_t *publicKey, uint8_t *privateKey)
+{
+    if (backend == ECDH_BACKEND_MBEDTLS)
+        return mbedtlsMakeKey(publicKey, privateKey);
+    return ueccMakeKey(publicKey, privateKey);
+}
+
+bool ecdhSharedSecret(EcdhBackend backend, const uint8_t *peerPublicKey, const uint8_t *privateKey,
+                      uint8_t *secret)
+{
+    if (backend == ECDH_BACKEND_MBEDTLS)
+        return mbedtlsSharedSecret(peerPublicKey, privateKey, secret);
+    return ueccSharedSecret(peerPublicKey, privateKey, secret);
+}
+
+void ecdhCompressPublicKey(const uint8_t *publicKey, uint8_t *compressed)
+{
+    compressed[0] = 0x02 | (publicKey[63] & 0x01);
+    memcpy(compressed + 1, publicKey, 32);
+}
+
+bool ecdhDecompressPublicKey(const uint8_t *compressed, uint8_t *publicKey)
+{
+    if (compressed[0] != 0x02 && compressed[0] != 0x03)
+        return false;
+    uECC_decompress(compressed, publicKey, uECC_secp256r1());
+    return uECC_valid_public_key(publicKey, uECC_secp256r1()) == 1;
+}
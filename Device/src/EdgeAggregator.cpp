@@ -0,0 +1,94 @@
+#include "EdgeAggregator.h"
+#include <math.h>
+
+EdgeAggregator::EdgeAggregator(uint32_t heartbeatMs, uint32_t minIntervalMs)
+    : _channelCount(0), _samples(0), _heartbeatMs(heartbeatMs), _minIntervalMs(minIntervalMs), _lastReportMs(0),
+      _hasReported(false), _changed(false), _samplesTotal(0), _reports(0), _changeReports(0)
+{
+}
+
+int EdgeAggregator::addChannel(const char *name, float deadband, uint8_t decimals)
+{
+    if (_channelCount >= AGG_MAX_CHANNELS)
+        return -1;
+    Channel &c = _channels[_channelCount];
+    memset(&c, 0, sizeof(c));
+    strncpy(c.name, name, AGG_NAME_LEN - 1);
+    c.deadband = deadband;
+    c.decimals = decimals;
+    return _channelCount++;
+}
+
+void EdgeAggregator::add(const float *values, uint32_t nowMs)
+{
+    if (!_hasReported && _samples == 0)
+        _lastReportMs = nowMs;
+
+    for (uint8_t i = 0; i < _channelCount; i++)
+    {
+        Channel &c = _channels[i];
+        float v = values[i];
+        if (_samples == 0)
+        {
+            c.min = c.max = v;
+            c.sum = 0;
+        }
+        else
+        {
+            if (v < c.min)
+                c.min = v;
+            if (v > c.max)
+                c.max = v;
+        }
+        c.sum += v;
+        c.last = v;
+        if (!_hasReported || fabsf(v - c.reported) > c.deadband)
+            _changed = true;
+    }
+    _samples++;
+    _samplesTotal++;
+}
+
+AggReason EdgeAggregator::due(uint32_t nowMs) const
+{
+    if (_samples == 0)
+        return AGG_NONE;
+    uint32_t elapsed = nowMs - _lastReportMs;
+    if (_changed && (!_hasReported || elapsed >= _minIntervalMs))
+        return AGG_CHANGE;
+    if (elapsed >= _heartbeatMs)
+        return AGG_HEARTBEAT;
+    return AGG_NONE;
+}
+
+size_t EdgeAggregator::report(char *out, size_t size, uint32_t nowMs)
+{
+    if (_samples == 0 || size == 0)
+        return 0;
+
+    bool change = _changed;
+    int n = snprintf(out, size, "{\"n\":%lu,\"why\":\"%s\"", (unsigned long)_samples, change ? "change" : "heartbeat");
+    for (uint8_t i = 0; i < _channelCount && n > 0 && (size_t)n < size; i++)
+    {
+        const Channel &c = _channels[i];
+        int d = c.decimals;
+        n += snprintf(out + n, size - n, ",\"%s\":[%.*f,%.*f,%.*f,%.*f]", c.name, d, c.min, d, c.max, d,
+                      c.sum / _samples, d, c.last);
+    }
+    if (n > 0 && (size_t)n < size)
+        n += snprintf(out + n, size - n, "}");
+    // Không đủ chỗ: giữ nguyên cửa sổ, caller quyết định bỏ hay thử lại
+    if (n <= 0 || (size_t)n >= size)
+        return 0;
+
+    for (uint8_t i = 0; i < _channelCount; i++)
+        _channels[i].reported = _channels[i].last;
+    _samples = 0;
+    _changed = false;
+    _hasReported = true;
+    _lastReportMs = nowMs;
+    _reports++;
+    if (change)
+        _changeReports++;
+    return n;
+}
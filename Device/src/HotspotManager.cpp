@@ -1,83 +1,5 @@
 #include "HotspotManager.h"
-
-// --- CẬP NHẬT HTML FORM MỚI ---
-const char HotspotManager::index_html[] PROGMEM = R"rawliteral(
-<!DOCTYPE html>
-<html lang="vi">
-<head>
-    <meta charset="UTF-8"> <meta name="viewport" content="width=device-width, initial-scale=1.0"> <title>Cấu hình Hệ thống</title>
-    <style>
-        * { margin: 0; padding: 0; box-sizing: border-box; }
-        body { font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif; background: linear-gradient(135deg, #1e3c72 0%, #2a5298 100%); min-height: 100vh; display: flex; justify-content: center; align-items: center; padding: 20px; color: #333; }
-        .container { background: rgba(255, 255, 255, 0.95); padding: 30px; border-radius: 15px; box-shadow: 0 10px 30px rgba(0,0,0,0.3); width: 100%; max-width: 450px; }
-        h2 { text-align: center; color: #1e3c72; margin-bottom: 20px; border-bottom: 2px solid #eee; padding-bottom: 10px; }
-        .group-title { font-size: 14px; color: #666; margin-top: 15px; margin-bottom: 5px; text-transform: uppercase; font-weight: bold; border-left: 3px solid #1e3c72; padding-left: 8px; }
-        .form-group { margin-bottom: 12px; }
-        label { display: block; font-weight: 600; margin-bottom: 5px; font-size: 13px; }
-        input { width: 100%; padding: 10px; border: 1px solid #ccc; border-radius: 6px; font-size: 14px; transition: 0.3s; }
-        input:focus { border-color: #1e3c72; outline: none; box-shadow: 0 0 5px rgba(30,60,114,0.3); }
-        button { width: 100%; padding: 12px; background: #1e3c72; color: white; border: none; border-radius: 6px; font-size: 16px; font-weight: bold; cursor: pointer; margin-top: 20px; transition: 0.3s; }
-        button:hover { background: #2a5298; }
-        .message { margin-top: 15px; padding: 10px; border-radius: 6px; text-align: center; display: none; font-size: 14px; }
-        .success { background: #d4edda; color: #155724; border: 1px solid #c3e6cb; }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <h2>📡 Thiết lập Thiết bị</h2>
-        <form id="configForm">
-            
-            <div class="group-title">Kết nối WiFi</div>
-            <div class="form-group"><input type="text" id="wifi_ssid" placeholder="Tên WiFi (SSID)" required></div>
-            <div class="form-group"><input type="password" id="wifi_pass" placeholder="Mật khẩu WiFi"></div>
-
-            <div class="group-title">Cấu hình MQTT Broker</div>
-            <div class="form-group"><input type="text" id="mqtt_server" placeholder="Địa chỉ IP Broker (VD: 192.168.1.10)" required></div>
-            <div class="form-group"><input type="number" id="mqtt_port" placeholder="Port (Mặc định: 1883)" value="1883" required></div>
-            <div class="form-group"><input type="text" id="mqtt_user" placeholder="MQTT Username"></div>
-            <div class="form-group"><input type="password" id="mqtt_pass" placeholder="MQTT Password"></div>
-
-            <div class="group-title">Bảo mật (Key Exchange)</div>
-            <div class="form-group"><input type="text" id="key_url" placeholder="URL lấy Key (VD: http://192.168.1.10:8000/exchange)" required></div>
-
-            <button type="submit">Lưu Cấu Hình</button>
-        </form>
-        <div id="message" class="message"></div>
-    </div>
-    <script>
-        document.getElementById('configForm').addEventListener('submit', function(e) {
-            e.preventDefault();
-            const btn = document.querySelector('button');
-            btn.textContent = "Đang lưu..."; btn.disabled = true;
-
-            const data = {
-                wifi_ssid: document.getElementById('wifi_ssid').value,
-                wifi_pass: document.getElementById('wifi_pass').value,
-                mqtt_server: document.getElementById('mqtt_server').value,
-                mqtt_port: parseInt(document.getElementById('mqtt_port').value),
-                mqtt_user: document.getElementById('mqtt_user').value,
-                mqtt_pass: document.getElementById('mqtt_pass').value,
-                key_url: document.getElementById('key_url').value
-            };
-
-            fetch('/config', {
-                method: 'POST', headers: {'Content-Type': 'application/json'}, body: JSON.stringify(data)
-            })
-            .then(r => r.json())
-            .then(d => {
-                const msg = document.getElementById('message');
-                msg.textContent = '✅ Đã lưu thành công! Thiết bị sẽ khởi động lại.';
-                msg.className = 'message success'; msg.style.display = 'block';
-            })
-            .catch(err => {
-                btn.textContent = "Lưu Cấu Hình"; btn.disabled = false;
-                alert("Lỗi khi gửi dữ liệu!");
-            });
-        });
-    </script>
-</body>
-</html>
-)rawliteral";
+#include "PortalHtml.h"
 
 HotspotManager::HotspotManager(const char* apSSID, const char* apPass) 
     : _server(80), _apSSID(apSSID), _apPass(apPass) {
@@ -88,14 +10,32 @@ void HotspotManager::begin() {
     WiFi.disconnect();
     WiFi.mode(WIFI_AP);
     WiFi.softAP(_apSSID, _apPass);
-    Serial.println("\n[Hotspot] AP IP: " + WiFi.softAPIP().toString());
-
-    _server.on("/", HTTP_GET, [this](AsyncWebServerRequest *request){
-        request->send(200, "text/html", index_html);
+    Serial.print("\n[Hotspot] AP IP: ");
+    Serial.println(WiFi.softAPIP());
+
+    // Trang cấu hình nén sẵn lúc build (web/index.html), trình duyệt đã có thì chỉ trả 304
+    _server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
+        if (request->hasHeader("If-None-Match") &&
+            request->getHeader("If-None-Match")->value() == PORTAL_HTML_ETAG) {
+            AsyncWebServerResponse *response = request->beginResponse(304);
+            response->addHeader("ETag", PORTAL_HTML_ETAG);
+            request->send(response);
+            return;
+        }
+        AsyncWebServerResponse *response = request->beginResponse_P(200, "text/html", PORTAL_HTML_GZ, PORTAL_HTML_GZ_LEN);
+        response->addHeader("Content-Encoding", "gzip");
+        response->addHeader("ETag", PORTAL_HTML_ETAG);
+        response->addHeader("Cache-Control", "no-cache"); // Luôn hỏi lại bằng ETag
+        request->send(response);
     });
 
+    // Handler chính chạy sau khi đã nhận hết body: trả kết quả parse
     _server.on("/config", HTTP_POST, 
-        [](AsyncWebServerRequest *request){ request->send(200, "application/json", "{\"status\":\"ok\"}"); },
+        [this](AsyncWebServerRequest *request){
+            if (_bodyStatus == 200) request->send(200, "application/json", "{\"status\":\"ok\"}");
+            else request->send(_bodyStatus, "application/json", "{\"status\":\"error\"}");
+            _bodyStatus = 400; // Request sau không có body thì không dùng lại kết quả cũ
+        },
         NULL,
         [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total){
             this->handleConfigData(request, data, len, index, total);
@@ -106,26 +46,56 @@ void HotspotManager::begin() {
     _server.begin();
 }
 
-void HotspotManager::handleConfigData(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
-    DynamicJsonDocument doc(1024); // Tăng size buffer vì JSON giờ to hơn
-    DeserializationError error = deserializeJson(doc, data, len);
-
-    if (error) { Serial.println("[Hotspot] JSON Error"); return; }
+// Chép chuỗi JSON vào buffer cố định, false nếu không vừa (thiếu field = chuỗi rỗng)
+bool HotspotManager::copyField(JsonVariantConst value, char *out, size_t size) {
+    const char *s = value | "";
+    size_t len = strlen(s);
+    if (len >= size) return false;
+    memcpy(out, s, len + 1);
+    return true;
+}
 
-    // --- ĐỌC DỮ LIỆU TỪ JSON VÀO STRUCT ---
-    _receivedData.wifi_ssid    = doc["wifi_ssid"].as<String>();
-    _receivedData.wifi_pass    = doc["wifi_pass"].as<String>();
-    _receivedData.mqtt_server  = doc["mqtt_server"].as<String>();
-    _receivedData.mqtt_port    = doc["mqtt_port"] | 1883; // Mặc định 1883 nếu lỗi
-    _receivedData.mqtt_user    = doc["mqtt_user"].as<String>();
-    _receivedData.mqtt_pass    = doc["mqtt_pass"].as<String>();
-    _receivedData.key_exchange_url = doc["key_url"].as<String>();
+// Body có thể tới thành nhiều mảnh (index = vị trí mảnh, total = cả body):
+// gom vào buffer cố định, chỉ parse khi đã đủ index + len == total
+void HotspotManager::handleConfigData(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+    if (index == 0) {
+        _bodyLen = 0;
+        _bodyStatus = 400;
+        if (total > HOTSPOT_BODY_MAX) {
+            Serial.printf("[Hotspot] Body too large (%u bytes)\n", (unsigned)total);
+            _bodyStatus = 413;
+        }
+    }
+    // Mảnh lệch thứ tự / vượt total hoặc body đã bị từ chối: bỏ cả request
+    if (_bodyStatus == 413 || index != _bodyLen || index + len > total || index + len > HOTSPOT_BODY_MAX) return;
+
+    memcpy(_body + index, data, len);
+    _bodyLen = index + len;
+    if (_bodyLen < total) return;
+
+    JsonDocument doc(&_jsonArena);
+    DeserializationError error = deserializeJson(doc, (const char *)_body, _bodyLen);
+
+    if (error) { Serial.printf("[Hotspot] JSON Error: %s\n", error.c_str()); return; }
+
+    // --- ĐỌC DỮ LIỆU TỪ JSON VÀO STRUCT (field quá dài thì từ chối cả cấu hình) ---
+    DeviceConfig &cfg = _receivedData;
+    ConfigStore::setDefaults(cfg);
+    bool ok = copyField(doc["wifi_ssid"], cfg.wifiSsid, sizeof(cfg.wifiSsid)) &&
+              copyField(doc["wifi_pass"], cfg.wifiPass, sizeof(cfg.wifiPass)) &&
+              copyField(doc["mqtt_server"], cfg.mqttServer, sizeof(cfg.mqttServer)) &&
+              copyField(doc["mqtt_user"], cfg.mqttUser, sizeof(cfg.mqttUser)) &&
+              copyField(doc["mqtt_pass"], cfg.mqttPass, sizeof(cfg.mqttPass)) &&
+              copyField(doc["key_url"], cfg.keyUrl, sizeof(cfg.keyUrl));
+    cfg.mqttPort = doc["mqtt_port"] | 1883; // Mặc định 1883 nếu lỗi
+    if (!ok) { Serial.println("[Hotspot] Config field too long"); return; }
 
     Serial.println("[Hotspot] New Config Received:");
-    Serial.println(" - WiFi: " + _receivedData.wifi_ssid);
-    Serial.println(" - MQTT: " + _receivedData.mqtt_server);
-    Serial.println(" - Key URL: " + _receivedData.key_exchange_url);
+    Serial.printf(" - WiFi: %s\n", cfg.wifiSsid);
+    Serial.printf(" - MQTT: %s\n", cfg.mqttServer);
+    Serial.printf(" - Key URL: %s\n", cfg.keyUrl);
 
+    _bodyStatus = 200;
     _dataReceived = true;
 }
 
@@ -137,7 +107,7 @@ void HotspotManager::stop() {
 
 bool HotspotManager::isDataReceived() { return _dataReceived; }
 
-ConfigData HotspotManager::getConfigData() {
+const DeviceConfig &HotspotManager::getConfigData() {
     _dataReceived = false;
     return _receivedData;
 }
\ No newline at end of file
@@ -0,0 +1,34 @@
+#include "KeyExchange.h"
+
+size_t kxEncodeRequest(uint8_t *out, size_t outSize, uint16_t reqId, const uint8_t *publicKey, size_t publicKeyLen)
+{
+    if ((publicKeyLen != 33 && publicKeyLen != 64) || outSize < KX_HEADER_LEN + publicKeyLen)
+        return 0;
+    out[0] = KX_VERSION;
+    out[1] = publicKeyLen == 33 ? KX_FLAG_COMPRESSED : 0;
+    out[2] = reqId >> 8;
+    out[3] = reqId & 0xFF;
+    memcpy(out + KX_HEADER_LEN, publicKey, publicKeyLen);
+    return KX_HEADER_LEN + publicKeyLen;
+}
+
+bool kxParseResponse(const uint8_t *in, size_t len, KxResponse *res)
+{
+    if (len < KX_HEADER_LEN || in[0] != KX_VERSION)
+        return false;
+    res->status = in[1];
+    res->reqId = (in[2] << 8) | in[3];
+    res->sessionId = NULL;
+    res->publicKey = NULL;
+    res->publicKeyLen = 0;
+    if (res->status != KX_STATUS_OK)
+        return true;
+
+    if (len != KX_HEADER_LEN + KX_SESSION_ID_LEN + 33 && len != KX_HEADER_LEN + KX_SESSION_ID_LEN + 64)
+        return false;
+    size_t keyLen = len - KX_HEADER_LEN - KX_SESSION_ID_LEN;
+    res->sessionId = in + KX_HEADER_LEN;
+    res->publicKey = in + KX_HEADER_LEN + KX_SESSION_ID_LEN;
+    res->publicKeyLen = keyLen;
+    return true;
+}
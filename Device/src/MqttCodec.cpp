@@ -0,0 +1,191 @@
+#include "MqttCodec.h"
+
+// Remaining length: 1-4 byte, mỗi byte 7 bit, bit cao = còn byte tiếp
+static size_t writeHeader(uint8_t *out, size_t outSize, uint8_t firstByte, size_t remaining)
+{
+    if (remaining > 268435455 || outSize < 2)
+        return 0;
+    size_t n = 0;
+    out[n++] = firstByte;
+    do
+    {
+        if (n >= outSize)
+            return 0;
+        uint8_t b = remaining % 128;
+        remaining /= 128;
+        out[n++] = remaining ? (b | 0x80) : b;
+    } while (remaining);
+    return n;
+}
+
+static size_t headerLen(size_t remaining)
+{
+    return 1 + (remaining < 128 ? 1 : remaining < 16384 ? 2 : remaining < 2097152 ? 3 : 4);
+}
+
+static uint8_t *writeU16(uint8_t *p, uint16_t v)
+{
+    *p++ = v >> 8;
+    *p++ = v & 0xFF;
+    return p;
+}
+
+static uint8_t *writeStr(uint8_t *p, const char *s, size_t len)
+{
+    p = writeU16(p, (uint16_t)len);
+    memcpy(p, s, len);
+    return p + len;
+}
+
+size_t mqttEncodeConnect(uint8_t *out, size_t outSize, const char *clientId, const char *user, const char *pass,
+                         uint16_t keepAliveSec, bool cleanSession)
+{
+    size_t idLen = strlen(clientId);
+    size_t userLen = user && *user ? strlen(user) : 0;
+    size_t passLen = pass && *pass ? strlen(pass) : 0;
+
+    // Variable header: "MQTT" level 4, flags, keep alive
+    size_t remaining = 10 + 2 + idLen;
+    uint8_t flags = cleanSession ? 0x02 : 0x00;
+    if (userLen)
+    {
+        flags |= 0x80;
+        remaining += 2 + userLen;
+    }
+    if (userLen && passLen)
+    {
+        flags |= 0x40;
+        remaining += 2 + passLen;
+    }
+    if (headerLen(remaining) + remaining > outSize || idLen > 0xFFFF)
+        return 0;
+
+    uint8_t *p = out + writeHeader(out, outSize, MQTT_CONNECT << 4, remaining);
+    p = writeStr(p, "MQTT", 4);
+    *p++ = 4;
+    *p++ = flags;
+    p = writeU16(p, keepAliveSec);
+    p = writeStr(p, clientId, idLen);
+    if (flags & 0x80)
+        p = writeStr(p, user, userLen);
+    if (flags & 0x40)
+        p = writeStr(p, pass, passLen);
+    return p - out;
+}
+
+size_t mqttEncodePublish(uint8_t *out, size_t outSize, const char *topic, const uint8_t *payload, size_t len,
+                         uint8_t qos, uint16_t packetId, bool retain)
+{
+    size_t topicLen = strlen(topic);
+    size_t remaining = 2 + topicLen + (qos ? 2 : 0) + len;
+    if (qos > 2 || topicLen > 0xFFFF || headerLen(remaining) + remaining > outSize)
+        return 0;
+
+    uint8_t first = (MQTT_PUBLISH << 4) | (qos << 1) | (retain ? 1 : 0);
+    uint8_t *p = out + writeHeader(out, outSize, first, remaining);
+    p = writeStr(p, topic, topicLen);
+    if (qos)
+        p = writeU16(p, packetId);
+    memcpy(p, payload, len);
+    return p + len - out;
+}
+
+size_t mqttEncodeSubscribe(uint8_t *out, size_t outSize, uint16_t packetId, const char *topic, uint8_t qos)
+{
+    size_t topicLen = strlen(topic);
+    size_t remaining = 2 + 2 + topicLen + 1;
+    if (topicLen > 0xFFFF || headerLen(remaining) + remaining > outSize)
+        return 0;
+
+    // SUBSCRIBE bắt buộc có flags 0b0010
+    uint8_t *p = out + writeHeader(out, outSize, (MQTT_SUBSCRIBE << 4) | 0x02, remaining);
+    p = writeU16(p, packetId);
+    p = writeStr(p, topic, topicLen);
+    *p++ = qos;
+    return p - out;
+}
+
+size_t mqttEncodePubAck(uint8_t *out, size_t outSize, uint16_t packetId)
+{
+    if (outSize < 4)
+        return 0;
+    out[0] = MQTT_PUBACK << 4;
+    out[1] = 2;
+    writeU16(out + 2, packetId);
+    return 4;
+}
+
+size_t mqttEncodePingReq(uint8_t *out, size_t outSize)
+{
+    if (outSize < 2)
+        return 0;
+    out[0] = MQTT_PINGREQ << 4;
+    out[1] = 0;
+    return 2;
+}
+
+size_t mqttEncodeDisconnect(uint8_t *out, size_t outSize)
+{
+    if (outSize < 2)
+        return 0;
+    out[0] = MQTT_DISCONNECT << 4;
+    out[1] = 0;
+    return 2;
+}
+
+size_t mqttParse(const uint8_t *buf, size_t len, MqttPacket *pkt)
+{
+    if (len < 2)
+        return 0;
+
+    size_t remaining = 0;
+    size_t multiplier = 1;
+    size_t i = 1;
+    for (;;)
+    {
+        if (i >= len)
+            return 0;
+        if (i > 4)
+            return (size_t)-1;
+        uint8_t b = buf[i++];
+        remaining += (b & 0x7F) * multiplier;
+        multiplier *= 128;
+        if (!(b & 0x80))
+            break;
+    }
+    if (len - i < remaining)
+        return 0;
+
+    pkt->type = buf[0] >> 4;
+    pkt->flags = buf[0] & 0x0F;
+    pkt->body = buf + i;
+    pkt->bodyLen = remaining;
+    return i + remaining;
+}
+
+bool mqttParsePublish(const MqttPacket &pkt, MqttPublish *pub)
+{
+    if (pkt.type != MQTT_PUBLISH || pkt.bodyLen < 2)
+        return false;
+
+    const uint8_t *p = pkt.body;
+    size_t topicLen = (p[0] << 8) | p[1];
+    pub->qos = (pkt.flags >> 1) & 0x03;
+    size_t header = 2 + topicLen + (pub->qos ? 2 : 0);
+    if (header > pkt.bodyLen)
+        return false;
+
+    pub->topic = (const char *)p + 2;
+    pub->topicLen = topicLen;
+    pub->packetId = pub->qos ? (p[2 + topicLen] << 8) | p[3 + topicLen] : 0;
+    pub->payload = p + header;
+    pub->payloadLen = pkt.bodyLen - header;
+    return true;
+}
+
+int mqttConnackCode(const MqttPacket &pkt)
+{
+    if (pkt.type != MQTT_CONNACK || pkt.bodyLen != 2)
+        return -1;
+    return pkt.body[1];
+}
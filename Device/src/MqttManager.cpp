@@ -1,75 +1,549 @@
 #include "MqttManager.h"
 
+// Khóa đệ quy: close() có thể gọi onTcpDisconnect ngay trong lúc đang giữ khóa
+class MqttLock
+{
+    SemaphoreHandle_t _m;
+
+public:
+    MqttLock(SemaphoreHandle_t m) : _m(m) { xSemaphoreTakeRecursive(_m, portMAX_DELAY); }
+    ~MqttLock() { xSemaphoreGiveRecursive(_m); }
+};
+
 MqttManager::MqttManager(const char *broker, int port, const char *user, const char *pass)
-    : _broker(broker), _port(port), _user(user), _pass(pass), _client(_espClient)
+    : _broker(broker), _port(port), _user(user), _pass(pass)
 {
     _clientIdPrefix = "ESP32Client-";
+    _lock = xSemaphoreCreateRecursiveMutex();
+    memset(_inflight, 0, sizeof(_inflight));
+}
+
+MqttManager::~MqttManager()
+{
+    _client.close(true);
+    vSemaphoreDelete(_lock);
 }
 
 void MqttManager::begin()
 {
-    _client.setServer(_broker, _port);
+    _client.setNoDelay(true); // Gói nhỏ, cần độ trễ thấp hơn là gom segment
+    _client.onConnect(onTcpConnect, this);
+    _client.onDisconnect(onTcpDisconnect, this);
+    _client.onData(onTcpData, this);
+    _client.onError(onTcpError, this);
     // Callback sẽ được set sau khi user gọi hàm setCallback
 }
 
 void MqttManager::setCallback(void (*callback)(char *, uint8_t *, unsigned int))
 {
+    MqttLock lock(_lock);
     _callbackFunc = callback;
-    _client.setCallback(_callbackFunc);
 }
 
-void MqttManager::loop()
+// ---------- Kết nối ----------
+
+bool MqttManager::connect()
 {
-    if (!_client.connected())
     {
-        connect();
+        MqttLock lock(_lock);
+        if (_state == MQTT_STATE_CONNECTED || _state == MQTT_STATE_CONNECTING)
+            return true;
+        _state = MQTT_STATE_CONNECTING;
+        _connectStartMs = millis();
+        _rxLen = 0;
     }
-    _client.loop();
+
+    Serial.printf("Connecting to MQTT %s:%d...\n", _broker, _port);
+    if (_client.connect(_broker, (uint16_t)_port))
+        return true;
+
+    MqttLock lock(_lock);
+    Serial.print("[MQTT] TCP connect failed");
+    scheduleRetry();
+    Serial.printf(", retry in %lums\n", (unsigned long)msUntilReconnect());
+    return false;
 }
 
-bool MqttManager::connect()
+bool MqttManager::waitConnected(uint32_t timeoutMs)
 {
-    if (_client.connected())
-        return true;
+    uint32_t start = millis();
+    while (!connected() && millis() - start < timeoutMs)
+    {
+        loop();
+        delay(10);
+    }
+    return connected();
+}
 
-    Serial.print("Connecting to MQTT...");
-    String clientId = String(_clientIdPrefix) + String(random(0xffff), HEX);
+bool MqttManager::connected()
+{
+    return _state == MQTT_STATE_CONNECTED;
+}
+
+void MqttManager::scheduleRetry()
+{
+    // Jitter trong [backoff/2, backoff) để nhiều thiết bị không reconnect cùng lúc
+    uint32_t wait = _backoffMs / 2 + random(_backoffMs / 2);
+    _nextAttemptMs = millis() + wait;
+    _state = MQTT_STATE_BACKOFF;
+
+    _backoffMs = (_backoffMs >= MQTT_BACKOFF_MAX_MS / 2) ? MQTT_BACKOFF_MAX_MS : _backoffMs * 2;
+}
+
+uint32_t MqttManager::msUntilReconnect() const
+{
+    if (_state == MQTT_STATE_CONNECTED || _state == MQTT_STATE_CONNECTING)
+        return 0;
+    int32_t remaining = (int32_t)(_nextAttemptMs - millis());
+    return remaining > 0 ? (uint32_t)remaining : 0;
+}
 
-    if (_client.connect(clientId.c_str(), _user, _pass))
+void MqttManager::dropConnectionLocked(const char *reason)
+{
+    Serial.printf("[MQTT] Closing connection: %s\n", reason);
+    if (_state == MQTT_STATE_CONNECTED)
     {
-        Serial.println("connected");
-        // Resubscribe topics here if needed, or handle in main
-        return true;
+        // Đang chạy tốt thì thử lại ngay lần đầu
+        _state = MQTT_STATE_BACKOFF;
+        _backoffMs = MQTT_BACKOFF_MIN_MS;
+        _nextAttemptMs = millis();
     }
-    else
+    else if (_state == MQTT_STATE_CONNECTING)
     {
-        Serial.print("failed, rc=");
-        Serial.print(_client.state());
-        Serial.println(" try again in 3s");
-        delay(3000); // Blocking delay, có thể tối ưu bằng millis()
+        scheduleRetry();
+    }
+    _client.close(true);
+}
+
+// ---------- Callback của AsyncTCP (task async_tcp) ----------
+
+void MqttManager::onTcpConnect(void *arg, AsyncClient *client)
+{
+    MqttManager *self = (MqttManager *)arg;
+    MqttLock lock(self->_lock);
+
+    char clientId[32];
+    snprintf(clientId, sizeof(clientId), "%s%lx", self->_clientIdPrefix, (unsigned long)random(0xffff));
+    size_t n = mqttEncodeConnect(self->_tx, sizeof(self->_tx), clientId, self->_user, self->_pass, MQTT_KEEPALIVE_S);
+    if (n == 0 || !self->sendLocked(self->_tx, n))
+        self->dropConnectionLocked("CONNECT not sent");
+}
+
+void MqttManager::onTcpDisconnect(void *arg, AsyncClient *client)
+{
+    MqttManager *self = (MqttManager *)arg;
+    MqttLock lock(self->_lock);
+
+    if (self->_state == MQTT_STATE_CONNECTED)
+    {
+        // Vừa mất kết nối: thử lại ngay lần đầu
+        Serial.println("[MQTT] Connection lost");
+        self->_state = MQTT_STATE_BACKOFF;
+        self->_backoffMs = MQTT_BACKOFF_MIN_MS;
+        self->_nextAttemptMs = millis();
+    }
+    else if (self->_state == MQTT_STATE_CONNECTING)
+    {
+        Serial.print("[MQTT] Connect failed");
+        self->scheduleRetry();
+        Serial.printf(", retry in %lums\n", (unsigned long)self->msUntilReconnect());
+    }
+}
+
+void MqttManager::onTcpError(void *arg, AsyncClient *client, int8_t error)
+{
+    // Sau lỗi AsyncTCP luôn gọi onDisconnect, chỉ cần ghi log
+    Serial.printf("[MQTT] TCP error %d\n", (int)error);
+}
+
+void MqttManager::onTcpData(void *arg, AsyncClient *client, void *data, size_t len)
+{
+    MqttManager *self = (MqttManager *)arg;
+    MqttLock lock(self->_lock);
+    const uint8_t *in = (const uint8_t *)data;
+
+    while (len > 0)
+    {
+        size_t chunk = sizeof(self->_rx) - self->_rxLen;
+        if (chunk > len)
+            chunk = len;
+        memcpy(self->_rx + self->_rxLen, in, chunk);
+        self->_rxLen += chunk;
+        in += chunk;
+        len -= chunk;
+
+        // Tách mọi gói đã đủ byte
+        size_t offset = 0;
+        MqttPacket pkt;
+        for (;;)
+        {
+            size_t n = mqttParse(self->_rx + offset, self->_rxLen - offset, &pkt);
+            if (n == (size_t)-1)
+            {
+                self->dropConnectionLocked("malformed packet");
+                return;
+            }
+            if (n == 0)
+                break;
+            self->handlePacketLocked(pkt);
+            offset += n;
+        }
+        if (offset == 0 && self->_rxLen == sizeof(self->_rx))
+        {
+            self->dropConnectionLocked("incoming packet larger than MQTT_PACKET_SIZE");
+            return;
+        }
+        memmove(self->_rx, self->_rx + offset, self->_rxLen - offset);
+        self->_rxLen -= offset;
+    }
+}
+
+void MqttManager::handlePacketLocked(const MqttPacket &pkt)
+{
+    switch (pkt.type)
+    {
+    case MQTT_CONNACK:
+    {
+        int code = mqttConnackCode(pkt);
+        if (code != 0)
+        {
+            Serial.printf("[MQTT] Connect refused, rc=%d\n", code);
+            dropConnectionLocked("CONNACK refused");
+            return;
+        }
+        Serial.println("[MQTT] connected");
+        if (_connectedOnce)
+            _reconnectCount++;
+        _connectedOnce = true;
+        _state = MQTT_STATE_CONNECTED;
+        _backoffMs = MQTT_BACKOFF_MIN_MS;
+        _pingSentMs = 0;
+        resubscribeLocked();
+        resendInFlightLocked();
+        break;
+    }
+    case MQTT_PUBACK:
+    {
+        if (pkt.bodyLen < 2)
+            return;
+        uint16_t id = (pkt.body[0] << 8) | pkt.body[1];
+        for (InFlight &slot : _inflight)
+        {
+            if (slot.used && !slot.done && slot.packetId == id)
+                completeLocked(slot, true);
+        }
+        break;
+    }
+    case MQTT_PUBLISH:
+    {
+        MqttPublish pub;
+        if (!mqttParsePublish(pkt, &pub))
+            return;
+        if (pub.qos > 0)
+        {
+            size_t n = mqttEncodePubAck(_tx, sizeof(_tx), pub.packetId);
+            sendLocked(_tx, n);
+        }
+        // 1 slot tin nhắn đến: loop() chưa kịp giao thì bỏ & đếm
+        if (_inPending || pub.topicLen >= sizeof(_inTopic) || pub.payloadLen > sizeof(_inPayload))
+        {
+            _inDropped++;
+            return;
+        }
+        memcpy(_inTopic, pub.topic, pub.topicLen);
+        _inTopic[pub.topicLen] = '\0';
+        memcpy(_inPayload, pub.payload, pub.payloadLen);
+        _inLen = pub.payloadLen;
+        _inPending = true;
+        break;
+    }
+    case MQTT_PINGRESP:
+        _pingSentMs = 0;
+        break;
+    default:
+        break; // SUBACK: không cần xử lý
+    }
+}
+
+// ---------- Gửi ----------
+
+bool MqttManager::sendLocked(const uint8_t *data, size_t len)
+{
+    if (!_client.connected() || _client.space() < len)
         return false;
+    if (_client.add((const char *)data, len) != len || !_client.send())
+        return false;
+    _lastTxMs = millis();
+    return true;
+}
+
+uint16_t MqttManager::nextPacketIdLocked()
+{
+    for (;;)
+    {
+        uint16_t id = _nextPacketId++;
+        if (id == 0)
+            continue;
+        bool inUse = false;
+        for (const InFlight &slot : _inflight)
+        {
+            if (slot.used && slot.packetId == id)
+                inUse = true;
+        }
+        if (!inUse)
+            return id;
     }
 }
 
-bool MqttManager::connected()
+MqttManager::InFlight *MqttManager::freeSlotLocked()
+{
+    for (InFlight &slot : _inflight)
+    {
+        if (!slot.used)
+            return &slot;
+    }
+    return NULL;
+}
+
+void MqttManager::completeLocked(InFlight &slot, bool delivered)
 {
-    return _client.connected();
+    if (!delivered)
+        _publishFailures++;
+    // Giữ slot (và bản sao gói) tới khi loop() giao kết quả cho callback
+    slot.done = true;
+    slot.delivered = delivered;
+}
+
+void MqttManager::resendInFlightLocked()
+{
+    for (InFlight &slot : _inflight)
+    {
+        if (!slot.used || slot.done)
+            continue;
+        if (++slot.resends > MQTT_MAX_RESENDS)
+        {
+            Serial.printf("[MQTT] Packet %u dropped after %u resends\n", slot.packetId, MQTT_MAX_RESENDS);
+            completeLocked(slot, false);
+            continue;
+        }
+        slot.data[0] |= 0x08; // DUP
+        sendLocked(slot.data, slot.len);
+    }
 }
 
 bool MqttManager::publish(const char *topic, const char *payload)
 {
-    if (_client.connected())
+    return publish(topic, (const uint8_t *)payload, strlen(payload));
+}
+
+bool MqttManager::publish(const char *topic, const uint8_t *payload, size_t length)
+{
+    return publish(topic, payload, length, MQTT_DEFAULT_QOS);
+}
+
+bool MqttManager::publish(const char *topic, const uint8_t *payload, size_t length, uint8_t qos,
+                          MqttPublishCallback callback, void *ctx)
+{
+    MqttLock lock(_lock);
+    const char *error = NULL;
+
+    if (_state != MQTT_STATE_CONNECTED)
     {
-        return _client.publish(topic, payload);
+        error = "not connected";
     }
+    else if (qos == 0)
+    {
+        size_t n = mqttEncodePublish(_tx, sizeof(_tx), topic, payload, length);
+        if (n == 0)
+            error = "larger than MQTT_PACKET_SIZE";
+        else if (!sendLocked(_tx, n))
+            error = "TCP buffer full";
+    }
+    else
+    {
+        // QoS 2 không hỗ trợ, hạ xuống QoS 1
+        InFlight *slot = freeSlotLocked();
+        size_t n = 0;
+        uint16_t id = 0;
+        if (!slot)
+            error = "in-flight window full";
+        else if ((n = mqttEncodePublish(slot->data, sizeof(slot->data), topic, payload, length, 1,
+                                        id = nextPacketIdLocked())) == 0)
+            error = "larger than MQTT_PACKET_SIZE";
+        else if (!sendLocked(slot->data, n))
+            error = "TCP buffer full";
+        else
+        {
+            slot->used = true;
+            slot->done = false;
+            slot->resends = 0;
+            slot->packetId = id;
+            slot->callback = callback;
+            slot->ctx = ctx;
+            slot->len = n;
+        }
+    }
+
+    if (!error)
+        return true;
+
+    // Không im lặng bỏ qua: đếm & báo lỗi để caller lưu lại gói tin
+    _publishFailures++;
+    Serial.printf("[MQTT] Publish to %s failed (%u bytes, %s)\n", topic, (unsigned)length, error);
     return false;
 }
 
+bool MqttManager::canPublish()
+{
+    MqttLock lock(_lock);
+    return _state == MQTT_STATE_CONNECTED && freeSlotLocked() != NULL;
+}
+
+uint8_t MqttManager::inFlight()
+{
+    MqttLock lock(_lock);
+    uint8_t n = 0;
+    for (const InFlight &slot : _inflight)
+        n += slot.used;
+    return n;
+}
+
+bool MqttManager::flush(uint32_t timeoutMs)
+{
+    uint32_t start = millis();
+    while (inFlight() > 0 && connected() && millis() - start < timeoutMs)
+    {
+        loop();
+        delay(10);
+    }
+    loop();
+    return inFlight() == 0;
+}
+
+// ---------- Subscribe ----------
+
+void MqttManager::resubscribeLocked()
+{
+    for (uint8_t i = 0; i < _topicCount; i++)
+    {
+        size_t n = mqttEncodeSubscribe(_tx, sizeof(_tx), nextPacketIdLocked(), _topics[i]);
+        sendLocked(_tx, n);
+    }
+}
+
 bool MqttManager::subscribe(const char *topic)
 {
-    if (_client.connected())
+    MqttLock lock(_lock);
+    bool known = false;
+    for (uint8_t i = 0; i < _topicCount; i++)
     {
-        return _client.subscribe(topic);
+        if (strcmp(_topics[i], topic) == 0)
+            known = true;
     }
-    return false;
-}
\ No newline at end of file
+    if (!known)
+    {
+        if (_topicCount >= MQTT_MAX_SUBSCRIPTIONS || strlen(topic) >= MQTT_MAX_TOPIC_LEN)
+            return false;
+        strcpy(_topics[_topicCount++], topic);
+    }
+    if (_state != MQTT_STATE_CONNECTED)
+        return true; // Sẽ subscribe khi kết nối xong
+
+    size_t n = mqttEncodeSubscribe(_tx, sizeof(_tx), nextPacketIdLocked(), topic);
+    return n > 0 && sendLocked(_tx, n);
+}
+
+// ---------- Vòng lặp của caller ----------
+
+// Gọi callback của các gói đã có kết quả (ngoài khóa: callback được phép publish tiếp),
+// topic & payload tách lại từ bản sao gói trong slot rồi mới giải phóng slot
+void MqttManager::dispatchCompletions()
+{
+    for (InFlight &slot : _inflight)
+    {
+        {
+            MqttLock lock(_lock);
+            if (!slot.used || !slot.done)
+                continue;
+        }
+        // Slot done không bị task AsyncTCP hay publish() động tới, đọc ngoài khóa an toàn
+        if (slot.callback)
+        {
+            char topic[MQTT_MAX_TOPIC_LEN] = "";
+            MqttPacket pkt;
+            MqttPublish pub = {};
+            if (mqttParse(slot.data, slot.len, &pkt) == slot.len && mqttParsePublish(pkt, &pub) &&
+                pub.topicLen < sizeof(topic))
+            {
+                memcpy(topic, pub.topic, pub.topicLen);
+                topic[pub.topicLen] = '\0';
+            }
+            slot.callback(slot.packetId, slot.delivered, topic, pub.payload, pub.payloadLen, slot.ctx);
+        }
+        MqttLock lock(_lock);
+        slot.used = false;
+        slot.done = false;
+    }
+}
+
+void MqttManager::loop()
+{
+    bool reconnect = false;
+    {
+        MqttLock lock(_lock);
+        uint32_t now = millis();
+
+        if (_state == MQTT_STATE_CONNECTING && now - _connectStartMs > MQTT_CONNECT_TIMEOUT_MS)
+        {
+            dropConnectionLocked("connect timeout");
+        }
+        else if (_state == MQTT_STATE_CONNECTED)
+        {
+            // Keepalive: PINGREQ khi im lặng quá nửa chu kỳ, không có PINGRESP thì coi như mất kết nối
+            if (_pingSentMs && now - _pingSentMs > MQTT_KEEPALIVE_S * 1000UL)
+            {
+                dropConnectionLocked("ping timeout");
+            }
+            else if (!_pingSentMs && now - _lastTxMs >= MQTT_KEEPALIVE_S * 500UL)
+            {
+                size_t n = mqttEncodePingReq(_tx, sizeof(_tx));
+                if (sendLocked(_tx, n))
+                    _pingSentMs = now;
+            }
+        }
+        reconnect = (_state == MQTT_STATE_DISCONNECTED || _state == MQTT_STATE_BACKOFF) && msUntilReconnect() == 0;
+
+        // Tin nhắn đến: giao trong task của caller (vẫn giữ khóa để buffer không bị ghi đè)
+        if (_inPending)
+        {
+            if (_callbackFunc)
+                _callbackFunc(_inTopic, _inPayload, _inLen);
+            _inPending = false;
+        }
+    }
+
+    dispatchCompletions();
+
+    if (reconnect)
+        connect();
+}
+
+void MqttManager::disconnect()
+{
+    {
+        MqttLock lock(_lock);
+        if (_state == MQTT_STATE_CONNECTED)
+        {
+            size_t n = mqttEncodeDisconnect(_tx, sizeof(_tx));
+            sendLocked(_tx, n);
+        }
+        _state = MQTT_STATE_STOPPED;
+        for (InFlight &slot : _inflight)
+        {
+            if (slot.used && !slot.done)
+                completeLocked(slot, false);
+        }
+        _client.close(false);
+    }
+    loop(); // Báo các gói QoS 1 chưa ack (STOPPED: loop() không mở lại kết nối)
+}
@@ -0,0 +1,257 @@
+#include "OfflineQueue.h"
+#include <LittleFS.h>
+#include <esp_rom_crc.h>
+
+static const char *SFQ_DIR = "/sfq";
+static const char *SFQ_SLOT_TMP = "/sfq.slot.tmp"; // Ngoài thư mục slot để không bị quét nhầm
+static const char *SFQ_LEGACY_PATH = "/sfq.bin"; // Ring 1 file của bản cũ
+static const char *SFQ_META_PATH = "/sfq.meta";
+static const char *SFQ_META_TMP = "/sfq.meta.tmp";
+
+static const uint32_t SLOT_MAGIC = 0x51465331; // "1SFQ"
+static const uint32_t META_MAGIC = 0x4D465331; // "1SFM"
+
+struct TailMeta
+{
+    uint32_t magic;
+    uint32_t tail;
+    uint32_t crc;
+};
+
+OfflineQueue::OfflineQueue(uint16_t burstSize, uint32_t burstIntervalMs)
+    : _ready(false), _head(1), _tail(1), _savedTail(1), _sentMask(0), _ackedMask(0), _dropped(0), _corrupt(0),
+      _burstSize(burstSize), _burstIntervalMs(burstIntervalMs), _lastBurstMs(0)
+{
+}
+
+uint32_t OfflineQueue::slotCrc(const SlotHeader &h, const uint8_t *body)
+{
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&h.seq, sizeof(h.seq));
+    crc = esp_rom_crc32_le(crc, (const uint8_t *)&h.len, sizeof(h.len));
+    crc = esp_rom_crc32_le(crc, &h.topicLen, sizeof(h.topicLen));
+    return esp_rom_crc32_le(crc, body, h.topicLen + h.len);
+}
+
+void OfflineQueue::slotPath(char *path, size_t size, uint32_t seq)
+{
+    snprintf(path, size, "%s/%lu.bin", SFQ_DIR, (unsigned long)(seq % SFQ_CAPACITY));
+}
+
+bool OfflineQueue::begin()
+{
+    if (!LittleFS.begin(true))
+    {
+        Serial.println("[SFQ] LittleFS mount failed!");
+        return false;
+    }
+    // Ring 1 file của bản cũ: mỗi push copy-on-write cả file, bỏ đi (tail cũ cũng không còn khớp)
+    if (LittleFS.exists(SFQ_LEGACY_PATH))
+    {
+        LittleFS.remove(SFQ_LEGACY_PATH);
+        LittleFS.remove(SFQ_META_PATH);
+    }
+    if (!LittleFS.exists(SFQ_DIR) && !LittleFS.mkdir(SFQ_DIR))
+    {
+        Serial.println("[SFQ] Cannot create queue directory!");
+        return false;
+    }
+    _ready = true;
+
+    // Quét header các slot để tìm seq nhỏ nhất / lớn nhất còn trên flash
+    bool found = false;
+    uint32_t minSeq = 0, maxSeq = 0;
+    File dir = LittleFS.open(SFQ_DIR);
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile())
+    {
+        // name() là tên file (core mới) hoặc cả đường dẫn (core cũ)
+        const char *name = strrchr(f.name(), '/');
+        name = name ? name + 1 : f.name();
+        SlotHeader h;
+        bool valid = !f.isDirectory() && f.read((uint8_t *)&h, sizeof(h)) == sizeof(h) &&
+                     h.magic == SLOT_MAGIC && h.seq % SFQ_CAPACITY == strtoul(name, NULL, 10);
+        f.close();
+        if (!valid)
+            continue;
+        if (!found || h.seq < minSeq)
+            minSeq = h.seq;
+        if (!found || h.seq > maxSeq)
+            maxSeq = h.seq;
+        found = true;
+    }
+    dir.close();
+
+    _head = found ? maxSeq + 1 : 1;
+    if (!loadTail(_tail) || _tail > _head)
+        _tail = found ? minSeq : _head;
+    if (found && _tail < minSeq)
+        _tail = minSeq;
+    if (_head - _tail > SFQ_CAPACITY)
+        _tail = _head - SFQ_CAPACITY;
+    _savedTail = _tail;
+
+    Serial.printf("[SFQ] Ready: %lu packets pending\n", (unsigned long)size());
+    return true;
+}
+
+bool OfflineQueue::push(const char *topic, const uint8_t *payload, size_t len)
+{
+    size_t topicLen = strlen(topic);
+    if (!_ready || topicLen >= SFQ_MAX_TOPIC || topicLen + len > SLOT_PAYLOAD)
+        return false;
+
+    SlotHeader h;
+    h.magic = SLOT_MAGIC;
+    h.seq = _head;
+    h.len = (uint16_t)len;
+    h.topicLen = (uint8_t)topicLen;
+    h.reserved = 0;
+    memcpy(_slotBuf, topic, topicLen);
+    memcpy(_slotBuf + topicLen, payload, len);
+    h.crc = slotCrc(h, _slotBuf);
+
+    // Ghi file tạm rồi rename đè slot: slot luôn là gói cũ hoặc gói mới đầy đủ
+    File f = LittleFS.open(SFQ_SLOT_TMP, "w");
+    if (!f)
+        return false;
+    bool ok = f.write((const uint8_t *)&h, sizeof(h)) == sizeof(h) &&
+              f.write(_slotBuf, topicLen + len) == topicLen + len;
+    f.close();
+    char path[24];
+    slotPath(path, sizeof(path), h.seq);
+    if (!ok || !LittleFS.rename(SFQ_SLOT_TMP, path))
+        return false;
+
+    _head++;
+    if (_head - _tail > SFQ_CAPACITY)
+    {
+        // Ring đầy: gói cũ nhất vừa bị ghi đè
+        advanceTail(_head - SFQ_CAPACITY - _tail);
+        _dropped++;
+    }
+    return true;
+}
+
+void OfflineQueue::advanceTail(uint32_t n)
+{
+    _tail += n;
+    _sentMask = n >= SFQ_ACK_WINDOW ? 0 : _sentMask >> n;
+    _ackedMask = n >= SFQ_ACK_WINDOW ? 0 : _ackedMask >> n;
+}
+
+void OfflineQueue::ack(uint32_t seq)
+{
+    // Gói đã bị ghi đè (seq < tail) hoặc seq lạ: bỏ qua
+    if (seq - _tail >= SFQ_ACK_WINDOW || seq - _tail >= _head - _tail)
+        return;
+    _ackedMask |= 1UL << (seq - _tail);
+    uint32_t n = 0;
+    while (n < SFQ_ACK_WINDOW && (_ackedMask >> n) & 1)
+        n++;
+    if (n)
+        advanceTail(n);
+}
+
+void OfflineQueue::nack(uint32_t seq)
+{
+    if (seq - _tail < SFQ_ACK_WINDOW)
+        _sentMask &= ~(1UL << (seq - _tail));
+}
+
+void OfflineQueue::commit()
+{
+    if (_ready && _tail != _savedTail && saveTail())
+        _savedTail = _tail;
+}
+
+size_t OfflineQueue::drain(PublishFn publish, uint32_t nowMs)
+{
+    if (!_ready || (nowMs - _lastBurstMs) < _burstIntervalMs)
+        return 0;
+    _lastBurstMs = nowMs;
+    // Ghi 1 lần cho các ack của cả đợt trước để giảm số lần ghi flash
+    commit();
+    if (isEmpty())
+        return 0;
+
+    size_t sent = 0;
+    char topic[SFQ_MAX_TOPIC];
+    char path[24];
+    SlotHeader h;
+
+    // Gói chưa gửi / bị nack cũ nhất, không vượt cửa sổ chờ ack
+    for (uint32_t i = 0; sent < _burstSize && i < SFQ_ACK_WINDOW && _tail + i != _head; i++)
+    {
+        uint32_t bit = 1UL << i;
+        if ((_sentMask | _ackedMask) & bit)
+            continue;
+        uint32_t seq = _tail + i;
+        slotPath(path, sizeof(path), seq);
+        File f = LittleFS.open(path, "r");
+        bool valid = f && f.read((uint8_t *)&h, sizeof(h)) == sizeof(h) &&
+                     h.magic == SLOT_MAGIC && h.seq == seq &&
+                     h.topicLen < SFQ_MAX_TOPIC && h.topicLen + h.len <= SLOT_PAYLOAD &&
+                     f.read(_slotBuf, h.topicLen + h.len) == (size_t)(h.topicLen + h.len) &&
+                     slotCrc(h, _slotBuf) == h.crc;
+        if (f)
+            f.close();
+        if (!valid)
+        {
+            // Slot hỏng (mất điện lúc ghi): bỏ qua như đã gửi xong
+            _corrupt++;
+            ack(seq);
+            i = (uint32_t)-1; // Tail có thể đã tiến, quét lại từ đầu cửa sổ
+            continue;
+        }
+
+        memcpy(topic, _slotBuf, h.topicLen);
+        topic[h.topicLen] = '\0';
+        if (!publish(topic, _slotBuf + h.topicLen, h.len, seq))
+            break;
+
+        // ack()/nack() có thể đã chạy trong publish (callback đồng bộ): tính lại bit theo tail mới
+        if (seq - _tail < SFQ_ACK_WINDOW && !((_ackedMask >> (seq - _tail)) & 1))
+            _sentMask |= 1UL << (seq - _tail);
+        sent++;
+    }
+
+    if (sent > 0)
+        Serial.printf("[SFQ] Drained %u packets, %lu left\n", (unsigned)sent, (unsigned long)size());
+    return sent;
+}
+
+void OfflineQueue::setDrainRate(uint16_t burstSize, uint32_t burstIntervalMs)
+{
+    _burstSize = burstSize;
+    _burstIntervalMs = burstIntervalMs;
+}
+
+bool OfflineQueue::loadTail(uint32_t &tail)
+{
+    File f = LittleFS.open(SFQ_META_PATH, "r");
+    if (!f)
+        return false;
+
+    TailMeta meta;
+    bool ok = f.read((uint8_t *)&meta, sizeof(meta)) == sizeof(meta) && meta.magic == META_MAGIC &&
+              meta.crc == esp_rom_crc32_le(0, (const uint8_t *)&meta.tail, sizeof(meta.tail));
+    f.close();
+    if (ok)
+        tail = meta.tail;
+    return ok;
+}
+
+bool OfflineQueue::saveTail()
+{
+    TailMeta meta;
+    meta.magic = META_MAGIC;
+    meta.tail = _tail;
+    meta.crc = esp_rom_crc32_le(0, (const uint8_t *)&meta.tail, sizeof(meta.tail));
+
+    // Ghi file tạm rồi rename đè: file meta luôn là bản cũ hoặc bản mới đầy đủ
+    File f = LittleFS.open(SFQ_META_TMP, "w");
+    if (!f)
+        return false;
+    bool ok = f.write((const uint8_t *)&meta, sizeof(meta)) == sizeof(meta);
+    f.close();
+    return ok && LittleFS.rename(SFQ_META_TMP, SFQ_META_PATH);
+}
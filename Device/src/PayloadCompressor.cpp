@@ -0,0 +1,182 @@
+#include "PayloadCompressor.h"
+
+// Giới hạn của định dạng LZ4: 5 byte cuối luôn là literal, match không bắt đầu trong 12 byte cuối
+static const size_t MIN_MATCH = 4;
+static const size_t LAST_LITERALS = 5;
+static const size_t MF_LIMIT = 12;
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint32_t hash4(uint32_t v)
+{
+    return (v * 2654435761U) >> (32 - COMPRESS_HASH_BITS);
+}
+
+// Số byte mở rộng của độ dài (sau khi trừ 15): 255 255 ... r
+static inline uint8_t *writeLength(uint8_t *op, size_t n)
+{
+    while (n >= 255)
+    {
+        *op++ = 255;
+        n -= 255;
+    }
+    *op++ = (uint8_t)n;
+    return op;
+}
+
+// Ghi 1 sequence: literal [anchor, anchor + litLen) rồi match (offset, matchLen; 0 = sequence cuối)
+static uint8_t *writeSequence(uint8_t *op, const uint8_t *end, const uint8_t *literals, size_t litLen,
+                              uint16_t offset, size_t matchLen)
+{
+    size_t worst = 1 + litLen / 255 + 1 + litLen + (matchLen ? 2 + matchLen / 255 + 1 : 0);
+    if (op + worst > end)
+        return NULL;
+
+    uint8_t *token = op++;
+    if (litLen >= 15)
+    {
+        *token = 15 << 4;
+        op = writeLength(op, litLen - 15);
+    }
+    else
+    {
+        *token = litLen << 4;
+    }
+    memcpy(op, literals, litLen);
+    op += litLen;
+    if (!matchLen)
+        return op;
+
+    *op++ = offset & 0xFF;
+    *op++ = offset >> 8;
+    size_t ml = matchLen - MIN_MATCH;
+    if (ml >= 15)
+    {
+        *token |= 15;
+        op = writeLength(op, ml - 15);
+    }
+    else
+    {
+        *token |= ml;
+    }
+    return op;
+}
+
+size_t PayloadCompressor::compress(const uint8_t *src, size_t len, uint8_t *dst, size_t dstSize)
+{
+    if (len < COMPRESS_MIN_BYTES || len > 0xFFFF || dstSize <= COMPRESS_HEADER_LEN)
+        return 0;
+    // Phải nhỏ hơn bản gốc ít nhất 1 byte, nếu không thì vô ích: chặn luôn ở đây
+    const uint8_t *end = dst + (dstSize < len - 1 ? dstSize : len - 1);
+    dst[0] = len & 0xFF;
+    dst[1] = len >> 8;
+    uint8_t *op = dst + COMPRESS_HEADER_LEN;
+
+    memset(_table, 0, sizeof(_table));
+    size_t anchor = 0;
+    size_t ip = 0;
+    size_t matchLimit = len - LAST_LITERALS;
+
+    while (ip + MF_LIMIT <= len)
+    {
+        uint32_t seq = read32(src + ip);
+        uint32_t h = hash4(seq);
+        size_t ref = _table[h];
+        _table[h] = ip;
+        // Bảng khởi tạo 0 nên ref có thể trỏ nhầm: luôn so lại 4 byte
+        if (ref >= ip || read32(src + ref) != seq)
+        {
+            ip++;
+            continue;
+        }
+
+        size_t matchLen = MIN_MATCH;
+        while (ip + matchLen < matchLimit && src[ref + matchLen] == src[ip + matchLen])
+            matchLen++;
+
+        op = writeSequence(op, end, src + anchor, ip - anchor, ip - ref, matchLen);
+        if (!op)
+            return 0;
+        ip += matchLen;
+        anchor = ip;
+    }
+
+    op = writeSequence(op, end, src + anchor, len - anchor, 0, 0);
+    if (!op)
+        return 0;
+    return op - dst;
+}
+
+size_t PayloadCompressor::decompress(const uint8_t *src, size_t len, uint8_t *dst, size_t dstSize)
+{
+    if (len < COMPRESS_HEADER_LEN + 1)
+        return 0;
+    size_t outLen = src[0] | (src[1] << 8);
+    if (outLen > dstSize)
+        return 0;
+
+    const uint8_t *ip = src + COMPRESS_HEADER_LEN;
+    const uint8_t *ipEnd = src + len;
+    size_t op = 0;
+    for (;;)
+    {
+        if (ip >= ipEnd)
+            return 0; // Khối phải kết thúc bằng sequence chỉ có literal
+        uint8_t token = *ip++;
+        size_t litLen = token >> 4;
+        if (litLen == 15)
+        {
+            uint8_t b;
+            do
+            {
+                if (ip >= ipEnd)
+                    return 0;
+                b = *ip++;
+                litLen += b;
+            } while (b == 255);
+        }
+        if (litLen > (size_t)(ipEnd - ip) || op + litLen > outLen)
+            return 0;
+        memcpy(dst + op, ip, litLen);
+        ip += litLen;
+        op += litLen;
+        if (ip == ipEnd)
+            break; // Sequence cuối chỉ có literal
+
+        if (ipEnd - ip < 2)
+            return 0;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t matchLen = (token & 15) + MIN_MATCH;
+        if ((token & 15) == 15)
+        {
+            uint8_t b;
+            do
+            {
+                if (ip >= ipEnd)
+                    return 0;
+                b = *ip++;
+                matchLen += b;
+            } while (b == 255);
+        }
+        if (offset == 0 || offset > op || op + matchLen > outLen)
+            return 0;
+        if (offset >= matchLen)
+        {
+            memcpy(dst + op, dst + op - offset, matchLen);
+            op += matchLen;
+        }
+        else
+        {
+            // Match chồng lên chính nó (lặp đoạn offset byte cuối): chép từng byte
+            for (size_t i = 0; i < matchLen; i++, op++)
+                dst[op] = dst[op - offset];
+        }
+    }
+    return op == outLen ? outLen : 0;
+}
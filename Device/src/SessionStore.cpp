@@ -0,0 +1,135 @@
+#include "SessionStore.h"
+#include <Preferences.h>
+#include <esp_flash_encrypt.h>
+#include <esp_partition.h>
+#include <nvs.h>
+#include <nvs_flash.h>
+
+static const char *SESSION_NS = "session";
+static const uint8_t SESSION_BLOB_VERSION = 3;
+
+// Blob: [version 1B][aesKey 32B][sessionId 8B][epoch 4B LE]
+// Bản cũ (version 1-2, bọc bằng key suy ra từ MAC trong NVS thường) bị xóa khi mở store.
+static const size_t SESSION_BLOB_LEN = 1 + 32 + SESSION_ID_LEN + 4;
+
+bool SessionStore::open()
+{
+    if (_state != STORE_UNINIT)
+        return _state == STORE_READY;
+    _state = STORE_UNAVAILABLE;
+
+    // Blob bản cũ trong NVS thường không được bảo vệ thật sự: xóa cả blob lẫn salt
+    Preferences legacy;
+    if (legacy.begin(SESSION_NS, true))
+    {
+        bool found = legacy.isKey("blob") || legacy.isKey("salt");
+        legacy.end();
+        if (found && legacy.begin(SESSION_NS, false))
+        {
+            legacy.clear();
+            legacy.end();
+        }
+    }
+
+    // Không có Flash Encryption thì partition nvs_keys nằm dạng rõ trên flash
+    if (!esp_flash_encryption_enabled())
+    {
+        Serial.println("[Session] Flash encryption disabled, session resume unavailable");
+        return false;
+    }
+
+    const esp_partition_t *keyPart =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_NVS_KEYS, NULL);
+    if (!keyPart)
+    {
+        Serial.println("[Session] No nvs_keys partition, session resume unavailable");
+        return false;
+    }
+
+    // Key XTS sinh 1 lần trên thiết bị, ghi vào nvs_keys (được Flash Encryption mã hóa)
+    nvs_sec_cfg_t cfg;
+    esp_err_t err = nvs_flash_read_security_cfg(keyPart, &cfg);
+    if (err == ESP_ERR_NVS_KEYS_NOT_INITIALIZED || err == ESP_ERR_NVS_CORRUPT_KEY_PART)
+        err = nvs_flash_generate_keys(keyPart, &cfg);
+    if (err == ESP_OK)
+    {
+        err = nvs_flash_secure_init_partition(SESSION_NVS_PARTITION, &cfg);
+        if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND)
+        {
+            nvs_flash_erase_partition(SESSION_NVS_PARTITION);
+            err = nvs_flash_secure_init_partition(SESSION_NVS_PARTITION, &cfg);
+        }
+    }
+    memset(&cfg, 0, sizeof(cfg));
+    if (err != ESP_OK)
+    {
+        Serial.printf("[Session] Encrypted NVS init failed: %s\n", esp_err_to_name(err));
+        return false;
+    }
+
+    _state = STORE_READY;
+    return true;
+}
+
+bool SessionStore::save(const uint8_t *aesKey, const uint8_t *sessionId, uint32_t epoch)
+{
+    if (!open())
+        return false;
+
+    uint8_t blob[SESSION_BLOB_LEN];
+    blob[0] = SESSION_BLOB_VERSION;
+    memcpy(blob + 1, aesKey, 32);
+    memcpy(blob + 1 + 32, sessionId, SESSION_ID_LEN);
+    memcpy(blob + 1 + 32 + SESSION_ID_LEN, &epoch, 4);
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open_from_partition(SESSION_NVS_PARTITION, SESSION_NS, NVS_READWRITE, &handle);
+    if (err == ESP_OK)
+    {
+        err = nvs_set_blob(handle, "blob", blob, sizeof(blob));
+        if (err == ESP_OK)
+            err = nvs_commit(handle);
+        nvs_close(handle);
+    }
+    memset(blob, 0, sizeof(blob));
+    return err == ESP_OK;
+}
+
+bool SessionStore::load(uint8_t *aesKey, uint8_t *sessionId, uint32_t *epoch)
+{
+    if (!open())
+        return false;
+
+    uint8_t blob[SESSION_BLOB_LEN];
+    size_t len = sizeof(blob);
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open_from_partition(SESSION_NVS_PARTITION, SESSION_NS, NVS_READONLY, &handle);
+    if (err == ESP_OK)
+    {
+        err = nvs_get_blob(handle, "blob", blob, &len);
+        nvs_close(handle);
+    }
+    bool ok = err == ESP_OK && len == sizeof(blob) && blob[0] == SESSION_BLOB_VERSION;
+    if (ok)
+    {
+        memcpy(aesKey, blob + 1, 32);
+        memcpy(sessionId, blob + 1 + 32, SESSION_ID_LEN);
+        memcpy(epoch, blob + 1 + 32 + SESSION_ID_LEN, 4);
+    }
+    memset(blob, 0, sizeof(blob));
+    return ok;
+}
+
+void SessionStore::clear()
+{
+    if (!open())
+        return;
+
+    nvs_handle_t handle;
+    if (nvs_open_from_partition(SESSION_NVS_PARTITION, SESSION_NS, NVS_READWRITE, &handle) == ESP_OK)
+    {
+        nvs_erase_key(handle, "blob");
+        nvs_commit(handle);
+        nvs_close(handle);
+    }
+}
@@ -0,0 +1,225 @@
+#include "WifiManager.h"
+#include <Preferences.h>
+
+static const char *WIFI_NS = "wifi";
+static const uint8_t WIFI_CACHE_VERSION = 1;
+static const uint32_t WIFI_POLL_MS = 20;
+
+#define LEASE_STATE_MAGIC 0x4C534531
+
+// RTC slow memory: còn nguyên qua deep sleep, mất khi mất nguồn hoặc reset cứng
+struct LeaseState
+{
+    uint32_t magic;  // Hợp lệ khi đã có 1 lần DHCP từ lúc cấp nguồn
+    uint32_t reuses; // Số lần dùng lại lease kể từ lần DHCP gần nhất
+};
+static RTC_DATA_ATTR LeaseState leaseState;
+
+volatile uint32_t WifiManager::_associatedAt = 0;
+volatile uint32_t WifiManager::_gotIpAt = 0;
+
+// Chạy trong task sự kiện của WiFi: chỉ ghi lại thời điểm
+void WifiManager::onEvent(arduino_event_id_t event)
+{
+    if (event == ARDUINO_EVENT_WIFI_STA_CONNECTED)
+        _associatedAt = millis();
+    else if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP)
+        _gotIpAt = millis();
+}
+
+// FNV-1a
+uint32_t WifiManager::hashSsid(const char *ssid)
+{
+    uint32_t h = 2166136261UL;
+    while (*ssid)
+    {
+        h ^= (uint8_t)*ssid++;
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+void WifiManager::begin(const char *ssid, const char *pass)
+{
+    _ssid = ssid;
+    _pass = pass;
+
+    // Cấu hình WiFi do firmware tự quản lý, không để SDK ghi flash mỗi lần begin()
+    WiFi.persistent(false);
+    WiFi.mode(WIFI_STA);
+    WiFi.onEvent(onEvent, ARDUINO_EVENT_WIFI_STA_CONNECTED);
+    WiFi.onEvent(onEvent, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+
+    loadCache();
+}
+
+void WifiManager::loadCache()
+{
+    Preferences prefs;
+    prefs.begin(WIFI_NS, true);
+    size_t len = prefs.getBytes("cache", &_cache, sizeof(_cache));
+    prefs.end();
+
+    _cacheValid = len == sizeof(_cache) && _cache.version == WIFI_CACHE_VERSION &&
+                  _cache.ssidHash == hashSsid(_ssid) && _cache.channel != 0;
+    if (_cacheValid)
+        Serial.printf("[WiFi] Cached AP %02x:%02x:%02x:%02x:%02x:%02x on channel %u\n",
+                      _cache.bssid[0], _cache.bssid[1], _cache.bssid[2],
+                      _cache.bssid[3], _cache.bssid[4], _cache.bssid[5], _cache.channel);
+}
+
+void WifiManager::saveCache()
+{
+    WifiCache fresh;
+    memset(&fresh, 0, sizeof(fresh));
+    fresh.version = WIFI_CACHE_VERSION;
+    fresh.channel = (uint8_t)WiFi.channel();
+    memcpy(fresh.bssid, WiFi.BSSID(), sizeof(fresh.bssid));
+    fresh.ssidHash = hashSsid(_ssid);
+    fresh.ip = (uint32_t)WiFi.localIP();
+    fresh.gateway = (uint32_t)WiFi.gatewayIP();
+    fresh.subnet = (uint32_t)WiFi.subnetMask();
+    fresh.dns = (uint32_t)WiFi.dnsIP();
+
+    // Chỉ ghi NVS khi có thay đổi (đỡ mòn flash khi reconnect liên tục)
+    if (_cacheValid && memcmp(&fresh, &_cache, sizeof(fresh)) == 0)
+        return;
+
+    Preferences prefs;
+    prefs.begin(WIFI_NS, false);
+    prefs.putBytes("cache", &fresh, sizeof(fresh));
+    prefs.end();
+    _cache = fresh;
+    _cacheValid = true;
+}
+
+void WifiManager::forget()
+{
+    Preferences prefs;
+    prefs.begin(WIFI_NS, false);
+    prefs.remove("cache");
+    prefs.end();
+    _cacheValid = false;
+}
+
+bool WifiManager::staticConfig(IPAddress &ip, IPAddress &gateway, IPAddress &subnet, IPAddress &dns)
+{
+    if (WIFI_STATIC_IP[0] == '\0')
+        return false;
+    if (!ip.fromString(WIFI_STATIC_IP) || !gateway.fromString(WIFI_STATIC_GATEWAY) ||
+        !subnet.fromString(WIFI_STATIC_SUBNET))
+        return false;
+    if (!dns.fromString(WIFI_STATIC_DNS))
+        dns = gateway;
+    return true;
+}
+
+bool WifiManager::waitConnected(uint32_t startMs, uint32_t timeoutMs, bool (*abortFn)())
+{
+    while (WiFi.status() != WL_CONNECTED)
+    {
+        if (millis() - startMs >= timeoutMs || (abortFn && abortFn()))
+            return false;
+        delay(WIFI_POLL_MS);
+    }
+    return true;
+}
+
+bool WifiManager::connect(bool (*abortFn)())
+{
+    if (!_ssid || _ssid[0] == '\0')
+        return false;
+
+    uint32_t startMs = millis();
+    uint32_t attemptMs = startMs;
+    IPAddress ip, gateway, subnet, dns;
+    bool haveStatic = staticConfig(ip, gateway, subnet, dns);
+    bool ok = false;
+    bool fast = false;
+    bool leaseReused = false;
+
+    _associatedAt = 0;
+    _gotIpAt = 0;
+
+    // 1. Đường nhanh: đúng BSSID/kênh đã nhớ, IP tĩnh hoặc lease cũ thay cho DHCP
+    if (_cacheValid)
+    {
+        // Lease chỉ dùng lại khi đã DHCP từ lúc cấp nguồn và chưa quá WIFI_LEASE_MAX_REUSES lần
+        bool reuseLease = !haveStatic && WIFI_REUSE_LEASE && _cache.ip != 0 &&
+                          leaseState.magic == LEASE_STATE_MAGIC && leaseState.reuses < WIFI_LEASE_MAX_REUSES;
+        if (haveStatic)
+            WiFi.config(ip, gateway, subnet, dns);
+        else if (reuseLease)
+            WiFi.config(IPAddress(_cache.ip), IPAddress(_cache.gateway), IPAddress(_cache.subnet), IPAddress(_cache.dns));
+        else
+            WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+
+        Serial.printf("[WiFi] Fast connect to %s (channel %u)...\n", _ssid, _cache.channel);
+        WiFi.begin(_ssid, _pass, _cache.channel, _cache.bssid);
+        ok = waitConnected(attemptMs, WIFI_FAST_TIMEOUT_MS, abortFn);
+        fast = ok;
+        leaseReused = ok && reuseLease;
+
+        if (!ok)
+        {
+            if (abortFn && abortFn())
+                return false;
+            Serial.printf("[WiFi] Fast connect failed after %lu ms, falling back to full scan\n",
+                          (unsigned long)(millis() - attemptMs));
+            WiFi.disconnect();
+        }
+    }
+
+    // 2. Đường đầy đủ: quét mọi kênh + DHCP (hoặc IP tĩnh)
+    if (!ok)
+    {
+        if (haveStatic)
+            WiFi.config(ip, gateway, subnet, dns);
+        else
+            WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+
+        Serial.printf("[WiFi] Connecting to %s...\n", _ssid);
+        attemptMs = millis();
+        _associatedAt = 0;
+        _gotIpAt = 0;
+        WiFi.begin(_ssid, _pass);
+        ok = waitConnected(attemptMs, WIFI_SCAN_TIMEOUT_MS, abortFn);
+    }
+
+    uint32_t now = millis();
+    _timings.totalMs = now - startMs;
+    _timings.fast = fast;
+    if (!ok)
+    {
+        Serial.printf("[WiFi] FAILED after %lu ms\n", (unsigned long)_timings.totalMs);
+        return false;
+    }
+
+    // Sự kiện có thể tới trễ hơn WiFi.status() một chút: lấy thời điểm hiện tại làm cận trên
+    uint32_t associatedAt = _associatedAt ? _associatedAt : now;
+    uint32_t gotIpAt = _gotIpAt ? _gotIpAt : now;
+    _timings.associateMs = associatedAt - attemptMs;
+    _timings.ipMs = gotIpAt >= associatedAt ? gotIpAt - associatedAt : 0;
+
+    IPAddress localIp = WiFi.localIP();
+    Serial.printf("[WiFi] CONNECTED (%s): associate %lu ms, ip %lu ms, total %lu ms, boot->online %lu ms, IP %u.%u.%u.%u\n",
+                  fast ? "fast" : "scan", (unsigned long)_timings.associateMs, (unsigned long)_timings.ipMs,
+                  (unsigned long)_timings.totalMs, (unsigned long)now, localIp[0], localIp[1], localIp[2], localIp[3]);
+
+    // Lease vừa lấy qua DHCP thì bắt đầu đếm lại số lần dùng lại
+    if (!haveStatic)
+    {
+        if (leaseReused)
+        {
+            leaseState.reuses++;
+        }
+        else
+        {
+            leaseState.magic = LEASE_STATE_MAGIC;
+            leaseState.reuses = 0;
+        }
+    }
+
+    saveCache();
+    return true;
+}
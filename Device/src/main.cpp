@@ -1,26 +1,162 @@
 #include <Arduino.h>
 #include <WiFi.h>
-#include <HTTPClient.h>
-#include <Preferences.h> // Thư viện lưu flash
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
+#include <freertos/queue.h>
+#include <esp_sleep.h>
 
 #include "ButtonHandler.h"
 #include "HotspotManager.h"
 #include "CryptoESP.h"
 #include "MqttManager.h"
+#include "BatchBuffer.h"
+#include "OfflineQueue.h"
+#include "Pipeline.h"
+#include "SessionStore.h"
+#include "WifiManager.h"
+#include "ConfigStore.h"
+#include "KeyExchange.h"
+#include "PayloadCompressor.h"
+#include "EdgeAggregator.h"
 
 // ==========================================
 // 1. CẤU HÌNH & BIẾN TOÀN CỤC
 // ==========================================
 
 // Objects
-ButtonHandler btn(14, 3000, true); // GPIO 14, Long Press 3s
+#define BUTTON_PIN 14
+ButtonHandler btn(BUTTON_PIN, 3000, true); // GPIO 14, Long Press 3s (theo ngắt, xem ButtonHandler.h)
 HotspotManager hotspot("ESP32_SECURE_DEVICE", "12345678");
 CryptoESP crypto;
 MqttManager *mqtt = NULL; // Dùng con trỏ để khởi tạo động sau khi load config
-Preferences preferences;  // Lưu cấu hình vào Flash
+ConfigStore configStore;  // Lưu cấu hình vào Flash (1 bản ghi nhị phân trong NVS)
+WifiManager wifi;         // Kết nối nhanh bằng BSSID/kênh/IP đã nhớ (chỉ NetTask dùng)
+
+// Định dạng gói tin gửi đi: 0 = JSON/Base64 (esp32/data), 1 = nhị phân (esp32/bin)
+#ifndef USE_BINARY_PACKET
+#define USE_BINARY_PACKET 0
+#endif
+
+const char *TOPIC_DATA = "esp32/data";
+const char *TOPIC_BIN = "esp32/bin";
+#define TOPIC_METRICS_PREFIX "esp32/metrics/" // + device id
+
+// Trao đổi khóa qua MQTT (xem KeyExchange.h). 1 = vẫn hỗ trợ HTTP khi cấu hình có key_url
+// (kéo theo HTTPClient + ArduinoJson và 1 kết nối TCP riêng), key_url rỗng thì vẫn dùng MQTT.
+#ifndef KEY_EXCHANGE_HTTP
+#define KEY_EXCHANGE_HTTP 0
+#endif
+// Gửi/nhận public key dạng nén 33 byte thay vì 64 byte X||Y
+#ifndef KEY_EXCHANGE_COMPRESSED
+#define KEY_EXCHANGE_COMPRESSED 1
+#endif
+#ifndef KEY_EXCHANGE_TIMEOUT_MS
+#define KEY_EXCHANGE_TIMEOUT_MS 5000
+#endif
+// Nén plaintext trước khi mã hóa (PACKET_FLAG_COMPRESSED), tự bỏ qua gói nén không nhỏ hơn.
+// Chỉ có lợi khi plaintext lặp lại nhiều (batch JSON), tốn ~2 KB RAM cho bảng hash.
+#ifndef PAYLOAD_COMPRESSION
+#define PAYLOAD_COMPRESSION 0
+#endif
+// Task ưu tiên thấp sinh sẵn cặp khóa ECDH dự phòng, rekey chỉ cần hoán đổi
+#ifndef SPARE_KEY_PRECOMPUTE
+#define SPARE_KEY_PRECOMPUTE 1
+#endif
+#if KEY_EXCHANGE_HTTP
+#include <HTTPClient.h>
+#include "JsonArena.h"
+#endif
+
+// Chu kỳ publish metrics thiết bị (JSON không mã hóa, không chứa dữ liệu cảm biến), 0 = tắt
+#ifndef METRICS_INTERVAL_MS
+#define METRICS_INTERVAL_MS 60000
+#endif
+// Đồng bộ giờ để gắn giờ gửi (Unix ms) vào mỗi gói, "" = tắt (giờ gửi luôn là 0)
+#ifndef SNTP_SERVER
+#define SNTP_SERVER "pool.ntp.org"
+#endif
+
+// Chu kỳ lấy mẫu & batching: gom N bản ghi hoặc chờ tối đa T ms rồi gửi 1 gói
+#ifndef SAMPLE_INTERVAL_MS
+#define SAMPLE_INTERVAL_MS 30000
+#endif
+#ifndef BATCH_MAX_RECORDS
+#define BATCH_MAX_RECORDS 1 // 1 = tắt batching, mỗi bản ghi 1 gói như cũ
+#endif
+#ifndef BATCH_MAX_AGE_MS
+#define BATCH_MAX_AGE_MS 60000
+#endif
+
+// Lấy mẫu cục bộ mỗi SENSOR_SAMPLE_MS & gộp theo cửa sổ (EdgeAggregator): chỉ gửi 1 bản ghi
+// min/max/mean/last khi một kênh vượt deadband hoặc hết REPORT_HEARTBEAT_MS.
+// 0 = mỗi SAMPLE_INTERVAL_MS gửi 1 bản ghi "Data: <millis>" như cũ.
+#ifndef EDGE_AGGREGATION
+#define EDGE_AGGREGATION 1
+#endif
+#ifndef SENSOR_SAMPLE_MS
+#define SENSOR_SAMPLE_MS 1000
+#endif
+#ifndef REPORT_HEARTBEAT_MS
+#define REPORT_HEARTBEAT_MS 300000
+#endif
+// Khoảng cách tối thiểu giữa 2 lần gửi do thay đổi (chống bão gói khi giá trị dao động mạnh)
+#ifndef REPORT_MIN_INTERVAL_MS
+#define REPORT_MIN_INTERVAL_MS 5000
+#endif
+#ifndef TEMP_DEADBAND
+#define TEMP_DEADBAND 0.5f // °C, cảm biến nhiệt trong chip
+#endif
+#ifndef HALL_DEADBAND
+#define HALL_DEADBAND 10.0f // Cảm biến Hall trong chip, nhiễu ~ +-5
+#endif
+
+#if EDGE_AGGREGATION
+EdgeAggregator aggregator(REPORT_HEARTBEAT_MS, REPORT_MIN_INTERVAL_MS); // Chỉ SampleTask dùng
+#endif
+BatchBuffer batch(BATCH_MAX_RECORDS, BATCH_MAX_AGE_MS); // Chỉ CryptoTask dùng
+OfflineQueue offlineQueue; // Lưu gói tin vào flash khi mất WiFi/MQTT (chỉ NetTask dùng)
+
+// Buffer gói tin tĩnh cho mỗi đầu queue (OutPacket lớn, không đặt trên stack)
+static OutPacket cryptoOut; // CryptoTask
+static OutPacket netIn;     // NetTask
+
+// Plaintext kèm header [seq][giờ gửi] (PACKET_FLAG_SEQ), chỉ CryptoTask dùng
+static uint8_t framed[SEQ_HEADER_LEN + BATCH_MAX_BYTES];
+#if PAYLOAD_COMPRESSION
+static PayloadCompressor compressor;
+static uint8_t packed[SEQ_HEADER_LEN + BATCH_MAX_BYTES]; // framed sau khi nén, chỉ CryptoTask dùng
+#endif
+uint32_t packetSeq = 0; // Tăng sau mỗi gói mã hóa thành công, decoder dùng để đo mất/đảo gói
+
+// Pipeline: queue giữa các tầng & bộ đếm backpressure
+QueueHandle_t sampleQueue = NULL;
+QueueHandle_t publishQueue = NULL;
+SemaphoreHandle_t cryptoMutex = NULL; // Bảo vệ crypto giữa NetTask (rekey) và CryptoTask (mã hóa)
+PipelineStats stats = {};
+
+// Lưu session key vào NVS mã hóa để gửi ngay sau reboot rồi rekey nền (xem SessionStore.h).
+// Cần Flash Encryption + partition table có nvs_keys (env esp-wrover-kit-session),
+// thiếu thì thiết bị tự quay về trao đổi khóa mỗi lần boot.
+#ifndef SESSION_RESUME
+#define SESSION_RESUME 0
+#endif
+
+SessionStore sessionStore;
+bool sessionResumed = false;          // Boot lần này dùng session đã lưu
+volatile bool firstPublishDone = false; // Đã đo time-to-first-publish chưa
+
+// Chế độ tiết kiệm pin: mỗi chu kỳ thức dậy -> lấy mẫu -> mã hóa -> publish -> deep sleep,
+// không chạy các task. Session key, nonce counter & seq giữ trong RTC memory nên không
+// phải trao đổi khóa lại sau mỗi lần thức. Giữ nút lúc thức dậy để vào chế độ thường (cấu hình).
+#ifndef DEEP_SLEEP_MODE
+#define DEEP_SLEEP_MODE 0
+#endif
+#ifndef DEEP_SLEEP_INTERVAL_MS
+#define DEEP_SLEEP_INTERVAL_MS SAMPLE_INTERVAL_MS
+#endif
+uint32_t wakeCount = 0;   // Số lần thức dậy từ deep sleep (0 ở chế độ thường)
+uint32_t lastAwakeMs = 0; // Thời gian thức của chu kỳ trước (boot -> bắt đầu ngủ)
 
 // Trạng thái hệ thống
 enum SystemState {
@@ -36,79 +172,85 @@ volatile bool wifiConnected = false;
 // Task Handles
 TaskHandle_t taskNetHandle = NULL;
 TaskHandle_t taskInputHandle = NULL;
+TaskHandle_t taskSampleHandle = NULL;
+TaskHandle_t taskCryptoHandle = NULL;
+TaskHandle_t taskKeygenHandle = NULL;
 
-// Biến lưu cấu hình (Load từ Flash)
-struct {
-    String wifi_ssid = "";
-    String wifi_pass = "";
-    String mqtt_server = "";
-    int    mqtt_port = 1883;
-    String mqtt_user = "";
-    String mqtt_pass = "";
-    String key_url = "";
-} sysConfig;
+// Biến lưu cấu hình (Load từ Flash), buffer cố định
+DeviceConfig sysConfig;
 
 // ==========================================
-// 2. HÀM HỖ TRỢ (PREFERENCES & HTTP)
+// 2. HÀM HỖ TRỢ (CẤU HÌNH & TRAO ĐỔI KHÓA)
 // ==========================================
 
 void loadConfig() {
-    preferences.begin("my-app", true); // Read-only mode
-    sysConfig.wifi_ssid = preferences.getString("ssid", "");
-    sysConfig.wifi_pass = preferences.getString("pass", "");
-    sysConfig.mqtt_server = preferences.getString("mq_srv", "");
-    sysConfig.mqtt_port = preferences.getInt("mq_port", 1883);
-    sysConfig.mqtt_user = preferences.getString("mq_usr", "");
-    sysConfig.mqtt_pass = preferences.getString("mq_pwd", "");
-    sysConfig.key_url = preferences.getString("key_url", "");
-    preferences.end();
+    configStore.load(sysConfig); // 1 lần đọc NVS, tự chuyển từ layout cũ nếu cần
 
     Serial.println(">>> CONFIG LOADED <<<");
-    Serial.println("SSID: " + sysConfig.wifi_ssid);
-    Serial.println("Key URL: " + sysConfig.key_url);
+    Serial.printf("SSID: %s\n", sysConfig.wifiSsid);
+    Serial.printf("Key URL: %s\n", sysConfig.keyUrl);
 }
 
-void saveConfig(ConfigData data) {
-    preferences.begin("my-app", false); // Read-write mode
-    preferences.putString("ssid", data.wifi_ssid);
-    preferences.putString("pass", data.wifi_pass);
-    preferences.putString("mq_srv", data.mqtt_server);
-    preferences.putInt("mq_port", data.mqtt_port);
-    preferences.putString("mq_usr", data.mqtt_user);
-    preferences.putString("mq_pwd", data.mqtt_pass);
-    preferences.putString("key_url", data.key_exchange_url);
-    preferences.end();
-    Serial.println(">>> CONFIG SAVED TO FLASH <<<");
+void saveConfig(const DeviceConfig &data) {
+    if (configStore.save(data)) Serial.println(">>> CONFIG SAVED TO FLASH <<<");
 }
 
-// Hàm trao đổi khóa HTTP
-bool performKeyExchange() {
-    if (WiFi.status() != WL_CONNECTED || sysConfig.key_url == "") return false;
+#if SESSION_RESUME
+// Gọi trong CryptoTask (đang giữ cryptoMutex) mỗi khi key ratchet sang epoch mới:
+// lưu key mới trước khi dùng để sau reboot không lặp lại nonce của epoch cũ
+void onKeyRatchet(const uint8_t *key, uint32_t epoch) {
+    if (crypto.hasSessionId()) sessionStore.save(key, crypto.getSessionId(), epoch);
+    Serial.printf("[Crypto] Key ratcheted to epoch %lu\n", (unsigned long)epoch);
+}
+#endif
 
-    HTTPClient http;
-    http.begin(sysConfig.key_url);
-    http.addHeader("Content-Type", "application/json");
+// Lưu session vừa trao đổi để resume sau reboot
+void onKeyExchanged() {
+    Serial.println("[Crypto] Key Exchange SUCCESS!");
+#if SESSION_RESUME
+    if (crypto.hasSessionId()) sessionStore.save(crypto.getSessionKey(), crypto.getSessionId(), crypto.getEpoch());
+#endif
+}
+
+#if KEY_EXCHANGE_HTTP
+// Trao đổi khóa qua HTTP (key_url)
+bool performKeyExchangeHttp() {
+    if (WiFi.status() != WL_CONNECTED) return false;
 
-    // Lấy Public Key hiện tại của ESP32
-    DynamicJsonDocument doc(256);
-    doc["device"] = "esp32";
-    doc["publicKey"] = crypto.getPublicKeyHex();
+    // Body nhỏ & cố định: ghi thẳng vào buffer, không qua String/JsonDocument
+    char requestBody[64 + DEVICE_ID_LEN + PUBLIC_KEY_HEX_SIZE];
+    char publicKeyHex[PUBLIC_KEY_HEX_SIZE];
+    xSemaphoreTake(cryptoMutex, portMAX_DELAY);
+    crypto.getPublicKeyHex(publicKeyHex, sizeof(publicKeyHex));
+    xSemaphoreGive(cryptoMutex);
+    int bodyLen = snprintf(requestBody, sizeof(requestBody), "{\"device\":\"%s\",\"publicKey\":\"%s\"}",
+                           crypto.getDeviceId(), publicKeyHex);
 
-    String requestBody;
-    serializeJson(doc, requestBody);
+    HTTPClient http;
+    http.begin(sysConfig.keyUrl);
+    http.addHeader("Content-Type", "application/json");
 
     Serial.println("[HTTP] Sending Public Key...");
-    int httpCode = http.POST(requestBody);
+    int httpCode = http.POST((uint8_t *)requestBody, bodyLen);
     
     bool success = false;
     if (httpCode == 200) {
-        String payload = http.getString();
-        DynamicJsonDocument res(512);
-        deserializeJson(res, payload);
+        // Parse thẳng từ socket vào JsonDocument dùng arena tĩnh: không String, không heap
+        static JsonArena<1536> keyJsonArena;
+        JsonDocument res(&keyJsonArena);
+        DeserializationError err = deserializeJson(res, http.getStream());
+        if (err) Serial.printf("[HTTP] Bad reply: %s\n", err.c_str());
         const char *laptopHex = res["publicKey"];
-        
-        if (laptopHex && crypto.setPeerPublicKeyHex(laptopHex)) {
-            Serial.println("[Crypto] Key Exchange SUCCESS!");
+
+        const char *sessionHex = res["sessionId"];
+
+        // Đổi key & session id trong cùng 1 lần khóa để CryptoTask không dùng lẫn
+        xSemaphoreTake(cryptoMutex, portMAX_DELAY);
+        bool keyOk = laptopHex && crypto.setPeerPublicKeyHex(laptopHex);
+        if (keyOk && sessionHex) crypto.setSessionIdHex(sessionHex);
+        xSemaphoreGive(cryptoMutex);
+        if (keyOk) {
+            onKeyExchanged();
             success = true;
         }
     } else {
@@ -117,144 +259,632 @@ bool performKeyExchange() {
     http.end();
     return success;
 }
+#endif
+
+// Response trao đổi khóa nhận qua MQTT (onMqttMessage ghi, pollKeyExchangeMqtt đọc; cùng 1 task)
+static uint8_t kxReply[KX_RESPONSE_MAX];
+static size_t kxReplyLen = 0;
+static char kxResTopic[sizeof(TOPIC_KX_RES_PREFIX) + DEVICE_ID_LEN];
+static uint16_t kxRequestId = 0;
+// Request đang chờ response: reqId (0 = không có) & thời điểm gửi
+static uint16_t kxPendingId = 0;
+static uint32_t kxSentAt = 0;
+
+// Kết quả của 1 bước trao đổi khóa
+enum KxResult {
+    KX_PENDING, // Đã gửi request, chờ response (NetTask vẫn publish bằng key cũ)
+    KX_DONE,
+    KX_FAILED
+};
+
+// Tin nhắn đến, gọi từ mqtt->loop() trong task đang chạy MQTT
+void onMqttMessage(char *topic, uint8_t *payload, unsigned int len) {
+    if (strcmp(topic, kxResTopic) == 0 && len <= sizeof(kxReply)) {
+        memcpy(kxReply, payload, len);
+        kxReplyLen = len;
+    }
+}
+
+// Gửi request trao đổi khóa qua kết nối MQTT đang mở, không chờ response
+bool startKeyExchangeMqtt() {
+    if (!mqtt || !mqtt->connected()) return false;
+
+    char reqTopic[sizeof(TOPIC_KX_REQ_PREFIX) + DEVICE_ID_LEN];
+    snprintf(reqTopic, sizeof(reqTopic), TOPIC_KX_REQ_PREFIX "%s", crypto.getDeviceId());
+    snprintf(kxResTopic, sizeof(kxResTopic), TOPIC_KX_RES_PREFIX "%s", crypto.getDeviceId());
+    // SUBSCRIBE đi trước request trên cùng kết nối nên broker đã đăng ký khi có response
+    if (!mqtt->subscribe(kxResTopic)) return false;
+
+    uint8_t publicKey[64];
+    xSemaphoreTake(cryptoMutex, portMAX_DELAY);
+#if KEY_EXCHANGE_COMPRESSED
+    crypto.getPublicKeyCompressed(publicKey);
+    size_t publicKeyLen = ECDH_COMPRESSED_KEY_LEN;
+#else
+    memcpy(publicKey, crypto.getPublicKeyRaw(), 64);
+    size_t publicKeyLen = 64;
+#endif
+    xSemaphoreGive(cryptoMutex);
+
+    if (kxRequestId == 0) kxRequestId = (uint16_t)random(0xFFFF);
+    if (++kxRequestId == 0) kxRequestId = 1; // 0 dành cho "không có request"
+    uint8_t request[KX_REQUEST_MAX];
+    size_t requestLen = kxEncodeRequest(request, sizeof(request), kxRequestId, publicKey, publicKeyLen);
+    kxReplyLen = 0;
+    kxPendingId = 0;
+    if (!mqtt->publish(reqTopic, request, requestLen, 1)) return false;
+    kxPendingId = kxRequestId;
+    kxSentAt = millis();
+    Serial.printf("[KX] Public key sent over MQTT (%u bytes)\n", (unsigned)requestLen);
+    return true;
+}
+
+// Bỏ request đang chờ (vd. vừa tạo cặp khóa khác): response tới sau bị bỏ qua
+void cancelKeyExchangeMqtt() {
+    kxPendingId = 0;
+    kxReplyLen = 0;
+}
+
+// Kiểm tra response của request đang chờ (gọi sau mqtt->loop()), đổi key khi có
+KxResult pollKeyExchangeMqtt() {
+    if (kxPendingId == 0) return KX_FAILED;
+
+    KxResponse res;
+    bool answered = false;
+    if (kxReplyLen > 0) {
+        answered = kxParseResponse(kxReply, kxReplyLen, &res) && res.reqId == kxPendingId;
+        kxReplyLen = 0; // Response của request cũ (vd. lần thử trước đã timeout): bỏ qua
+    }
+    if (!answered) {
+        if (millis() - kxSentAt < KEY_EXCHANGE_TIMEOUT_MS && mqtt && mqtt->connected()) return KX_PENDING;
+        Serial.println("[KX] No response");
+        kxPendingId = 0;
+        return KX_FAILED;
+    }
+    kxPendingId = 0;
+    if (res.status != KX_STATUS_OK) {
+        Serial.printf("[KX] Rejected, status %u\n", res.status);
+        return KX_FAILED;
+    }
+
+    // Đổi key & session id trong cùng 1 lần khóa để CryptoTask không dùng lẫn
+    xSemaphoreTake(cryptoMutex, portMAX_DELAY);
+    bool keyOk = res.publicKeyLen == ECDH_COMPRESSED_KEY_LEN ? crypto.setPeerPublicKeyCompressed(res.publicKey)
+                                                              : crypto.setPeerPublicKeyRaw(res.publicKey);
+    if (keyOk) crypto.setSessionId(res.sessionId);
+    xSemaphoreGive(cryptoMutex);
+    if (!keyOk) return KX_FAILED;
+    onKeyExchanged();
+    return KX_DONE;
+}
+
+// Trao đổi khóa qua MQTT, chặn tới khi có response (chỉ dùng ở chế độ deep sleep,
+// nơi không có NetTask phải giữ nhịp publish)
+bool performKeyExchangeMqtt() {
+    if (!startKeyExchangeMqtt()) return false;
+    for (;;) {
+        mqtt->loop();
+        KxResult r = pollKeyExchangeMqtt();
+        if (r != KX_PENDING) return r == KX_DONE;
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+}
+
+// Kênh trao đổi khóa đã sẵn sàng chưa (MQTT đã kết nối, hoặc WiFi nếu dùng HTTP)
+bool keyTransportReady() {
+#if KEY_EXCHANGE_HTTP
+    if (sysConfig.keyUrl[0] != '\0') return WiFi.status() == WL_CONNECTED;
+#endif
+    return mqtt && mqtt->connected();
+}
+
+bool performKeyExchange() {
+#if KEY_EXCHANGE_HTTP
+    if (sysConfig.keyUrl[0] != '\0') return performKeyExchangeHttp();
+#endif
+    return performKeyExchangeMqtt();
+}
+
+// Bắt đầu trao đổi khóa từ NetTask: MQTT chỉ gửi request (KX_PENDING, kết quả lấy qua
+// pollKeyExchangeMqtt() ở các vòng lặp sau); HTTP vẫn chặn tới khi server trả lời.
+KxResult beginKeyExchange() {
+#if KEY_EXCHANGE_HTTP
+    if (sysConfig.keyUrl[0] != '\0') return performKeyExchangeHttp() ? KX_DONE : KX_FAILED;
+#endif
+    return startKeyExchangeMqtt() ? KX_PENDING : KX_FAILED;
+}
+
+// Giờ Unix (ms) theo SNTP, 0 nếu chưa đồng bộ
+uint64_t unixTimeMs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    if (tv.tv_sec < 1600000000) return 0;
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+// Metrics thiết bị: JSON nhỏ build vào buffer tĩnh, publish thẳng từ NetTask.
+// Stack high-water mark tính bằng byte (ESP-IDF), càng nhỏ càng gần tràn.
+// Chế độ deep sleep không tạo task nào nên bỏ hẳn object "stack"
+// (uxTaskGetStackHighWaterMark(NULL) là stack của chính task đang gọi).
+static unsigned stackFree(TaskHandle_t task) {
+    return task ? (unsigned)uxTaskGetStackHighWaterMark(task) : 0;
+}
+
+void publishMetrics() {
+    static uint32_t metricsSeq = 0;
+    static char topic[sizeof(TOPIC_METRICS_PREFIX) + DEVICE_ID_LEN];
+    static char body[896];
+
+    snprintf(topic, sizeof(topic), TOPIC_METRICS_PREFIX "%s", crypto.getDeviceId());
+    uint32_t encrypted = stats.packetsEncrypted;
+#if EDGE_AGGREGATION
+    uint32_t aggReports = aggregator.reports(), aggChanges = aggregator.changeReports();
+#else
+    uint32_t aggReports = stats.samplesProduced, aggChanges = 0; // Mỗi mẫu là 1 bản ghi
+#endif
+    char stack[96] = "";
+    if (taskNetHandle)
+        snprintf(stack, sizeof(stack), "\"stack\":{\"net\":%u,\"input\":%u,\"sample\":%u,\"crypto\":%u},",
+                 stackFree(taskNetHandle), stackFree(taskInputHandle), stackFree(taskSampleHandle),
+                 stackFree(taskCryptoHandle));
+    int n = snprintf(body, sizeof(body),
+        "{\"seq\":%lu,\"uptime\":%lu,\"ts\":%llu,"
+        "\"heap\":{\"free\":%lu,\"min\":%lu},"
+        "%s"
+        "\"encryptUs\":{\"last\":%lu,\"max\":%lu,\"avg\":%lu},"
+        "\"rekeyUs\":{\"last\":%lu,\"max\":%lu,\"spare\":%d},\"netLoopMaxUs\":%lu,"
+        "\"compress\":{\"in\":%lu,\"out\":%lu,\"skipped\":%lu},"
+        "\"publish\":{\"ok\":%lu,\"fail\":%lu,\"stored\":%lu,\"dropped\":%lu},"
+        "\"reconnects\":%lu,"
+        "\"sleep\":{\"wakes\":%lu,\"awakeMs\":%lu},"
+        "\"wifi\":{\"connectMs\":%lu,\"fast\":%d,\"rssi\":%d},"
+        "\"queues\":{\"sample\":%u,\"publish\":%u,\"offline\":%lu},"
+        "\"samples\":{\"produced\":%lu,\"dropped\":%lu,\"reports\":%lu,\"changes\":%lu}}",
+        (unsigned long)metricsSeq++, (unsigned long)millis(), (unsigned long long)unixTimeMs(),
+        (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMinFreeHeap(),
+        stack,
+        (unsigned long)stats.encryptUsLast, (unsigned long)stats.encryptUsMax,
+        (unsigned long)(encrypted ? stats.encryptUsTotal / encrypted : 0),
+        (unsigned long)stats.rekeyUsLast, (unsigned long)stats.rekeyUsMax, crypto.hasSpareKeyPair() ? 1 : 0,
+        (unsigned long)stats.netLoopUsMax,
+        (unsigned long)stats.compressBytesIn, (unsigned long)stats.compressBytesOut, (unsigned long)stats.compressSkipped,
+        (unsigned long)stats.packetsPublished, (unsigned long)mqtt->publishFailures(),
+        (unsigned long)stats.packetsStored, (unsigned long)stats.packetDrops,
+        (unsigned long)mqtt->reconnectCount(),
+        (unsigned long)wakeCount, (unsigned long)lastAwakeMs,
+        (unsigned long)wifi.timings().totalMs, wifi.timings().fast ? 1 : 0, (int)WiFi.RSSI(),
+        (unsigned)uxQueueMessagesWaiting(sampleQueue), (unsigned)uxQueueMessagesWaiting(publishQueue),
+        (unsigned long)offlineQueue.size(),
+        (unsigned long)stats.samplesProduced, (unsigned long)stats.sampleDrops,
+        (unsigned long)aggReports, (unsigned long)aggChanges);
+    // QoS 0: metrics mất 1 bản cũng không sao, không chiếm slot in-flight của dữ liệu
+    if (n > 0 && n < (int)sizeof(body)) mqtt->publish(topic, (const uint8_t *)body, n, 0);
+    stats.netLoopUsMax = 0; // Mỗi bản metrics là max của 1 chu kỳ
+}
+
+// Gọi từ mqtt->loop() khi gói QoS 1 được PUBACK hoặc thất bại (hết MQTT_MAX_RESENDS lần
+// gửi lại, hoặc disconnect() khi chưa có PUBACK). Gói thất bại được lưu vào flash để gửi lại.
+void onPublishDone(uint16_t packetId, bool delivered, const char *topic, const uint8_t *payload, size_t len, void *ctx) {
+    if (!delivered) {
+        if (payload && offlineQueue.push(topic, payload, len)) {
+            stats.packetsStored++;
+        } else {
+            stats.packetDrops++;
+        }
+        return;
+    }
+    stats.packetsPublished++;
+    if (!firstPublishDone) {
+        firstPublishDone = true;
+        Serial.printf("[Boot] Time to first publish: %lu ms (%s session)\n",
+                      (unsigned long)millis(), sessionResumed ? "resumed" : "fresh");
+    }
+}
+
+// Gói lấy từ flash: chỉ xóa khỏi hàng đợi offline khi có PUBACK, thất bại thì gửi lại ở đợt sau
+void onStoredPublishDone(uint16_t packetId, bool delivered, const char *topic, const uint8_t *payload, size_t len, void *ctx) {
+    uint32_t seq = (uint32_t)(uintptr_t)ctx;
+    if (!delivered) {
+        offlineQueue.nack(seq);
+        return;
+    }
+    offlineQueue.ack(seq);
+    stats.packetsPublished++;
+}
+
+// Publish gói đã mã hóa lấy từ hàng đợi offline (cửa sổ đầy thì dừng đợt, gói vẫn nằm trong flash)
+bool publishStored(const char *topic, const uint8_t *payload, size_t len, uint32_t seq) {
+    return mqtt && mqtt->canPublish() &&
+           mqtt->publish(topic, payload, len, 1, onStoredPublishDone, (void *)(uintptr_t)seq);
+}
+
+// Lấy các gói CryptoTask đã mã hóa ra publish (NetTask).
+// Chờ tối đa `wait` cho gói đầu tiên. Offline hoặc publish lỗi thì lưu vào flash.
+// Cửa sổ in-flight đầy thì để gói lại trong hàng đợi tới khi có PUBACK (backpressure).
+void publishFromQueue(TickType_t wait) {
+    for (;;) {
+        if (mqtt && mqtt->connected() && !mqtt->canPublish()) {
+            vTaskDelay(wait);
+            return;
+        }
+        if (xQueueReceive(publishQueue, &netIn, wait) != pdTRUE) return;
+        wait = 0;
+        // Gói gửi được chỉ được đếm khi có PUBACK (onPublishDone)
+        if (mqtt && mqtt->connected() && mqtt->publish(netIn.topic, netIn.data, netIn.len, 1, onPublishDone)) continue;
+        if (offlineQueue.push(netIn.topic, netIn.data, netIn.len)) {
+            stats.packetsStored++;
+        } else {
+            stats.packetDrops++;
+        }
+    }
+}
 
 // ==========================================
 // 3. TASK XỬ LÝ NÚT NHẤN (INPUT TASK)
 // ==========================================
-// Logic: Phân biệt Short/Long press bằng cách chờ Release
+// Logic: ButtonHandler phân biệt Short/Long press, task chỉ thức dậy khi có sự kiện
 void inputTask(void *parameter) {
     btn.begin();
-    static bool isHolding = false;
-    static unsigned long pressStart = 0;
+    ButtonEvent ev;
 
     for (;;) {
-        btn.loop(); // Cập nhật trạng thái nút
+        if (!btn.waitEvent(ev)) continue;
 
-        // 1. Phát hiện bắt đầu nhấn
-        if (btn.isPressedRaw() && !isHolding) {
-            isHolding = true;
-            pressStart = millis();
+        if (ev.type == BUTTON_LONG_PRESS) {
+            Serial.println("\n[Button] LONG PRESS DETECTED -> HOTSPOT MODE");
+            currentState = STATE_CONFIG;
+        } else if (ev.type == BUTTON_SHORT_RELEASE) {
+            Serial.printf("\n[Button] SHORT PRESS (%lums) -> RE-GEN KEY\n", (unsigned long)ev.heldMs);
+            triggerKeyExchange = true; // Bật cờ để NetworkTask xử lý
         }
+    }
+}
+
+// ==========================================
+// 4. PIPELINE: LẤY MẪU & MÃ HÓA
+// ==========================================
+
+#if EDGE_AGGREGATION
+// Thứ tự kênh phải khớp readSensors()
+void setupAggregator() {
+    aggregator.addChannel("temp", TEMP_DEADBAND, 1);
+    aggregator.addChannel("hall", HALL_DEADBAND, 0);
+}
+
+void readSensors(float *values) {
+    values[0] = temperatureRead();
+    values[1] = hallRead();
+}
+#endif
+
+// Đọc 1 bản ghi cảm biến
+void readSample(Reading &r) {
+    r.timestamp = millis();
+#if EDGE_AGGREGATION
+    // Cửa sổ 1 mẫu: deep sleep không giữ cửa sổ qua các lần thức
+    float values[AGG_MAX_CHANNELS];
+    readSensors(values);
+    aggregator.add(values, r.timestamp);
+    r.len = aggregator.report((char *)r.data, sizeof(r.data), r.timestamp);
+#else
+    r.len = snprintf((char *)r.data, sizeof(r.data), "Data: %lu", (unsigned long)r.timestamp);
+#endif
+    stats.samplesProduced++;
+}
+
+// Tầng 1: lấy mẫu đúng chu kỳ, không bao giờ chờ tầng sau (queue đầy thì bỏ & đếm)
+void sampleTask(void *parameter) {
+    Reading r;
+    TickType_t lastWake = xTaskGetTickCount();
+
+#if EDGE_AGGREGATION
+    float values[AGG_MAX_CHANNELS];
+    for (;;) {
+        readSensors(values);
+        uint32_t now = millis();
+        aggregator.add(values, now);
+        stats.samplesProduced++;
 
-        // 2. Trong khi đang giữ nút
-        if (isHolding) {
-            unsigned long holdTime = millis() - pressStart;
-
-            // CHECK LONG PRESS (> 3000ms)
-            if (holdTime > 3000) {
-                Serial.println("\n[Button] LONG PRESS DETECTED -> HOTSPOT MODE");
-                currentState = STATE_CONFIG;
-                
-                // Reset trạng thái để không trigger lại liên tục
-                isHolding = false; 
-                // Chờ người dùng nhả nút ra hẳn mới xử lý tiếp
-                while(btn.isPressedRaw()) { btn.loop(); vTaskDelay(10); } 
+        // Giá trị đứng yên: không có gì đi xuống pipeline cho tới heartbeat
+        if (aggregator.due(now) != AGG_NONE) {
+            r.timestamp = now;
+            r.len = aggregator.report((char *)r.data, sizeof(r.data), now);
+            if (r.len == 0 || xQueueSend(sampleQueue, &r, 0) != pdTRUE) {
+                stats.sampleDrops++;
             }
-            
-            // CHECK RELEASE (SHORT PRESS)
-            // Nếu nút đã nhả ra VÀ thời gian giữ < 3000ms
-            else if (!btn.isPressedRaw()) {
-                // Kiểm tra chống nhiễu (phải giữ > 50ms mới tính là nhấn)
-                if (holdTime > 50) { 
-                    Serial.printf("\n[Button] SHORT PRESS (%lums) -> RE-GEN KEY\n", holdTime);
-                    triggerKeyExchange = true; // Bật cờ để NetworkTask xử lý
-                }
-                isHolding = false; // Reset
+        }
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SENSOR_SAMPLE_MS));
+    }
+#else
+    for (;;) {
+        readSample(r);
+
+        if (xQueueSend(sampleQueue, &r, 0) != pdTRUE) {
+            stats.sampleDrops++;
+        }
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SAMPLE_INTERVAL_MS));
+    }
+#endif
+}
+
+// Mã hóa plaintext vào cryptoOut và đẩy sang publishQueue (CryptoTask).
+// Plaintext được gắn header seq + giờ gửi; giờ gửi lấy lúc mã hóa nên độ trễ decoder đo
+// được gồm cả thời gian gói nằm chờ trong publishQueue / hàng đợi offline.
+bool encryptAndQueue(const uint8_t *plaintext, size_t len, uint8_t flags) {
+    if (len > BATCH_MAX_BYTES) return false;
+
+    uint64_t sentMs = unixTimeMs();
+    for (int i = 0; i < 4; i++) framed[i] = (packetSeq >> (8 * i)) & 0xFF;
+    for (int i = 0; i < 8; i++) framed[4 + i] = (sentMs >> (8 * i)) & 0xFF;
+    memcpy(framed + SEQ_HEADER_LEN, plaintext, len);
+    len += SEQ_HEADER_LEN;
+    flags |= PACKET_FLAG_SEQ;
+
+    uint32_t t0 = micros(); // Thời gian mã hóa tính cả bước nén
+    const uint8_t *payload = framed;
+#if PAYLOAD_COMPRESSION
+    size_t packedLen = compressor.compress(framed, len, packed, sizeof(packed));
+    if (packedLen) {
+        stats.compressBytesIn += len;
+        stats.compressBytesOut += packedLen;
+        payload = packed;
+        len = packedLen;
+        flags |= PACKET_FLAG_COMPRESSED;
+    } else {
+        stats.compressSkipped++;
+    }
+#endif
+    xSemaphoreTake(cryptoMutex, portMAX_DELAY);
+#if USE_BINARY_PACKET
+    cryptoOut.topic = TOPIC_BIN;
+    size_t pktLen = crypto.createBinaryPacket(payload, len, cryptoOut.data, sizeof(cryptoOut.data), NULL, flags);
+#else
+    cryptoOut.topic = TOPIC_DATA;
+    size_t pktLen = crypto.createEncryptedPacket(payload, len, (char *)cryptoOut.data, sizeof(cryptoOut.data), NULL, flags);
+#endif
+    xSemaphoreGive(cryptoMutex);
+    if (pktLen == 0) return false;
+
+    uint32_t elapsed = micros() - t0;
+    stats.encryptUsLast = elapsed;
+    if (elapsed > stats.encryptUsMax) stats.encryptUsMax = elapsed;
+    stats.encryptUsTotal += elapsed;
+
+    packetSeq++;
+    cryptoOut.len = pktLen;
+    stats.packetsEncrypted++;
+
+    // Backpressure: chờ NetTask có chỗ trong giới hạn, quá hạn thì bỏ gói & đếm
+    if (xQueueSend(publishQueue, &cryptoOut, pdMS_TO_TICKS(PUBLISH_QUEUE_WAIT_MS)) != pdTRUE) {
+        stats.packetDrops++;
+        return false;
+    }
+    return true;
+}
+
+// Mã hóa toàn bộ batch trong 1 gói (1 lần AES-GCM, 1 lần publish)
+void flushBatch() {
+    if (batch.isEmpty() || !crypto.isReadyToSend()) return;
+
+    if (encryptAndQueue(batch.data(), batch.size(), PACKET_FLAG_BATCH)) {
+        Serial.printf("[Crypto] Queued batch: %u records, %u bytes\n", batch.count(), (unsigned)batch.size());
+    }
+    batch.clear();
+}
+
+// Tầng 2: batch + mã hóa trên core 1, không phụ thuộc trạng thái mạng
+void cryptoTask(void *parameter) {
+    Reading r;
+
+    for (;;) {
+        // Chưa có session key: để bản ghi nằm lại trong sampleQueue
+        if (!crypto.isReadyToSend()) {
+            vTaskDelay(100 / portTICK_PERIOD_MS);
+            continue;
+        }
+
+        if (xQueueReceive(sampleQueue, &r, 100 / portTICK_PERIOD_MS) == pdTRUE) {
+#if BATCH_MAX_RECORDS > 1
+            // Gom vào batch, batch đầy thì gửi trước rồi thêm lại
+            if (!batch.add(r.timestamp, r.data, r.len)) {
+                flushBatch();
+                batch.add(r.timestamp, r.data, r.len);
             }
+#else
+            encryptAndQueue(r.data, r.len, 0);
+#endif
         }
 
-        vTaskDelay(10 / portTICK_PERIOD_MS);
+#if BATCH_MAX_RECORDS > 1
+        if (batch.isReady(millis())) flushBatch();
+#endif
     }
 }
 
 // ==========================================
-// 4. TASK QUẢN LÝ MẠNG (NETWORK TASK)
+// 5. TASK QUẢN LÝ MẠNG (NETWORK TASK)
 // ==========================================
+bool leftNormalMode() {
+    return currentState != STATE_NORMAL;
+}
+
+// Đổi cặp khóa ECDH trong NetTask; đo thời gian bị chặn & báo KeygenTask sinh cặp dự phòng mới
+void rotateKeys(bool keepSession) {
+    uint32_t t0 = micros();
+    xSemaphoreTake(cryptoMutex, portMAX_DELAY);
+    bool spare = crypto.generateNewKeys(keepSession);
+    xSemaphoreGive(cryptoMutex);
+    uint32_t elapsed = micros() - t0;
+
+    stats.rekeyUsLast = elapsed;
+    if (elapsed > stats.rekeyUsMax) stats.rekeyUsMax = elapsed;
+    Serial.printf("[Crypto] Rekey blocked NetTask %lu us (%s)\n", (unsigned long)elapsed,
+                  spare ? "precomputed" : "inline keygen");
+    if (taskKeygenHandle) xTaskNotifyGive(taskKeygenHandle);
+}
+
+// Sinh cặp khóa dự phòng. Ưu tiên thấp nhất nên chỉ chạy khi các task khác rảnh;
+// keygen chạy ngoài cryptoMutex, chỉ khóa lúc nạp cặp khóa vào crypto.
+void keygenTask(void *parameter) {
+    EcdhKeyPair pair;
+    for (;;) {
+        xSemaphoreTake(cryptoMutex, portMAX_DELAY);
+        bool needed = !crypto.hasSpareKeyPair();
+        xSemaphoreGive(cryptoMutex);
+
+        if (needed) {
+            uint32_t t0 = micros();
+            if (crypto.makeKeyPair(pair)) {
+                xSemaphoreTake(cryptoMutex, portMAX_DELAY);
+                crypto.setSpareKeyPair(pair);
+                xSemaphoreGive(cryptoMutex);
+                Serial.printf("[Crypto] Spare key pair ready (%lu us in background)\n", (unsigned long)(micros() - t0));
+            }
+            memset(&pair, 0, sizeof(pair));
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY); // rotateKeys() báo khi đã dùng cặp dự phòng
+    }
+}
+
 void networkTask(void *parameter) {
     // 1. Khởi tạo Crypto
     crypto.begin();
+#if SESSION_RESUME
+    crypto.setRatchetCallback(onKeyRatchet);
+#endif
     
     // 2. Load Config
     loadConfig();
+    offlineQueue.begin();
+    wifi.begin(sysConfig.wifiSsid, sysConfig.wifiPass);
 
     // 3. Khởi tạo MQTT Manager (nếu có config)
-    if (sysConfig.mqtt_server != "") {
-        mqtt = new MqttManager(sysConfig.mqtt_server.c_str(), sysConfig.mqtt_port, 
-                               sysConfig.mqtt_user.c_str(), sysConfig.mqtt_pass.c_str());
+    if (sysConfig.mqttServer[0] != '\0') {
+        mqtt = new MqttManager(sysConfig.mqttServer, sysConfig.mqttPort, 
+                               sysConfig.mqttUser, sysConfig.mqttPass);
         mqtt->begin();
+        mqtt->setCallback(onMqttMessage); // Response trao đổi khóa
     }
 
     bool keyExchanged = false;
-    uint32_t lastMsgTime = 0;
-    const uint32_t MSG_INTERVAL = 30000; // 30 giây
+    bool rekeyPending = false; // Đang dùng session đã lưu, cần trao đổi khóa mới ở nền
+    uint32_t lastRekeyAttempt = 0;
+    bool kxPending = false;    // Đã gửi request trao đổi khóa qua MQTT, chờ response ở bước D
+    bool kxBackoff = false;    // Trao đổi khóa lần đầu vừa thất bại: chờ 5s kể từ lastKxFailure
+    uint32_t lastKxFailure = 0;
+    bool sntpStarted = false;
+    uint32_t lastMetrics = 0;
+
+#if SESSION_RESUME
+    // Khôi phục session đã lưu: CryptoTask mã hóa được ngay, không chờ ECDH + HTTP
+    uint8_t savedKey[32];
+    uint8_t savedSid[SESSION_ID_LEN];
+    uint32_t savedEpoch = 0;
+    if (sessionStore.load(savedKey, savedSid, &savedEpoch)) {
+        xSemaphoreTake(cryptoMutex, portMAX_DELAY);
+        sessionResumed = crypto.restoreSession(savedKey, savedSid, savedEpoch);
+        xSemaphoreGive(cryptoMutex);
+        keyExchanged = sessionResumed;
+        rekeyPending = sessionResumed;
+    }
+    memset(savedKey, 0, sizeof(savedKey));
+#endif
 
     for (;;) {
         // ----------------------------------------
         // CASE 1: CHẾ ĐỘ NORMAL
         // ----------------------------------------
         if (currentState == STATE_NORMAL) {
-            
+            uint32_t loopStart = micros();
+
             // A. Kiểm tra WiFi
             if (WiFi.status() != WL_CONNECTED) {
-                if (sysConfig.wifi_ssid != "") {
-                    Serial.printf("[WiFi] Connecting to %s...\n", sysConfig.wifi_ssid.c_str());
-                    WiFi.begin(sysConfig.wifi_ssid.c_str(), sysConfig.wifi_pass.c_str());
-                    
-                    // Chờ kết nối (có timeout)
-                    int retry = 0;
-                    while (WiFi.status() != WL_CONNECTED && retry < 20) {
-                        vTaskDelay(500 / portTICK_PERIOD_MS);
-                        Serial.print(".");
-                        retry++;
-                        // Nếu trong lúc chờ mà bấm nút chuyển mode thì break ngay
-                        if (currentState != STATE_NORMAL) break; 
-                    }
-                    Serial.println(WiFi.status() == WL_CONNECTED ? " CONNECTED" : " FAILED");
+                if (sysConfig.wifiSsid[0] != '\0') {
+                    // Thử nhanh bằng AP/kênh/IP đã nhớ, thất bại thì quét đầy đủ (có timeout).
+                    // Nếu trong lúc chờ mà bấm nút chuyển mode thì thoát ngay
+                    wifi.connect(leftNormalMode);
                 } else {
                     Serial.println("[WiFi] No Config found! Please Long Press to Setup.");
                     vTaskDelay(2000 / portTICK_PERIOD_MS);
                 }
             }
 
+            // A'. Đồng bộ giờ SNTP (chạy nền trong lwIP, chỉ cần gọi 1 lần)
+            if (WiFi.status() == WL_CONNECTED && !sntpStarted && SNTP_SERVER[0]) {
+                configTime(0, 0, SNTP_SERVER);
+                sntpStarted = true;
+            }
+
             // B. Xử lý Short Press (Tạo lại Key)
             if (triggerKeyExchange) {
                 Serial.println("[System] Regenerating Keys...");
-                crypto.generateNewKeys(); // Tạo cặp khóa mới
+                cancelKeyExchangeMqtt();  // Response cho cặp khóa cũ không còn dùng được
+                kxPending = false;
+                rotateKeys(false);        // Tạo cặp khóa mới
                 keyExchanged = false;     // Reset trạng thái
+                rekeyPending = false;
+                kxBackoff = false;
                 triggerKeyExchange = false; // Xóa cờ
             }
 
-            // C. Trao đổi khóa (Nếu chưa có hoặc vừa bị reset)
-            if (WiFi.status() == WL_CONNECTED && !keyExchanged) {
-                if (performKeyExchange()) {
-                    keyExchanged = true;
-                    // Gửi ngay 1 gói tin sau khi exchange thành công
-                    lastMsgTime = millis() - MSG_INTERVAL; 
-                } else {
+            // C'. Rekey nền sau khi resume: giữ session cũ tới khi có key mới
+            KxResult kx = KX_FAILED;
+            if (WiFi.status() == WL_CONNECTED && keyTransportReady() && rekeyPending && firstPublishDone &&
+                !kxPending && millis() - lastRekeyAttempt > 10000) {
+                lastRekeyAttempt = millis();
+                Serial.println("[Session] Background rekey...");
+                rotateKeys(true);
+                kx = beginKeyExchange();
+            }
+
+            // C. Trao đổi khóa (Nếu chưa có hoặc vừa bị reset), chờ MQTT kết nối ở bước D
+            else if (WiFi.status() == WL_CONNECTED && !keyExchanged && keyTransportReady() && !kxPending &&
+                     (!kxBackoff || millis() - lastKxFailure >= 5000)) {
+                kx = beginKeyExchange();
+                kxBackoff = kx == KX_FAILED;
+                if (kxBackoff) {
                     Serial.println("[Crypto] Exchange failed. Retrying in 5s...");
-                    vTaskDelay(5000 / portTICK_PERIOD_MS);
+                    lastKxFailure = millis();
                 }
             }
+            if (kx == KX_PENDING) kxPending = true;
 
-            // D. MQTT Loop & Gửi tin định kỳ
-            if (WiFi.status() == WL_CONNECTED && keyExchanged && mqtt) {
+            // D. MQTT Loop & xả hàng đợi offline theo đợt giới hạn để không làm ngập broker
+            if (WiFi.status() == WL_CONNECTED && mqtt) {
                 mqtt->loop(); // Duy trì kết nối
+                if (mqtt->connected()) offlineQueue.drain(publishStored, millis());
+            }
 
-                if (millis() - lastMsgTime > MSG_INTERVAL) {
-                    lastMsgTime = millis();
-                    
-                    if (crypto.isReadyToSend()) {
-                        String msg = "Data: " + String(millis());
-                        // Mã hóa
-                        String encrypted = crypto.createEncryptedPacket(msg.c_str());
-                        // Gửi
-                        mqtt->publish("esp32/data", encrypted.c_str());
-                        Serial.println("[MQTT] Sent encrypted: " + msg);
+            // D''. Response trao đổi khóa qua MQTT: kiểm tra mỗi vòng, không chặn việc publish
+            if (kxPending) {
+                kx = pollKeyExchangeMqtt();
+                if (kx != KX_PENDING) {
+                    kxPending = false;
+                    if (kx == KX_FAILED && !keyExchanged) {
+                        Serial.println("[Crypto] Exchange failed. Retrying in 5s...");
+                        kxBackoff = true;
+                        lastKxFailure = millis();
                     }
                 }
             }
+            if (kx == KX_DONE) {
+                keyExchanged = true;
+                rekeyPending = false;
+            }
 
-            vTaskDelay(100 / portTICK_PERIOD_MS);
+            // D'. Metrics thiết bị
+            if (METRICS_INTERVAL_MS > 0 && mqtt && mqtt->connected() &&
+                millis() - lastMetrics >= METRICS_INTERVAL_MS) {
+                lastMetrics = millis();
+                publishMetrics();
+            }
+
+            // Jitter: vòng lặp bận bao lâu trước khi quay lại chờ gói
+            uint32_t busy = micros() - loopStart;
+            if (busy > stats.netLoopUsMax) stats.netLoopUsMax = busy;
+
+            // E. Publish gói từ CryptoTask, chờ tối đa 100ms (thay cho delay của vòng lặp)
+            publishFromQueue(100 / portTICK_PERIOD_MS);
         }
 
         // ----------------------------------------
@@ -271,8 +901,7 @@ void networkTask(void *parameter) {
                     Serial.println("[System] New Config Received!");
                     
                     // Lấy dữ liệu và lưu vào Flash
-                    ConfigData newData = hotspot.getConfigData();
-                    saveConfig(newData);
+                    saveConfig(hotspot.getConfigData());
 					
                     Serial.println("[System] Restarting...");
                     delay(1000);
@@ -287,16 +916,152 @@ void networkTask(void *parameter) {
 }
 
 // ==========================================
-// 5. SETUP & LOOP
+// 6. CHẾ ĐỘ DEEP SLEEP (DEEP_SLEEP_MODE)
+// ==========================================
+#if DEEP_SLEEP_MODE
+#define SLEEP_STATE_MAGIC 0x534C5031
+
+// RTC slow memory: còn nguyên qua deep sleep, mất khi mất nguồn hoặc reset cứng
+struct SleepState {
+    uint32_t magic; // Chỉ hợp lệ khi vừa được ghi ngay trước lần ngủ gần nhất
+    CryptoSessionState session;
+    uint32_t packetSeq;
+    uint32_t wakeCount;
+    uint32_t lastAwakeMs;
+};
+RTC_DATA_ATTR SleepState sleepState;
+
+// Chụp trạng thái vào RTC memory rồi ngủ tới chu kỳ kế tiếp (không bao giờ return)
+void enterDeepSleep(uint32_t phaseWifi, uint32_t phaseKey, uint32_t phaseMqtt) {
+    if (crypto.exportSession(&sleepState.session)) sleepState.magic = SLEEP_STATE_MAGIC;
+    sleepState.packetSeq = packetSeq;
+    sleepState.wakeCount = wakeCount;
+
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+
+    // Giữ nhịp DEEP_SLEEP_INTERVAL_MS tính từ lúc thức, không cộng dồn thời gian thức
+    uint32_t awake = millis();
+    uint32_t sleepMs = awake + 1000 < DEEP_SLEEP_INTERVAL_MS ? DEEP_SLEEP_INTERVAL_MS - awake : 1000;
+    sleepState.lastAwakeMs = awake;
+    Serial.printf("[Sleep] Awake %lu ms (wifi %lu, key %lu, mqtt %lu) -> sleep %lu ms\n",
+                  (unsigned long)awake, (unsigned long)phaseWifi, (unsigned long)phaseKey,
+                  (unsigned long)phaseMqtt, (unsigned long)sleepMs);
+    Serial.flush();
+
+    esp_sleep_enable_timer_wakeup((uint64_t)sleepMs * 1000ULL);
+    esp_sleep_enable_ext0_wakeup((gpio_num_t)BUTTON_PIN, 0); // Nút active-low
+    esp_deep_sleep_start();
+}
+
+// 1 chu kỳ thức. Trả về false nếu cần chạy chế độ thường (chưa có cấu hình / đang giữ nút).
+bool dutyCycle() {
+    bool resumed = esp_reset_reason() == ESP_RST_DEEPSLEEP && sleepState.magic == SLEEP_STATE_MAGIC;
+    // Đánh dấu đã dùng: crash giữa chu kỳ thì lần boot sau không nạp lại counter cũ (lặp nonce)
+    sleepState.magic = 0;
+
+    pinMode(BUTTON_PIN, INPUT_PULLUP);
+    loadConfig();
+    if (sysConfig.wifiSsid[0] == '\0' || digitalRead(BUTTON_PIN) == LOW) return false;
+
+    wakeCount = resumed ? sleepState.wakeCount + 1 : 0;
+    lastAwakeMs = resumed ? sleepState.lastAwakeMs : 0;
+
+    // Có session trong RTC thì bỏ qua cả sinh khóa ECDH
+    crypto.begin(false);
+#if SESSION_RESUME
+    crypto.setRatchetCallback(onKeyRatchet);
+#endif
+    if (resumed && crypto.importSession(&sleepState.session)) {
+        packetSeq = sleepState.packetSeq;
+        sessionResumed = true;
+    } else {
+        crypto.generateNewKeys();
+    }
+
+    // Lấy mẫu trước khi bật radio
+    Reading r;
+    readSample(r);
+
+    offlineQueue.begin();
+    wifi.begin(sysConfig.wifiSsid, sysConfig.wifiPass);
+    uint32_t t0 = millis();
+    bool online = wifi.connect(); // Tối đa WIFI_FAST_TIMEOUT_MS + WIFI_SCAN_TIMEOUT_MS
+    uint32_t phaseWifi = millis() - t0;
+
+    // MQTT trước: trao đổi khóa đi chung kết nối này
+    t0 = millis();
+    if (online && sysConfig.mqttServer[0] != '\0') {
+        if (unixTimeMs() == 0 && SNTP_SERVER[0]) configTime(0, 0, SNTP_SERVER);
+        mqtt = new MqttManager(sysConfig.mqttServer, sysConfig.mqttPort,
+                               sysConfig.mqttUser, sysConfig.mqttPass);
+        mqtt->begin();
+        mqtt->setCallback(onMqttMessage);
+        mqtt->connect();
+        mqtt->waitConnected(MQTT_CONNECT_TIMEOUT_MS);
+    }
+    uint32_t phaseMqtt = millis() - t0;
+
+    t0 = millis();
+    if (online && !crypto.isReadyToSend() && keyTransportReady()) performKeyExchange();
+    uint32_t phaseKey = millis() - t0;
+
+    // Offline vẫn mã hóa để gói nằm trong hàng đợi flash, gửi ở chu kỳ sau
+    if (crypto.isReadyToSend()) encryptAndQueue(r.data, r.len, 0);
+
+    t0 = millis();
+    publishFromQueue(0);
+    if (mqtt && mqtt->connected()) {
+        // Xả 1 đợt hàng đợi flash mỗi chu kỳ để thời gian thức không kéo dài
+        offlineQueue.drain(publishStored, millis());
+        uint32_t metricsEvery = METRICS_INTERVAL_MS / DEEP_SLEEP_INTERVAL_MS;
+        if (METRICS_INTERVAL_MS > 0 && wakeCount % (metricsEvery ? metricsEvery : 1) == 0) publishMetrics();
+        // Chờ PUBACK trước khi ngủ; disconnect() trả gói chưa ack về hàng đợi flash (onPublishDone)
+        if (!mqtt->flush(MQTT_CONNECT_TIMEOUT_MS)) Serial.println("[Sleep] Some packets were not acknowledged");
+        mqtt->disconnect();
+    }
+    // Lưu tail cho các gói offline đã được ack trong chu kỳ này
+    offlineQueue.commit();
+    phaseMqtt += millis() - t0;
+
+    enterDeepSleep(phaseWifi, phaseKey, phaseMqtt);
+    return true;
+}
+#endif
+
+// ==========================================
+// 7. SETUP & LOOP
 // ==========================================
 void setup() {
     Serial.begin(115200);
 
+    // Queue & mutex của pipeline phải có trước khi tạo task
+    sampleQueue = xQueueCreate(SAMPLE_QUEUE_DEPTH, sizeof(Reading));
+    publishQueue = xQueueCreate(PUBLISH_QUEUE_DEPTH, sizeof(OutPacket));
+    cryptoMutex = xSemaphoreCreateMutex();
+#if EDGE_AGGREGATION
+    setupAggregator();
+#endif
+
+#if DEEP_SLEEP_MODE
+    if (dutyCycle()) return;
+    Serial.println("[Sleep] No config or button held -> normal mode");
+#endif
+
     // Tạo Task Input (Priority thấp)
     xTaskCreatePinnedToCore(inputTask, "InputTask", 4096, NULL, 1, &taskInputHandle, 1);
     
     // Tạo Task Network (Priority cao hơn, Stack lớn cho SSL/JSON)
     xTaskCreatePinnedToCore(networkTask, "NetTask", 8192, NULL, 2, &taskNetHandle, 0);
+
+    // Pipeline: lấy mẫu (ưu tiên cao nhất) & mã hóa chạy trên core 1, tách khỏi mạng
+    xTaskCreatePinnedToCore(sampleTask, "SampleTask", 3072, NULL, 3, &taskSampleHandle, 1);
+    xTaskCreatePinnedToCore(cryptoTask, "CryptoTask", 4096, NULL, 2, &taskCryptoHandle, 1);
+
+#if SPARE_KEY_PRECOMPUTE
+    // Cặp khóa dự phòng: ưu tiên ngang IDLE, core 1 để không tranh CPU với WiFi
+    xTaskCreatePinnedToCore(keygenTask, "KeygenTask", 4096, NULL, tskIDLE_PRIORITY, &taskKeygenHandle, 1);
+#endif
 }
 
 void loop() {
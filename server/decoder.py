@@ -1,64 +1,114 @@
 import paho.mqtt.client as mqtt
-import json
+import atexit
 import base64
+import json
 import os
+import signal
 import time
 import sys
-from cryptography.hazmat.primitives.ciphers import Cipher, algorithms, modes
-from cryptography.hazmat.backends import default_backend
+
+import protocol
+import registry
+import streamstats
+import tsdb
 
 # Cấu hình
 MQTT_BROKER = os.getenv("MQTT_BROKER", "mosquitto")
 MQTT_USER = os.getenv("MQTT_USER", "admin")
 MQTT_PASS = os.getenv("MQTT_PASS", "123456")
-MQTT_TOPIC = "esp32/data"
-SHARED_KEY_PATH = "/shared/aes_key.bin"
+MQTT_TOPICS = [(protocol.TOPIC_DATA, 0), (protocol.TOPIC_BIN, 0), (protocol.TOPIC_METRICS + "/+", 0)]
+
+# Gửi ack từng gói lên esp32/decoded/<device> (dùng khi tải thử bằng fleet simulator)
+DECODER_ACKS = os.getenv("DECODER_ACKS", "0") == "1"
+# Tắt in từng bản ghi khi tải cao (in ra terminal chậm hơn giải mã nhiều)
+DECODER_LOG = os.getenv("DECODER_LOG", "1") == "1"
+# Lưu bản ghi đã giải mã vào tsdb (TSDB_PATH, xem tsdb.py), 0 = chỉ in ra terminal
+DECODER_STORE = os.getenv("DECODER_STORE", "1") == "1"
+# Chu kỳ in thống kê mất gói / đảo gói / độ trễ theo thiết bị (giây), 0 = tắt
+STATS_INTERVAL = float(os.getenv("STATS_INTERVAL", "60"))
+
+tracker = streamstats.Tracker()
+last_report = time.time()
+
+def print_report():
+    print("\n=============== THỐNG KÊ THEO THIẾT BỊ ===============")
+    for device, summary, metrics in tracker.report():
+        latency = summary.get("latencyMs")
+        line = (f"{device}: nhận {summary['received']}, mất {summary['lost']} ({summary['lossPct']}%), "
+                f"đảo {summary['reordered']}, trùng {summary['duplicates']}, reboot {summary['restarts']}")
+        if latency:
+            line += f", trễ avg {latency['avg']}ms p50<={latency['p50']} p99<={latency['p99']}"
+        print(line)
+        if latency:
+            print(f"    histogram (ms): {latency['histogram']}")
+        if metrics:
+            print(f"    metrics: heap {metrics.get('heap')}, queues {metrics.get('queues')}, "
+                  f"encryptUs {metrics.get('encryptUs')}, publish {metrics.get('publish')}, "
+                  f"reconnects {metrics.get('reconnects')}, stack {metrics.get('stack')}")
+    if DECODER_STORE:
+        print(f"tsdb: ghi {tsdb.stats['written']}, bỏ {tsdb.stats['dropped']}, "
+              f"{tsdb.stats['flushes']} lô, lô chậm nhất {tsdb.stats['flushMsMax']}ms")
+    print("======================================================")
 
-aes_key = None
+def maybe_report():
+    global last_report
+    if STATS_INTERVAL > 0 and time.time() - last_report >= STATS_INTERVAL:
+        last_report = time.time()
+        print_report()
 
-def load_key():
-    global aes_key
+def on_metrics(msg):
+    device = msg.topic[len(protocol.TOPIC_METRICS) + 1:]
     try:
-        if os.path.exists(SHARED_KEY_PATH):
-            with open(SHARED_KEY_PATH, "rb") as f:
-                aes_key = f.read()
-            print("[Decoder] Đã tải AES Key từ file thành công!")
-            return True
-        else:
-            return False
-    except Exception as e:
-        print(f"[Decoder] Lỗi đọc key: {e}")
-        return False
+        tracker.metrics(device, json.loads(msg.payload))
+    except ValueError as e:
+        print(f"[Decoder] Metrics lỗi từ {device}: {e}")
+
+def send_ack(client, packet, ok):
+    if not DECODER_ACKS:
+        return
+    ack = {"iv": base64.b64encode(packet.iv).decode(), "ok": ok}
+    client.publish(f"{protocol.TOPIC_ACK}/{packet.device}", json.dumps(ack))
 
 def on_message(client, userdata, msg):
-    # Luôn thử tải lại key nếu chưa có (phòng trường hợp server mới tạo xong)
-    if aes_key is None:
-        if not load_key():
-            print("[Decoder] Nhận tin nhắn nhưng chưa có Key. Vui lòng chạy Key Exchange trước.")
-            return
+    maybe_report()
+    if msg.topic.startswith(protocol.TOPIC_METRICS + "/"):
+        on_metrics(msg)
+        return
 
+    packet = None
     try:
-        payload = msg.payload.decode('utf-8')
-        data = json.loads(payload)
-        
-        iv = base64.b64decode(data['iv'])
-        tag = base64.b64decode(data['tag'])
-        ciphertext = base64.b64decode(data['ciphertext'])
-
-        decryptor = Cipher(
-            algorithms.AES(aes_key),
-            modes.GCM(iv, tag),
-            backend=default_backend()
-        ).decryptor()
-
-        plaintext = decryptor.update(ciphertext) + decryptor.finalize()
-        
+        # Tự chọn định dạng JSON hay nhị phân theo topic
+        packet = protocol.parse(msg.topic, msg.payload)
+        # Key theo device id / session id của gói, tra trong registry
+        plaintext = registry.decrypt(packet)
+        send_ack(client, packet, True)
+
+        seq = protocol.sequence(packet, plaintext)
+        if seq is not None:
+            tracker.observe(packet.device, *seq)
+        records = protocol.records(packet, plaintext)
+        if DECODER_STORE:
+            # Chỉ vào buffer RAM, thread của tsdb ghi theo lô
+            sent_ms = seq[1] if seq else None
+            tsdb.append_packet(packet.device, records, sent_ms, seq[0] if seq else None)
+        if not DECODER_LOG:
+            return
+
         # === IN RA TERMINAL ===
-        print(f"\n[TERMINAL]  GIẢI MÃ: {plaintext.decode('utf-8')}")
+        # Batch được tách lại thành từng bản ghi với timestamp gốc
+        for ts, record in records:
+            prefix = f"[t={ts}ms] " if ts is not None else ""
+            print(f"\n[TERMINAL]  GIẢI MÃ ({packet.device}): {prefix}{record.decode('utf-8')}")
         print("------------------------------------------------")
 
+    except KeyError as e:
+        print(f"[Decoder] {e.args[0]}. Vui lòng chạy Key Exchange trước.")
+        if packet is not None:
+            send_ack(client, packet, False)
     except Exception as e:
         print(f"[Decoder] Giải mã thất bại: {e}")
+        if packet is not None:
+            send_ack(client, packet, False)
 
 def start():
     client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2)
@@ -69,7 +119,7 @@ def start():
         try:
             print(f"[Decoder] Kết nối tới {MQTT_BROKER}...")
             client.connect(MQTT_BROKER, 1883, 60)
-            client.subscribe(MQTT_TOPIC)
+            client.subscribe(MQTT_TOPICS)
             client.loop_forever()
         except Exception:
             print("[Decoder] Mất kết nối. Thử lại sau 5s...")
@@ -77,5 +127,11 @@ def start():
 
 if __name__ == "__main__":
     print("=== DECODER PROCESS STARTED ===")
-    print("Đang đợi AES Key từ Server...")
+    print(f"Registry: {registry.REGISTRY_DB}")
+    if DECODER_STORE:
+        print(f"Telemetry: {tsdb.TSDB_PATH} (flush mỗi {tsdb.TSDB_FLUSH_INTERVAL}s)")
+        tsdb.start()
+        atexit.register(tsdb.close)
+        # docker stop gửi SIGTERM: thoát bình thường để atexit ghi nốt buffer
+        signal.signal(signal.SIGTERM, lambda *_: sys.exit(0))
     start()
\ No newline at end of file
@@ -10,23 +10,23 @@ import time
 # Crypto imports
 from cryptography.hazmat.primitives import serialization, hashes
 from cryptography.hazmat.primitives.asymmetric import ec
-from cryptography.hazmat.primitives.ciphers import Cipher, algorithms, modes
-from cryptography.hazmat.backends import default_backend
 from cryptography.exceptions import InvalidTag
 
+import protocol
+import registry
+import tsdb
+
 app = FastAPI(title="ESP32 ECDH Key Exchange Server")
 
 # ==================== CẤU HÌNH (Đã sửa cho Docker) ====================
 MQTT_BROKER = os.getenv("MQTT_BROKER", "mosquitto") 
 MQTT_PORT = 1883
-MQTT_TOPIC = "esp32/data"
+MQTT_TOPICS = [(protocol.TOPIC_DATA, 0), (protocol.TOPIC_BIN, 0), (protocol.TOPIC_KX_REQ + "/+", 1)]
 
 MQTT_USER = os.getenv("MQTT_USER", "admin")
 MQTT_PASS = os.getenv("MQTT_PASS", "123456")
 
-# ĐƯỜNG DẪN FILE KEY (Quan trọng để share với Decoder)
-# Mặc định là /shared/aes_key.bin nếu chạy trong Docker
-KEY_PATH = os.getenv("KEY_PATH", "/shared/aes_key.bin")
+# Key theo từng thiết bị nằm trong registry (REGISTRY_DB, xem registry.py)
 
 # ==================== LOGIC CRYPTO & SERVER ====================
 laptop_private_key = ec.generate_private_key(ec.SECP256R1())
@@ -37,54 +37,69 @@ pub_bytes = laptop_public_key.public_bytes(
 )
 laptop_pub_64 = pub_bytes[1:]
 laptop_pub_hex = laptop_pub_64.hex().upper()
+laptop_pub_compressed = laptop_public_key.public_bytes(
+    encoding=serialization.Encoding.X962,
+    format=serialization.PublicFormat.CompressedPoint
+)
 
-derived_aes_key = None
 mqtt_client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2)
 
+def exchange(device_id, esp32_pub_bytes):
+    """ECDH với public key (X9.62) của thiết bị, cấp session mới, trả về session id."""
+    esp32_public_key = ec.EllipticCurvePublicKey.from_encoded_point(
+        ec.SECP256R1(), esp32_pub_bytes
+    )
+    shared_secret = laptop_private_key.exchange(ec.ECDH(), esp32_public_key)
+
+    # KDF SHA-256
+    digest = hashes.Hash(hashes.SHA256())
+    digest.update(shared_secret)
+    derived_aes_key = digest.finalize() # Key dạng bytes (32 bytes)
+
+    # Cấp session mới cho đúng thiết bị này; thiết bị gắn session id vào mỗi gói
+    return registry.enroll(device_id, derived_aes_key)
+
 @app.post("/exchange")
 async def exchange_key(request: Request):
-    global derived_aes_key
     try:
         data = await request.json()
         esp32_pub_hex = data.get("publicKey")
         if not esp32_pub_hex:
             return JSONResponse({"error": "Missing publicKey"}, status_code=400)
+        # Firmware cũ không gửi device id riêng
+        device_id = data.get("device") or "esp32"
 
-        print(f"\n[HTTP] Nhận Key từ ESP32: {esp32_pub_hex[:10]}...")
-        
-        # Tính toán Shared Secret
-        esp32_pub_bytes = bytes.fromhex("04" + esp32_pub_hex)
-        esp32_public_key = ec.EllipticCurvePublicKey.from_encoded_point(
-            ec.SECP256R1(), esp32_pub_bytes
-        )
-        shared_secret = laptop_private_key.exchange(ec.ECDH(), esp32_public_key)
-        
-        # KDF SHA-256
-        digest = hashes.Hash(hashes.SHA256())
-        digest.update(shared_secret)
-        derived_aes_key = digest.finalize() # Key dạng bytes (32 bytes)
-
-        # ==================== [MỚI] LƯU KEY RA FILE ====================
-        try:
-            # Đảm bảo thư mục tồn tại (phòng hờ)
-            os.makedirs(os.path.dirname(KEY_PATH), exist_ok=True)
-            
-            # Ghi file dạng binary ('wb')
-            with open(KEY_PATH, "wb") as f:
-                f.write(derived_aes_key)
-            
-            print(f"[SYSTEM] >>> Đã lưu AES Key vào: {KEY_PATH}")
-            print(f"[SYSTEM] >>> Hex Key (để debug): {derived_aes_key.hex()}")
-        except Exception as file_err:
-            print(f"[ERROR] Không thể ghi file key: {file_err}")
-        # ===============================================================
-        
-        print("[HTTP] Key Exchange Success! Ready to decrypt.")
-        return JSONResponse({"publicKey": laptop_pub_hex})
+        print(f"\n[HTTP] Nhận Key từ {device_id}: {esp32_pub_hex[:10]}...")
+        session_id = exchange(device_id, bytes.fromhex("04" + esp32_pub_hex))
+
+        print(f"[HTTP] Key Exchange Success! {device_id} -> session {session_id}. Ready to decrypt.")
+        return JSONResponse({"publicKey": laptop_pub_hex, "sessionId": session_id})
     except Exception as e:
         print(f"Error: {e}")
         return JSONResponse({"error": str(e)}, status_code=500)
 
+@app.get("/devices")
+async def list_devices():
+    return [
+        {"device": device_id, "sessions": count, "lastEnrolled": last}
+        for device_id, count, last in registry.devices()
+    ]
+
+# Bản ghi decoder đã lưu (tsdb.py, TSDB_PATH dùng chung với decoder); start/end là Unix ms
+@app.get("/telemetry")
+async def telemetry_devices():
+    return [
+        {"device": device_id, "records": count, "firstMs": first, "lastMs": last}
+        for device_id, count, first, last in tsdb.devices()
+    ]
+
+@app.get("/telemetry/{device_id}")
+async def telemetry(device_id: str, start: int = None, end: int = None, limit: int = 1000):
+    return [
+        {"ts": ts, "seq": seq, "deviceMs": device_ms, "data": data.decode("utf-8", "replace")}
+        for ts, seq, device_ms, data in tsdb.query(device_id, start, end, limit)
+    ]
+
 # ==================== MQTT LOGIC (Backend chỉ nên subscribe để debug) ====================
 # Lưu ý: Nếu bạn đã có service 'decoder' riêng, bạn có thể xóa phần MQTT ở đây 
 # để tránh 2 bên cùng in log gây rối. Nhưng giữ lại để test cũng không sao.
@@ -92,39 +107,40 @@ async def exchange_key(request: Request):
 def on_connect(client, userdata, flags, rc, properties=None):
     if rc == 0:
         print(f"[MQTT] Connected to Broker at {MQTT_BROKER}")
-        client.subscribe(MQTT_TOPIC)
+        client.subscribe(MQTT_TOPICS)
     else:
         print(f"[MQTT] Connect failed with code {rc}")
 
-def on_message(client, userdata, msg):
-    # Nếu chưa có key trong RAM thì thử đọc lại từ file (phòng trường hợp restart)
-    global derived_aes_key
-    if derived_aes_key is None:
-        if os.path.exists(KEY_PATH):
-            with open(KEY_PATH, "rb") as f:
-                derived_aes_key = f.read()
-                print(f"[MQTT] Đã load lại key từ file: {KEY_PATH}")
-        else:
-            print("[MQTT] Ignored message (No key established)")
-            return
+def on_kx_request(client, msg):
+    """Trao đổi khóa qua MQTT: trả lời trên topic response của đúng thiết bị."""
+    device_id = msg.topic[len(protocol.TOPIC_KX_REQ) + 1:]
+    req_id = 0
+    try:
+        req_id, esp32_pub_bytes, compressed = protocol.parse_kx_request(msg.payload)
+        session_id = exchange(device_id, esp32_pub_bytes)
+        server_key = laptop_pub_compressed if compressed else pub_bytes
+        response = protocol.kx_response(req_id, protocol.KX_STATUS_OK, session_id, server_key)
+        print(f"[MQTT] Key Exchange Success! {device_id} -> session {session_id} ({len(msg.payload)}B request)")
+    except Exception as e:
+        print(f"[MQTT] Key Exchange Failed for {device_id}: {e}")
+        response = protocol.kx_response(req_id, protocol.KX_STATUS_ERROR)
+    client.publish(f"{protocol.TOPIC_KX_RES}/{device_id}", response, qos=1)
 
+def on_message(client, userdata, msg):
+    if msg.topic.startswith(protocol.TOPIC_KX_REQ + "/"):
+        on_kx_request(client, msg)
+        return
     try:
-        payload = msg.payload.decode('utf-8')
-        data = json.loads(payload)
-        
-        iv = base64.b64decode(data['iv'])
-        tag = base64.b64decode(data['tag'])
-        ciphertext = base64.b64decode(data['ciphertext'])
-
-        decryptor = Cipher(
-            algorithms.AES(derived_aes_key),
-            modes.GCM(iv, tag),
-            backend=default_backend()
-        ).decryptor()
-
-        plaintext = decryptor.update(ciphertext) + decryptor.finalize()
-        print(f"\n>>> [Backend] DECRYPTED: {plaintext.decode('utf-8')}")
+        packet = protocol.parse(msg.topic, msg.payload)
+
+        # Key theo device id / session id của gói (xem registry.py)
+        plaintext = registry.decrypt(packet)
+        for ts, record in protocol.records(packet, plaintext):
+            prefix = f"[t={ts}ms] " if ts is not None else ""
+            print(f"\n>>> [Backend] DECRYPTED {packet.device}: {prefix}{record.decode('utf-8')}")
 
+    except KeyError as e:
+        print(f"[MQTT] Ignored message ({e.args[0]})")
     except Exception as e:
         print(f"[MQTT] Decryption Failed: {e}")
 
@@ -144,6 +160,11 @@ def start_mqtt():
             print(f"[MQTT] Waiting for Broker at {MQTT_BROKER}...")
             time.sleep(2)
 
+# Backend phải online trên broker để trả lời trao đổi khóa qua MQTT
+@app.on_event("startup")
+def on_startup():
+    start_mqtt()
+
 if __name__ == "__main__":
 
     uvicorn.run(app, host="0.0.0.0", port=8000)
\ No newline at end of file
@@ -0,0 +1,349 @@
+"""Giải mã gói tin từ ESP32 (dùng chung cho backend và decoder).
+
+Hai định dạng được hỗ trợ:
+  * JSON/Base64 trên topic esp32/data:
+        {"from": ..., "sid": hex, "ciphertext": b64, "iv": b64, "tag": b64, "f": flags}
+    AAD là header nhị phân dựng lại từ "f", "from", "sid" (xem header_aad()).
+  * Nhị phân trên topic esp32/bin (xem CryptoESP.h):
+        [version 1B][flags 1B][idLen 1B][deviceId][sessionId 8B][IV 12B][ciphertext][tag 16B]
+    sessionId chỉ có khi bật FLAG_SESSION.
+    Header (version..sessionId) là AAD của AES-GCM.
+
+Nếu cờ FLAG_BATCH được bật, plaintext gồm nhiều bản ghi nối tiếp
+(xem BatchBuffer.h): [timestamp 4B LE][len 2B LE][data]
+
+Nếu cờ FLAG_RATCHET được bật, IV = [epoch 4B BE][counter 8B BE] và gói được
+mã hóa bằng key của epoch đó: key(n+1) = HKDF-SHA256(key(n), info="CO3069 ratchet" || n+1).
+Server chỉ cần lưu key gốc (epoch 0) của session.
+
+Nếu cờ FLAG_SEQ được bật, plaintext bắt đầu bằng [seq 4B LE][giờ gửi Unix ms 8B LE]
+(0 = thiết bị chưa đồng bộ giờ), phần còn lại mới là dữ liệu / batch.
+
+Nếu cờ FLAG_COMPRESSED được bật (xem PayloadCompressor.h), plaintext sau khi giải mã
+là [độ dài gốc 2B LE][khối LZ4] và được giải nén ngay trong decrypt(): mọi bước sau
+(seq, batch) thấy plaintext gốc như gói không nén.
+
+Trao đổi khóa qua MQTT (xem KeyExchange.h):
+    esp32/kx/req/<device>: [version 1B][flags 1B][reqId 2B BE][public key]
+    esp32/kx/res/<device>: [version 1B][status 1B][reqId 2B BE][sessionId 8B][public key server]
+Public key 33 byte nén nếu bật KX_FLAG_COMPRESSED, ngược lại 64 byte X||Y; server trả
+cùng định dạng. status khác KX_STATUS_OK thì response chỉ có 4 byte đầu.
+"""
+import base64
+import hashlib
+import hmac
+import json
+import struct
+import threading
+from collections import OrderedDict
+
+from cryptography.hazmat.primitives.ciphers.aead import AESGCM
+
+TOPIC_DATA = "esp32/data"
+TOPIC_BIN = "esp32/bin"
+# Metrics thiết bị (JSON không mã hóa): <TOPIC_METRICS>/<device>
+TOPIC_METRICS = "esp32/metrics"
+# Ack của decoder cho từng gói: <TOPIC_ACK>/<device>, {"iv": b64, "ok": bool}
+TOPIC_ACK = "esp32/decoded"
+# Trao đổi khóa: <TOPIC_KX_REQ>/<device> -> <TOPIC_KX_RES>/<device>
+TOPIC_KX_REQ = "esp32/kx/req"
+TOPIC_KX_RES = "esp32/kx/res"
+
+BIN_PACKET_VERSION = 1
+BIN_IV_LEN = 12
+BIN_TAG_LEN = 16
+
+FLAG_BATCH = 0x01
+FLAG_SESSION = 0x02
+FLAG_RATCHET = 0x04
+FLAG_SEQ = 0x08
+FLAG_COMPRESSED = 0x10
+SESSION_ID_LEN = 8
+
+KX_VERSION = 1
+KX_FLAG_COMPRESSED = 0x01
+KX_STATUS_OK = 0
+KX_STATUS_ERROR = 1
+
+RATCHET_INFO = b"CO3069 ratchet"
+# Không tính quá xa về phía trước cho một gói (chống gói giả ép server tốn CPU)
+RATCHET_MAX_JUMP = 4096
+
+_RECORD_HEADER = struct.Struct("<IH")
+_SEQ_HEADER = struct.Struct("<IQ")
+_KX_HEADER = struct.Struct(">BBH")
+_LZ4_MIN_MATCH = 4
+
+
+class Packet:
+    """Gói tin đã tách field, chưa giải mã."""
+
+    __slots__ = ("device", "session", "flags", "iv", "ciphertext", "tag", "aad")
+
+    def __init__(self, device, flags, iv, ciphertext, tag, aad=None, session=None):
+        self.device = device
+        self.session = session  # Session id dạng hex, None nếu thiết bị không gửi
+        self.flags = flags
+        self.iv = iv
+        self.ciphertext = ciphertext
+        self.tag = tag
+        self.aad = aad
+
+
+def header_aad(device, flags, session=None):
+    """Header chuẩn [version][flags][idLen][deviceId][sessionId] = AAD của cả 2 định dạng."""
+    device_id = device.encode("utf-8")
+    if len(device_id) > 255:
+        raise ValueError("Device id quá dài")
+    aad = bytes((BIN_PACKET_VERSION, flags, len(device_id))) + device_id
+    if flags & FLAG_SESSION:
+        if session is None:
+            raise ValueError("Thiếu session id")
+        aad += bytes.fromhex(session)
+    return aad
+
+
+def parse_json(payload):
+    data = json.loads(payload)
+    device = data.get("from", "")
+    session = data.get("sid")
+    flags = data.get("f", 0)
+    if not isinstance(flags, int) or not 0 <= flags <= 255:
+        raise ValueError("Cờ không hợp lệ")
+    if session is not None and not flags & FLAG_SESSION:
+        raise ValueError("Có sid nhưng thiếu FLAG_SESSION")
+    return Packet(
+        device=device,
+        session=session,
+        flags=flags,
+        iv=base64.b64decode(data["iv"]),
+        ciphertext=base64.b64decode(data["ciphertext"]),
+        tag=base64.b64decode(data["tag"]),
+        aad=header_aad(device, flags, session),
+    )
+
+
+def parse_binary(payload):
+    payload = bytes(payload)
+    if len(payload) < 3 + BIN_IV_LEN + BIN_TAG_LEN:
+        raise ValueError("Gói nhị phân quá ngắn")
+    if payload[0] != BIN_PACKET_VERSION:
+        raise ValueError(f"Không hỗ trợ version {payload[0]}")
+
+    flags = payload[1]
+    id_len = payload[2]
+    header_len = 3 + id_len
+    session = None
+    if flags & FLAG_SESSION:
+        session = payload[header_len:header_len + SESSION_ID_LEN].hex()
+        header_len += SESSION_ID_LEN
+    body = payload[header_len:]
+    if len(body) < BIN_IV_LEN + BIN_TAG_LEN:
+        raise ValueError("Gói nhị phân quá ngắn")
+
+    return Packet(
+        device=payload[3:3 + id_len].decode("utf-8"),
+        session=session,
+        flags=flags,
+        iv=body[:BIN_IV_LEN],
+        ciphertext=body[BIN_IV_LEN:-BIN_TAG_LEN],
+        tag=body[-BIN_TAG_LEN:],
+        aad=payload[:header_len],
+    )
+
+
+def parse(topic, payload):
+    """Chọn parser theo topic MQTT."""
+    if topic == TOPIC_BIN:
+        return parse_binary(payload)
+    return parse_json(payload)
+
+
+def _hkdf_sha256(ikm, info, length=32):
+    prk = hmac.new(b"\x00" * 32, ikm, hashlib.sha256).digest()
+    return hmac.new(prk, info + b"\x01", hashlib.sha256).digest()[:length]
+
+
+def ratchet_key(key, epoch):
+    """Key của epoch kế tiếp (epoch là số của epoch mới)."""
+    return _hkdf_sha256(key, RATCHET_INFO + struct.pack(">I", epoch))
+
+
+# Cache key theo epoch của từng session (LRU theo key gốc, tối đa EPOCH_CACHE_SESSIONS):
+#   * EPOCH_WINDOW epoch dùng gần nhất: gói mới & backlog offline xen kẽ đều trúng cache
+#   * checkpoint mỗi EPOCH_CHECKPOINT epoch (giữ luôn, gồm epoch 0) ghi lại khi ratchet đi qua:
+#     epoch cũ bất kỳ chỉ cần ratchet tiếp từ checkpoint gần nhất phía dưới
+# Luôn đi tiếp từ epoch đã biết gần nhất <= epoch cần, không bao giờ quay về 0.
+EPOCH_CACHE_SESSIONS = 4096
+EPOCH_WINDOW = 8
+EPOCH_CHECKPOINT = 64
+
+_epoch_cache = OrderedDict()  # key gốc -> {"keys": {epoch: key}, "recent": [epoch, ...]}
+_epoch_lock = threading.Lock()
+
+
+def epoch_key(base_key, epoch):
+    """Key của epoch bất kỳ, suy ra từ key gốc (epoch 0)."""
+    with _epoch_lock:
+        chain = _epoch_cache.get(base_key)
+        if chain is None:
+            chain = {"keys": {0: base_key}, "recent": []}
+            _epoch_cache[base_key] = chain
+            if len(_epoch_cache) > EPOCH_CACHE_SESSIONS:
+                _epoch_cache.popitem(last=False)
+        else:
+            _epoch_cache.move_to_end(base_key)
+
+        keys = chain["keys"]
+        key = keys.get(epoch)
+        if key is None:
+            start = max(n for n in keys if n <= epoch)
+            if epoch - start > RATCHET_MAX_JUMP:
+                raise ValueError(f"Epoch {epoch} quá xa epoch đã biết {start}")
+            key = keys[start]
+            for n in range(start + 1, epoch + 1):
+                key = ratchet_key(key, n)
+                if n % EPOCH_CHECKPOINT == 0:
+                    keys[n] = key
+            keys[epoch] = key
+
+        recent = chain["recent"]
+        if epoch in recent:
+            recent.remove(epoch)
+        recent.append(epoch)
+        if len(recent) > EPOCH_WINDOW:
+            old = recent.pop(0)
+            if old % EPOCH_CHECKPOINT != 0:
+                keys.pop(old, None)
+        return key
+
+
+def decrypt(packet, key):
+    """Giải mã & xác thực, ném InvalidTag nếu sai key hoặc dữ liệu bị sửa.
+
+    key là key gốc của session; với gói có FLAG_RATCHET, key của epoch trong IV
+    được suy ra tự động.
+    """
+    if packet.flags & FLAG_RATCHET:
+        key = epoch_key(key, struct.unpack(">I", packet.iv[:4])[0])
+    plaintext = AESGCM(key).decrypt(packet.iv, packet.ciphertext + packet.tag, packet.aad)
+    if packet.flags & FLAG_COMPRESSED:
+        plaintext = lz4_decompress(plaintext)
+    return plaintext
+
+
+def _lz4_length(data, pos, length):
+    """Cộng các byte mở rộng độ dài (255 255 ... r) khi nibble trong token là 15."""
+    if length != 15:
+        return length, pos
+    while True:
+        if pos >= len(data):
+            raise ValueError("Khối LZ4 bị cắt cụt")
+        b = data[pos]
+        pos += 1
+        length += b
+        if b != 255:
+            return length, pos
+
+
+def lz4_decompress(data):
+    """Giải nén [độ dài gốc 2B LE][khối LZ4], ném ValueError nếu dữ liệu hỏng."""
+    if len(data) < 3:
+        raise ValueError("Payload nén quá ngắn")
+    size = struct.unpack_from("<H", data)[0]
+    out = bytearray()
+    pos = 2
+    while True:
+        if pos >= len(data):
+            raise ValueError("Khối LZ4 bị cắt cụt")
+        token = data[pos]
+        pos += 1
+        lit_len, pos = _lz4_length(data, pos, token >> 4)
+        if pos + lit_len > len(data) or len(out) + lit_len > size:
+            raise ValueError("Literal LZ4 vượt biên")
+        out += data[pos:pos + lit_len]
+        pos += lit_len
+        if pos == len(data):
+            break  # Sequence cuối chỉ có literal
+
+        if pos + 2 > len(data):
+            raise ValueError("Khối LZ4 bị cắt cụt")
+        offset = data[pos] | (data[pos + 1] << 8)
+        pos += 2
+        match_len, pos = _lz4_length(data, pos, token & 15)
+        match_len += _LZ4_MIN_MATCH
+        if offset == 0 or offset > len(out) or len(out) + match_len > size:
+            raise ValueError("Match LZ4 vượt biên")
+        start = len(out) - offset
+        if offset >= match_len:
+            out += out[start:start + match_len]
+        else:
+            # Match chồng lên chính nó: lặp lại đoạn offset byte cuối
+            out += (out[start:] * (match_len // offset + 1))[:match_len]
+    if len(out) != size:
+        raise ValueError("Độ dài sau giải nén không khớp")
+    return bytes(out)
+
+
+def split_batch(plaintext):
+    """Tách batch thành danh sách (timestamp_ms, data) theo thứ tự gốc."""
+    result = []
+    offset = 0
+    while offset < len(plaintext):
+        if offset + _RECORD_HEADER.size > len(plaintext):
+            raise ValueError("Batch bị cắt cụt")
+        ts, length = _RECORD_HEADER.unpack_from(plaintext, offset)
+        offset += _RECORD_HEADER.size
+        if offset + length > len(plaintext):
+            raise ValueError("Batch bị cắt cụt")
+        result.append((ts, plaintext[offset:offset + length]))
+        offset += length
+    return result
+
+
+def sequence(packet, plaintext):
+    """(seq, giờ gửi Unix ms hoặc None) của gói, None nếu gói không có FLAG_SEQ."""
+    if not packet.flags & FLAG_SEQ:
+        return None
+    if len(plaintext) < _SEQ_HEADER.size:
+        raise ValueError("Thiếu header seq")
+    seq, sent_ms = _SEQ_HEADER.unpack_from(plaintext)
+    return seq, sent_ms or None
+
+
+def records(packet, plaintext):
+    """Danh sách (timestamp_ms hoặc None, data) của một gói đã giải mã."""
+    if packet.flags & FLAG_SEQ:
+        plaintext = plaintext[_SEQ_HEADER.size:]
+    if packet.flags & FLAG_BATCH:
+        return split_batch(plaintext)
+    return [(None, plaintext)]
+
+
+def parse_kx_request(payload):
+    """(reqId, public key X9.62, compressed) của request trao đổi khóa."""
+    payload = bytes(payload)
+    if len(payload) < _KX_HEADER.size:
+        raise ValueError("Request trao đổi khóa quá ngắn")
+    version, flags, req_id = _KX_HEADER.unpack_from(payload)
+    if version != KX_VERSION:
+        raise ValueError(f"Không hỗ trợ version {version}")
+    key = payload[_KX_HEADER.size:]
+    compressed = bool(flags & KX_FLAG_COMPRESSED)
+    if compressed:
+        if len(key) != 33:
+            raise ValueError("Public key nén phải 33 byte")
+        return req_id, key, True
+    if len(key) != 64:
+        raise ValueError("Public key phải 64 byte")
+    return req_id, b"\x04" + key, False
+
+
+def kx_response(req_id, status, session_id=None, public_key=None):
+    """Response trao đổi khóa; public_key là X9.62 (nén 33 byte hoặc 65 byte 0x04||X||Y)."""
+    header = _KX_HEADER.pack(KX_VERSION, status, req_id)
+    if status != KX_STATUS_OK:
+        return header
+    if len(public_key) == 65:
+        public_key = public_key[1:]
+    return header + bytes.fromhex(session_id) + public_key
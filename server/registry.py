@@ -0,0 +1,142 @@
+"""Registry khóa phiên theo thiết bị (dùng chung cho backend và decoder).
+
+Mỗi lần /exchange tạo một session mới cho đúng thiết bị đó, không ghi đè
+thiết bị khác. Tra cứu theo session id hoặc device id bằng dict trong RAM
+(O(1)); SQLite (REGISTRY_DB) chỉ là nơi lưu bền và chia sẻ giữa các process.
+
+    sessions(session_id PK, device_id, aes_key, created_at)
+
+Session cũ vẫn được giữ để gói tin còn trong hàng đợi offline hoặc của phiên
+đã resume sau reboot vẫn giải mã được sau khi thiết bị rekey.
+"""
+import os
+import re
+import sqlite3
+import threading
+import time
+
+from cryptography.exceptions import InvalidTag
+
+import protocol
+
+REGISTRY_DB = os.getenv("REGISTRY_DB", "/shared/registry.db")
+SESSION_ID_LEN = 8
+
+_SID_RE = re.compile(r"^[0-9a-f]{16}$")
+
+_SCHEMA = """
+CREATE TABLE IF NOT EXISTS sessions (
+    session_id TEXT PRIMARY KEY,
+    device_id  TEXT NOT NULL,
+    aes_key    BLOB NOT NULL,
+    created_at REAL NOT NULL
+);
+CREATE INDEX IF NOT EXISTS sessions_by_device ON sessions(device_id, created_at);
+"""
+
+_lock = threading.Lock()
+_conn = None
+_by_session = {}  # session_id -> (device_id, key)
+_by_device = {}   # device_id -> (session_id, key) của session mới nhất
+
+
+def _db():
+    global _conn
+    if _conn is None:
+        os.makedirs(os.path.dirname(REGISTRY_DB) or ".", exist_ok=True)
+        _conn = sqlite3.connect(REGISTRY_DB, check_same_thread=False, isolation_level=None)
+        # WAL: backend ghi trong khi decoder (process khác) vẫn đọc được
+        _conn.execute("PRAGMA journal_mode=WAL")
+        _conn.executescript(_SCHEMA)
+    return _conn
+
+
+def new_session_id():
+    return os.urandom(SESSION_ID_LEN).hex()
+
+
+def enroll(device_id, key):
+    """Tạo session mới cho thiết bị, trả về session id."""
+    session_id = new_session_id()
+    with _lock:
+        _db().execute(
+            "INSERT INTO sessions (session_id, device_id, aes_key, created_at) VALUES (?, ?, ?, ?)",
+            (session_id, device_id, key, time.time()),
+        )
+        _by_session[session_id] = (device_id, key)
+        _by_device[device_id] = (session_id, key)
+    return session_id
+
+
+def _load_session(session_id):
+    row = _db().execute(
+        "SELECT device_id, aes_key FROM sessions WHERE session_id = ?", (session_id,)
+    ).fetchone()
+    if row is None:
+        return None
+    entry = (row[0], bytes(row[1]))
+    _by_session[session_id] = entry
+    return entry
+
+
+def _load_device(device_id):
+    row = _db().execute(
+        "SELECT session_id, aes_key FROM sessions WHERE device_id = ? ORDER BY created_at DESC LIMIT 1",
+        (device_id,),
+    ).fetchone()
+    if row is None:
+        return None
+    entry = (row[0], bytes(row[1]))
+    _by_device[device_id] = entry
+    return entry
+
+
+def lookup(device_id, session_id=None):
+    """Key để giải mã gói của device_id, None nếu không tìm thấy.
+
+    Có session id thì dùng đúng session đó (và phải thuộc về device_id);
+    không có thì dùng session mới nhất của thiết bị.
+    """
+    with _lock:
+        if session_id:
+            if not _SID_RE.match(session_id):
+                return None
+            entry = _by_session.get(session_id) or _load_session(session_id)
+            if entry is None or entry[0] != device_id:
+                return None
+            return entry[1]
+
+        entry = _by_device.get(device_id) or _load_device(device_id)
+        return entry[1] if entry else None
+
+
+def invalidate(device_id):
+    """Bỏ cache session mới nhất của thiết bị (process khác vừa enroll lại)."""
+    with _lock:
+        _by_device.pop(device_id, None)
+
+
+def decrypt(packet):
+    """Tìm key theo thiết bị/session của gói rồi giải mã, ném KeyError nếu chưa enroll."""
+    key = lookup(packet.device, packet.session)
+    if key is None:
+        raise KeyError(f"Chưa có key cho thiết bị {packet.device!r}")
+    try:
+        return protocol.decrypt(packet, key)
+    except InvalidTag:
+        # Gói không có session id: có thể thiết bị vừa enroll lại qua process khác
+        if packet.session:
+            raise
+        invalidate(packet.device)
+        fresh = lookup(packet.device)
+        if fresh is None or fresh == key:
+            raise
+        return protocol.decrypt(packet, fresh)
+
+
+def devices():
+    """Danh sách (device_id, số session, lần enroll gần nhất)."""
+    with _lock:
+        return _db().execute(
+            "SELECT device_id, COUNT(*), MAX(created_at) FROM sessions GROUP BY device_id ORDER BY device_id"
+        ).fetchall()
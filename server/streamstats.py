@@ -0,0 +1,145 @@
+"""Thống kê luồng gói theo thiết bị: mất gói, đảo thứ tự, trùng và độ trễ.
+
+Dựa trên header seq + giờ gửi của mỗi gói (protocol.FLAG_SEQ). Seq tăng dần
+theo từng lần boot của thiết bị; seq tụt hẳn về gần 0 được coi là thiết bị
+khởi động lại và bắt đầu luồng mới (không tính là mất hay đảo gói).
+
+Độ trễ = giờ decoder giải mã xong - giờ gửi của thiết bị, chỉ có khi thiết bị
+đã đồng bộ SNTP; sai lệch đồng hồ hai bên cộng thẳng vào kết quả.
+"""
+import time
+
+# Bucket độ trễ (ms), bucket cuối là "lớn hơn"
+LATENCY_BUCKETS_MS = (10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000, 60000)
+# Gói đến trễ trong cửa sổ này được coi là đảo thứ tự, ngoài cửa sổ (seq nhỏ) là reboot
+REORDER_WINDOW = 1024
+
+
+class DeviceStream:
+    __slots__ = ("first", "highest", "received", "stream_received", "lost_before", "reordered",
+                 "duplicates", "restarts", "recent", "latency_counts", "latency_sum", "latency_n", "metrics")
+
+    def __init__(self):
+        # Các bộ đếm cộng dồn qua mọi lần reboot của thiết bị
+        self.received = 0
+        self.reordered = 0
+        self.duplicates = 0
+        self.restarts = 0
+        self.lost_before = 0  # Số gói mất của các luồng trước lần reboot gần nhất
+        self.metrics = None
+        self.latency_counts = [0] * (len(LATENCY_BUCKETS_MS) + 1)
+        self.latency_sum = 0.0
+        self.latency_n = 0
+        self._new_stream()
+
+    def _new_stream(self):
+        self.first = None
+        self.highest = None
+        self.stream_received = 0
+        self.recent = set()  # Seq đã nhận trong REORDER_WINDOW gần nhất
+
+    def _stream_lost(self):
+        if self.first is None:
+            return 0
+        return (self.highest - self.first + 1) - self.stream_received
+
+    def observe(self, seq, sent_ms, now_ms):
+        if self.highest is not None and seq < self.highest - REORDER_WINDOW and seq < REORDER_WINDOW:
+            self.restarts += 1
+            self.lost_before += self._stream_lost()
+            self._new_stream()
+
+        if seq in self.recent:
+            self.duplicates += 1
+            return
+        if self.first is None:
+            self.first = self.highest = seq
+        elif seq > self.highest:
+            self.highest = seq
+        else:
+            self.reordered += 1
+
+        self.received += 1
+        self.stream_received += 1
+        self.recent.add(seq)
+        if len(self.recent) > 2 * REORDER_WINDOW:
+            floor = self.highest - REORDER_WINDOW
+            self.recent = {s for s in self.recent if s >= floor}
+
+        if sent_ms is not None:
+            self._add_latency(max(0.0, now_ms - sent_ms))
+
+    def _add_latency(self, ms):
+        for i, bound in enumerate(LATENCY_BUCKETS_MS):
+            if ms <= bound:
+                self.latency_counts[i] += 1
+                break
+        else:
+            self.latency_counts[-1] += 1
+        self.latency_sum += ms
+        self.latency_n += 1
+
+    @property
+    def lost(self):
+        """Số seq chưa nhận trong khoảng [first, highest] của mỗi luồng (mỗi lần boot)."""
+        return self.lost_before + self._stream_lost()
+
+    def latency_percentile(self, p):
+        """Cận trên của bucket chứa phân vị p (ms), None nếu chưa có mẫu."""
+        if self.latency_n == 0:
+            return None
+        target = p * self.latency_n
+        seen = 0
+        for i, count in enumerate(self.latency_counts):
+            seen += count
+            if seen >= target:
+                return LATENCY_BUCKETS_MS[i] if i < len(LATENCY_BUCKETS_MS) else float("inf")
+        return float("inf")
+
+    def summary(self):
+        expected = self.received + self.lost
+        out = {
+            "received": self.received,
+            "lost": self.lost,
+            "lossPct": round(100.0 * self.lost / expected, 2) if expected else 0.0,
+            "reordered": self.reordered,
+            "duplicates": self.duplicates,
+            "restarts": self.restarts,
+        }
+        if self.latency_n:
+            out["latencyMs"] = {
+                "avg": round(self.latency_sum / self.latency_n, 1),
+                "p50": self.latency_percentile(0.50),
+                "p90": self.latency_percentile(0.90),
+                "p99": self.latency_percentile(0.99),
+                "histogram": dict(zip([f"<={b}" for b in LATENCY_BUCKETS_MS] + ["more"], self.latency_counts)),
+            }
+        return out
+
+
+class Tracker:
+    """DeviceStream theo device id."""
+
+    def __init__(self):
+        self.devices = {}
+
+    def _stream(self, device):
+        stream = self.devices.get(device)
+        if stream is None:
+            stream = self.devices[device] = DeviceStream()
+        return stream
+
+    def observe(self, device, seq, sent_ms, now_ms=None):
+        if now_ms is None:
+            now_ms = time.time() * 1000
+        self._stream(device).observe(seq, sent_ms, now_ms)
+
+    def metrics(self, device, data):
+        """Lưu bản metrics mới nhất thiết bị tự gửi."""
+        self._stream(device).metrics = data
+
+    def report(self):
+        """Danh sách (device, summary) sắp theo tỉ lệ mất gói giảm dần (thiết bị tụt lại lên đầu)."""
+        rows = [(device, stream.summary(), stream.metrics) for device, stream in self.devices.items()]
+        rows.sort(key=lambda r: (r[1]["lossPct"], r[1].get("latencyMs", {}).get("avg", 0)), reverse=True)
+        return rows
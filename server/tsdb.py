@@ -0,0 +1,206 @@
+"""Lưu bền bản ghi đã giải mã theo thiết bị & thời gian (append-only, SQLite WAL).
+
+    records(device_id, ts_ms, seq, device_ms, data)
+    index (device_id, ts_ms)
+
+ts_ms là Unix ms: giờ gửi trong header seq nếu thiết bị đã đồng bộ SNTP, ngược lại
+là giờ decoder nhận. Bản ghi trong batch được lùi lại theo timestamp millis() của
+thiết bị (device_ms) so với bản ghi cuối, nên sai số tối đa ~ BATCH_MAX_AGE_MS.
+
+append() chỉ đưa bản ghi vào buffer RAM. Thread nền ghi cả buffer trong 1 transaction
+mỗi TSDB_FLUSH_INTERVAL giây, hoặc sớm hơn khi đủ TSDB_BATCH_SIZE bản ghi: commit
+(fsync) tính theo lô chứ không theo gói. Process chết thì mất tối đa 1 chu kỳ flush.
+Buffer vượt TSDB_MAX_PENDING (đĩa chậm / kẹt) thì bỏ bản ghi mới & đếm vào dropped.
+
+Đo ghi từng gói so với ghi theo lô:  python tsdb.py bench [số bản ghi]
+"""
+import os
+import sqlite3
+import sys
+import threading
+import time
+
+TSDB_PATH = os.getenv("TSDB_PATH", "/shared/telemetry.db")
+TSDB_FLUSH_INTERVAL = float(os.getenv("TSDB_FLUSH_INTERVAL", "1.0"))
+TSDB_BATCH_SIZE = int(os.getenv("TSDB_BATCH_SIZE", "2000"))
+TSDB_MAX_PENDING = int(os.getenv("TSDB_MAX_PENDING", "200000"))
+# Số bản ghi tối đa một lần query trả về
+QUERY_LIMIT = 10000
+
+_SCHEMA = """
+CREATE TABLE IF NOT EXISTS records (
+    device_id TEXT    NOT NULL,
+    ts_ms     INTEGER NOT NULL,
+    seq       INTEGER,
+    device_ms INTEGER,
+    data      BLOB    NOT NULL
+);
+CREATE INDEX IF NOT EXISTS records_by_device_time ON records(device_id, ts_ms);
+"""
+
+_INSERT = "INSERT INTO records (device_id, ts_ms, seq, device_ms, data) VALUES (?, ?, ?, ?, ?)"
+
+_lock = threading.Lock()       # Bảo vệ _pending & bộ đếm
+_db_lock = threading.Lock()    # Connection dùng chung giữa thread flush và query
+_wake = threading.Event()
+_conn = None
+_pending = []
+_thread = None
+_stop = False
+stats = {"written": 0, "dropped": 0, "flushes": 0, "flushMsMax": 0.0}
+
+
+def _db():
+    global _conn
+    if _conn is None:
+        os.makedirs(os.path.dirname(TSDB_PATH) or ".", exist_ok=True)
+        _conn = sqlite3.connect(TSDB_PATH, check_same_thread=False, isolation_level=None)
+        # WAL: ghi không chặn process khác đọc (backend query trong khi decoder ghi)
+        _conn.execute("PRAGMA journal_mode=WAL")
+        # Trong WAL, NORMAL vẫn an toàn khi process chết; chỉ mất lô cuối nếu mất điện
+        _conn.execute("PRAGMA synchronous=NORMAL")
+        _conn.executescript(_SCHEMA)
+    return _conn
+
+
+def append(device_id, ts_ms, data, seq=None, device_ms=None):
+    """Đưa 1 bản ghi vào buffer ghi (không chạm đĩa), False nếu buffer đầy."""
+    with _lock:
+        if len(_pending) >= TSDB_MAX_PENDING:
+            stats["dropped"] += 1
+            return False
+        _pending.append((device_id, int(ts_ms), seq, device_ms, bytes(data)))
+        if len(_pending) >= TSDB_BATCH_SIZE:
+            _wake.set()
+    return True
+
+
+def append_packet(device_id, records, sent_ms=None, seq=None):
+    """Lưu các bản ghi của 1 gói đã giải mã (protocol.records()).
+
+    sent_ms: giờ gửi Unix ms trong header seq, None thì dùng giờ hiện tại.
+    """
+    base_ms = sent_ms or int(time.time() * 1000)
+    # Bản ghi cuối của batch coi như lấy mẫu lúc gửi, các bản ghi trước lùi theo millis()
+    last_ms = max((ts for ts, _ in records if ts is not None), default=None)
+    ok = True
+    for ts, data in records:
+        ts_ms = base_ms - (last_ms - ts) if ts is not None else base_ms
+        ok = append(device_id, ts_ms, data, seq, ts) and ok
+    return ok
+
+
+def flush():
+    """Ghi mọi bản ghi đang chờ trong 1 transaction, trả về số bản ghi đã ghi."""
+    global _pending
+    with _lock:
+        batch, _pending = _pending, []
+    if not batch:
+        return 0
+    t0 = time.perf_counter()
+    with _db_lock:
+        db = _db()
+        try:
+            db.execute("BEGIN")
+            db.executemany(_INSERT, batch)
+            db.execute("COMMIT")
+        except sqlite3.Error:
+            # Trả lại buffer trước tiên để thử lại ở lần flush sau (giữ thứ tự gốc)
+            with _lock:
+                _pending = batch + _pending
+            # FULL / IOERR / BUSY: SQLite thường đã tự rollback, ROLLBACK lúc đó sẽ lỗi
+            if db.in_transaction:
+                db.execute("ROLLBACK")
+            raise
+    elapsed_ms = (time.perf_counter() - t0) * 1000
+    with _lock:
+        stats["written"] += len(batch)
+        stats["flushes"] += 1
+        stats["flushMsMax"] = max(stats["flushMsMax"], round(elapsed_ms, 2))
+    return len(batch)
+
+
+def _run():
+    while not _stop:
+        _wake.wait(TSDB_FLUSH_INTERVAL)
+        _wake.clear()
+        try:
+            flush()
+        except sqlite3.Error as e:
+            print(f"[TSDB] Ghi thất bại, thử lại sau: {e}")
+
+
+def start():
+    """Chạy thread flush nền (gọi 1 lần khi process khởi động)."""
+    global _thread
+    if _thread is None:
+        _thread = threading.Thread(target=_run, name="tsdb-flush", daemon=True)
+        _thread.start()
+
+
+def close():
+    """Dừng thread flush và ghi nốt buffer (gọi trước khi thoát)."""
+    global _stop, _thread
+    _stop = True
+    _wake.set()
+    if _thread is not None:
+        _thread.join()
+        _thread = None
+    flush()
+
+
+def query(device_id, start_ms=None, end_ms=None, limit=QUERY_LIMIT):
+    """Bản ghi của thiết bị trong [start_ms, end_ms), tăng dần theo thời gian.
+
+    Trả về list (ts_ms, seq, device_ms, data); bản ghi còn trong buffer chưa được thấy.
+    """
+    sql = "SELECT ts_ms, seq, device_ms, data FROM records WHERE device_id = ?"
+    args = [device_id]
+    if start_ms is not None:
+        sql += " AND ts_ms >= ?"
+        args.append(int(start_ms))
+    if end_ms is not None:
+        sql += " AND ts_ms < ?"
+        args.append(int(end_ms))
+    sql += " ORDER BY ts_ms LIMIT ?"
+    args.append(max(0, min(int(limit), QUERY_LIMIT)))
+    with _db_lock:
+        rows = _db().execute(sql, args).fetchall()
+    return [(ts, seq, dev_ms, bytes(data)) for ts, seq, dev_ms, data in rows]
+
+
+def devices():
+    """Danh sách (device_id, số bản ghi, ts_ms đầu, ts_ms cuối)."""
+    with _db_lock:
+        return _db().execute(
+            "SELECT device_id, COUNT(*), MIN(ts_ms), MAX(ts_ms) FROM records GROUP BY device_id"
+        ).fetchall()
+
+
+def _bench(n):
+    """Ghi n bản ghi: commit từng bản ghi so với 1 transaction mỗi TSDB_BATCH_SIZE bản ghi."""
+    global TSDB_PATH, _conn
+    import tempfile
+
+    payload = b'{"n":30,"why":"heartbeat","temp":[24.1,24.6,24.3,24.4],"hall":[8,17,12,11]}'
+    with tempfile.TemporaryDirectory() as tmp:
+        for mode in ("per-message", "batched"):
+            TSDB_PATH = os.path.join(tmp, f"{mode}.db")
+            _conn = None
+            t0 = time.perf_counter()
+            for i in range(n):
+                append(f"esp32-{i % 100:012x}", 1700000000000 + i, payload, i)
+                if mode == "per-message" or len(_pending) >= TSDB_BATCH_SIZE:
+                    flush()
+            flush()
+            elapsed = time.perf_counter() - t0
+            print(f"{mode:12s} {n} records {elapsed:8.3f} s  {n / elapsed:10.0f} records/s")
+            _conn.close()
+        _conn = None
+
+
+if __name__ == "__main__":
+    if len(sys.argv) > 1 and sys.argv[1] == "bench":
+        _bench(int(sys.argv[2]) if len(sys.argv) > 2 else 20000)
+    else:
+        print(__doc__)